@@ -0,0 +1,116 @@
+#ifndef AutomatonEngine_h
+#define AutomatonEngine_h
+
+#include <vector>
+
+#include "KiTrack/Automaton.h"
+#include "KiTrack/IHit.h"
+#include "KiTrack/Segment.h"
+#include "Criteria/ICriterion.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** The Cellular Automaton as the track search uses it: the 1-segments and their connections get added, then the
+    * segments are lengthened, the states calculated and the bad segments removed, and in the end the tracks are
+    * read out.
+    *
+    * The criteria see the segments as KiTrack::Segment, so the same criteria work with every engine.
+    */
+   class IAutomatonEngine{
+
+
+   public:
+
+      virtual ~IAutomatonEngine(){}
+
+      /** Adds a 1-segment of the hit (with the layer of the hit)
+       *
+       * @return the index of the segment, to connect it with connect1Segments()
+       */
+      virtual unsigned add1Segment( IHit* hit ) = 0;
+
+      /** @return the 1-segment with the index, as the criteria see it. It stays valid, while more 1-segments get added. */
+      virtual Segment* get1Segment( unsigned index ) = 0;
+
+      /** Connects two 1-segments: parent is the one with the outer hit, child the one with the inner hit */
+      virtual void connect1Segments( unsigned parent, unsigned child ) = 0;
+
+      /** Adds criteria, that are used when the segments are lengthened */
+      virtual void addCriteria( const std::vector< ICriterion* >& criteria ) = 0;
+
+      /** Removes all criteria */
+      virtual void clearCriteria() = 0;
+
+      /** Makes a segment one hit longer out of every connection and connects the new segments, if all criteria allow it */
+      virtual void lengthenSegments() = 0;
+
+      /** Calculates the states of the segments */
+      virtual void doAutomaton() = 0;
+
+      /** Removes the segments, that are not part of a chain reaching down to the IP (and their connections) */
+      virtual void cleanBadStates() = 0;
+
+      /** Sets all states back to 0 */
+      virtual void resetStates() = 0;
+
+      /** @return the number of connections between the segments */
+      virtual unsigned getNumberOfConnections() = 0;
+
+      /** @return the hits of all paths from the segments without parents to the segments without children, that have
+       * at least minHits hits. The hits of a track go from the outer to the inner ones.
+       */
+      virtual std::vector< std::vector< IHit* > > getTracks( unsigned minHits ) = 0;
+
+   };
+
+
+   /** The IAutomatonEngine using the KiTrack::Automaton */
+   class KiTrackAutomatonEngine : public IAutomatonEngine{
+
+
+   public:
+
+      virtual unsigned add1Segment( IHit* hit );
+
+      virtual Segment* get1Segment( unsigned index ){ return _segments[ index ]; }
+
+      virtual void connect1Segments( unsigned parent, unsigned child );
+
+      virtual void addCriteria( const std::vector< ICriterion* >& criteria ){ _automaton.addCriteria( criteria ); }
+
+      virtual void clearCriteria(){ _automaton.clearCriteria(); }
+
+      virtual void lengthenSegments(){ _automaton.lengthenSegments(); }
+
+      virtual void doAutomaton(){ _automaton.doAutomaton(); }
+
+      virtual void cleanBadStates(){ _automaton.cleanBadStates(); }
+
+      virtual void resetStates(){ _automaton.resetStates(); }
+
+      virtual unsigned getNumberOfConnections(){ return _automaton.getNumberOfConnections(); }
+
+      virtual std::vector< std::vector< IHit* > > getTracks( unsigned minHits ){ return _automaton.getTracks( minHits ); }
+
+      /** @return the KiTrack::Automaton (for example to draw it) */
+      const Automaton& getAutomaton() const { return _automaton; }
+
+
+   private:
+
+      Automaton _automaton{};
+
+      /** The 1-segments by their index (the Automaton owns them) */
+      std::vector< Segment* > _segments{};
+
+   };
+
+
+}
+
+
+#endif
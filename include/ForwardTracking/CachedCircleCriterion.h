@@ -0,0 +1,74 @@
+#ifndef CachedCircleCriterion_h
+#define CachedCircleCriterion_h
+
+#include <string>
+
+#include "KiTrack/Segment.h"
+#include "Criteria/ICriterion.h"
+
+#include "TripletCircleCache.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** A criterion of the Cellular Automaton calculated from circles through triplets of hits, that takes the circles
+    * from a TripletCircleCache.
+    *
+    * It wraps the criterion of KiTrack with the same name and makes the same decision:
+    * - Crit3_PT: the transverse momentum from the radius of the circle through the three hits
+    * - Crit4_DistOfCircleCenters: the distance of the centers of the circles of the child and the parent 3-hit segment
+    *
+    * Without a cache, or if there is no circle through the hits, the wrapped criterion decides.
+    * The calculated values are not saved (see ICriterion::setSaveValues), use the wrapped criterion for that.
+    */
+   class CachedCircleCriterion : public ICriterion{
+
+
+   public:
+
+      /** @return whether there is a CachedCircleCriterion for the criterion with this name */
+      static bool isCacheable( const std::string& name );
+
+      /** @param criterion the criterion of KiTrack, created with name, min and max. It is owned from now on.
+       *
+       * @param name the name of the criterion, it has to be cacheable
+       */
+      CachedCircleCriterion( ICriterion* criterion, const std::string& name, float min, float max );
+
+      virtual ~CachedCircleCriterion();
+
+      CachedCircleCriterion( const CachedCircleCriterion& ) = delete;
+      CachedCircleCriterion& operator=( const CachedCircleCriterion& ) = delete;
+
+      /** Sets the cache of the circles (NULL: the wrapped criterion does everything) */
+      void setCache( TripletCircleCache* cache ){ _cache = cache; }
+
+      virtual bool areCompatible( Segment* parent , Segment* child )throw( BadSegmentLength );
+
+
+   private:
+
+      enum Quantity{ PT, DistOfCircleCenters };
+
+      /** The magnetic field in z (in T), that Crit3_PT is created with by Criteria::createCriterion */
+      static const float Bz;
+
+      ICriterion* _criterion;
+
+      Quantity _quantity;
+
+      float _min;
+      float _max;
+
+      TripletCircleCache* _cache;
+
+   };
+
+
+}
+
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef CompactAutomaton_h
+#define CompactAutomaton_h
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "AutomatonEngine.h"
+
+
+namespace KiTrackMarlin{
+
+
+   /** A Cellular Automaton on flat arrays, doing the same as the KiTrack::Automaton.
+    *
+    * All segments have the same number of hits, so their hits are stored one segment after the other in a single
+    * array, and their layers and states in arrays by the index of the segment. The connections are stored in
+    * compressed sparse rows: the children of every segment one after the other, and the other way round the
+    * connections to the parents of every segment. There are no Segment objects with vectors of parents and children
+    * and no lists to walk.
+    *
+    * - lengthenSegments() makes the segment of a connection at the position of the connection, and tests the pairs of
+    *   connections sharing their middle segment with the criteria.
+    * - doAutomaton() sweeps the segments in the order of their layers: as the children are on lower layers, a sweep
+    *   gets all states right, a second one only checks this.
+    * - cleanBadStates() moves the good segments and their connections to the front of the arrays.
+    *
+    * Only the criteria get Segment objects, made from the hits when they are needed.
+    *
+    * The tracks are the same as those of the KiTrack::Automaton, their order may be different.
+    */
+   class CompactAutomaton : public IAutomatonEngine{
+
+
+   public:
+
+      CompactAutomaton();
+
+      virtual unsigned add1Segment( IHit* hit );
+
+      virtual Segment* get1Segment( unsigned index ){ return &_1Segments[ index ]; }
+
+      virtual void connect1Segments( unsigned parent, unsigned child );
+
+      virtual void addCriteria( const std::vector< ICriterion* >& criteria ){ _criteria.insert( _criteria.end(), criteria.begin(), criteria.end() ); }
+
+      virtual void clearCriteria(){ _criteria.clear(); }
+
+      virtual void lengthenSegments();
+
+      virtual void doAutomaton();
+
+      virtual void cleanBadStates();
+
+      virtual void resetStates();
+
+      virtual unsigned getNumberOfConnections();
+
+      virtual std::vector< std::vector< IHit* > > getTracks( unsigned minHits );
+
+      /** @return the number of segments */
+      unsigned getNumberOfSegments() const { return _layers.size(); }
+
+      /** @return the number of hits of every segment */
+      unsigned getSegmentLength() const { return _length; }
+
+
+   private:
+
+      /** Builds the rows of the children and the parents from the connections added since the last time */
+      void buildRows();
+
+      /** Adds the tracks of all paths from the segment down to the segments without children (without the virtual hits) */
+      void addTracks( unsigned segment, std::vector< IHit* >& hits, unsigned minHits, std::vector< std::vector< IHit* > >& tracks ) const;
+
+      /** @return whether all criteria allow connecting parent and child */
+      bool areCompatible( Segment* parent, Segment* child ) const;
+
+      /** The number of hits of every segment */
+      unsigned _length;
+
+      /** The hits of the segments: _length per segment, from the inner to the outer hit */
+      std::vector< IHit* > _hits;
+
+      /** The layer (of the inner hit) and the state of every segment */
+      std::vector< int > _layers;
+      std::vector< int > _states;
+
+      /** The connections added, but not in the rows yet: ( parent, child ) */
+      std::vector< std::pair< unsigned, unsigned > > _newConnections;
+
+      /** The children of segment i are _children[ _childBegin[i] ] to _children[ _childBegin[i+1] - 1 ].
+       * The position of a child in _children is the index of the connection.
+       */
+      std::vector< unsigned > _childBegin;
+      std::vector< unsigned > _children;
+
+      /** The parent of every connection */
+      std::vector< unsigned > _connectionParents;
+
+      /** The connections to the parents of segment i are _parentConnections[ _parentBegin[i] ] to
+       * _parentConnections[ _parentBegin[i+1] - 1 ].
+       */
+      std::vector< unsigned > _parentBegin;
+      std::vector< unsigned > _parentConnections;
+
+      /** The 1-segments as the criteria of the segment builder see them (until the segments change) */
+      std::deque< Segment > _1Segments;
+
+      std::vector< ICriterion* > _criteria;
+
+   };
+
+
+}
+
+
+#endif
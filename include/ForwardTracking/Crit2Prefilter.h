@@ -0,0 +1,75 @@
+#ifndef Crit2Prefilter_h
+#define Crit2Prefilter_h
+
+#include <string>
+
+#include "HitStore.h"
+
+
+namespace KiTrackMarlin{
+
+
+   /** A prefilter for the 2-hit criteria of the Cellular Automaton: it tests the cuts of some criteria for one parent
+    * hit against a range of child hits in a HitStore, without creating segments and without virtual calls.
+    *
+    * It knows the cuts of Crit2_DeltaRho ( rho of the parent - rho of the child ) and Crit2_RZRatio ( the distance of
+    * the hits over their distance in z ). Other criteria are not tested here.
+    *
+    * The prefilter is looser than the criteria by a small tolerance, so it never rejects a pair of hits the criteria
+    * would accept (the criteria calculate in float from the hits, here it may be calculated differently). The pairs
+    * passing it still have to be tested by the criteria themselves; then the connections are the same as without it.
+    */
+   class Crit2Prefilter{
+
+
+   public:
+
+      Crit2Prefilter();
+
+      /** Adds the cut of a criterion. If the criterion is there already, only pairs passing both cuts pass.
+       *
+       * @return whether the criterion is known to the prefilter (else the cut is not used)
+       */
+      bool addCut( const std::string& name, float min, float max );
+
+      /** @return whether there is any cut to test */
+      bool isActive() const { return _useDeltaRho || _useRZRatio; }
+
+      /** Selects the child hits of [begin,end), that may be connected to the parent hit.
+       *
+       * @param hitStore the hits
+       *
+       * @param parent the index of the parent hit in the hitStore
+       *
+       * @param selected the indices of the passing child hits are written here (space for end - begin indices needed)
+       *
+       * @return the number of passing child hits
+       */
+      unsigned select( const HitStore& hitStore, unsigned parent, unsigned begin, unsigned end, unsigned* selected ) const;
+
+      /** @return whether a parent hit with a radius in [rParentMin,rParentMax] and a child hit with a radius in
+       * [rChildMin,rChildMax] may pass the cut of Crit2_DeltaRho (true, if there is no such cut)
+       */
+      bool mayConnectRadii( float rParentMin, float rParentMax, float rChildMin, float rChildMax ) const;
+
+
+   private:
+
+      /** The relative tolerance, by which the cuts are loosened */
+      static const float tolerance;
+
+      bool _useDeltaRho;
+      float _deltaRhoMin;
+      float _deltaRhoMax;
+
+      bool _useRZRatio;
+      float _ratioMin2; // squared
+      float _ratioMax2; // squared
+
+   };
+
+
+}
+
+
+#endif
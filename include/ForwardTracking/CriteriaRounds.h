@@ -0,0 +1,124 @@
+#ifndef CriteriaRounds_h
+#define CriteriaRounds_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Criteria/ICriterion.h"
+
+#include "Crit2Prefilter.h"
+#include "CachedCircleCriterion.h"
+#include "TripletCircleCache.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** The criteria of all rounds of the Cellular Automaton, created once.
+    *
+    * Every criterion can have several pairs of min and max values. In round n the n-th values are used,
+    * if a criterion has no more values, its last ones stay. There are as many rounds as the most values any
+    * criterion has.
+    *
+    * The criteria of every round are created in the constructor and sorted by their type (2Hit, 3Hit, 4Hit),
+    * so during the events they only need to be looked up.
+    *
+    * The criteria store the values they calculate, so they must not be used by two searches at the same time.
+    * Every concurrent search therefore needs its own CriteriaRounds: a copy creates its own criteria.
+    *
+    * The criteria calculated from circles through triplets of hits are CachedCircleCriterion, so they can take the
+    * circles from a TripletCircleCache (see setCircleCache).
+    */
+   class CriteriaRounds{
+
+
+   public:
+
+      /**
+       * @param criteriaNames the names of the criteria
+       *
+       * @param critMinima the min values of the rounds for every criterion, at least one per criterion
+       *
+       * @param critMaxima the max values of the rounds for every criterion, at least one per criterion
+       */
+      CriteriaRounds( const std::vector< std::string >& criteriaNames,
+                      const std::map< std::string , std::vector< float > >& critMinima,
+                      const std::map< std::string , std::vector< float > >& critMaxima );
+
+      /** Creates the same criteria again */
+      CriteriaRounds( const CriteriaRounds& other );
+
+      ~CriteriaRounds();
+
+      CriteriaRounds& operator=( const CriteriaRounds& ) = delete;
+
+      /** @return the number of rounds */
+      unsigned getNumberOfRounds() const { return _rounds.size(); }
+
+      /** @return the criteria for 2 hits (2 1-hit segments) of the round */
+      const std::vector< ICriterion* >& getCrit2Vec( unsigned round ) const { return _rounds[ round ].crit2Vec; }
+
+      /** @return the criteria for 3 hits (2 2-hit segments) of the round */
+      const std::vector< ICriterion* >& getCrit3Vec( unsigned round ) const { return _rounds[ round ].crit3Vec; }
+
+      /** @return the criteria for 4 hits (2 3-hit segments) of the round */
+      const std::vector< ICriterion* >& getCrit4Vec( unsigned round ) const { return _rounds[ round ].crit4Vec; }
+
+      /** @return a prefilter with the cuts of those 2-hit criteria of the round, that it knows */
+      const Crit2Prefilter& getCrit2Prefilter( unsigned round ) const { return _rounds[ round ].crit2Prefilter; }
+
+      /** @return whether the 2-hit criteria of the round only allow connections, that were allowed in the round before
+       * (no minimum got smaller, no maximum bigger). false for round 0.
+       */
+      bool are2HitCriteriaNested( unsigned round ) const { return _rounds[ round ].crit2Nested; }
+
+      /** Sets the cache of the circles for the criteria of all rounds (NULL: no cache, the default). A copy doesn't
+       * take over the cache.
+       */
+      void setCircleCache( TripletCircleCache* cache );
+
+
+   private:
+
+      /** The values of one criterion in one round */
+      struct CriterionValues{
+
+         std::string name;
+         float min;
+         float max;
+
+      };
+
+      /** The criteria of one round */
+      struct Round{
+
+         std::vector< CriterionValues > values;
+
+         std::vector< ICriterion* > crit2Vec;
+         std::vector< ICriterion* > crit3Vec;
+         std::vector< ICriterion* > crit4Vec;
+
+         Crit2Prefilter crit2Prefilter;
+
+         /** The criteria from crit3Vec and crit4Vec, that can use a TripletCircleCache */
+         std::vector< CachedCircleCriterion* > circleCriteria;
+
+         bool crit2Nested;
+
+      };
+
+      /** Creates the criteria of the rounds from their values */
+      void createCriteria();
+
+      std::vector< Round > _rounds;
+
+   };
+
+
+}
+
+
+#endif
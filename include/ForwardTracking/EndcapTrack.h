@@ -38,6 +38,13 @@ namespace KiTrackMarlin{
        */
       TrackImpl* getLcioTrack(){ return ( _lcioTrack );}
       
+      /** Hands the lcio track over to the caller, who has to delete it (or give it to a collection).
+       * Afterwards the track has no lcio track anymore: only its hits can still be used.
+       * 
+       * @return the lcio track or NULL, if it was already released
+       */
+      TrackImpl* releaseLcioTrack();
+      
     
       void addHit( IEndcapHit* hit );
       
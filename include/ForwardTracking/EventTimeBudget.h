@@ -0,0 +1,75 @@
+#ifndef EventTimeBudget_h
+#define EventTimeBudget_h
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+
+namespace KiTrackMarlin{
+
+
+   /** The time an event may take, and what was done to keep to it.
+    *
+    * The budget is only checked at the boundaries of the stages of the track search, so the search is never
+    * interrupted: when it is exhausted, the following stages are done the cheaper way (a degradation) and the record
+    * of this ends up in the output.
+    *
+    * Checking and recording degradations is thread safe.
+    */
+   class EventTimeBudget{
+
+
+   public:
+
+      /** The ways the track search gets cheaper */
+      enum Degradation{
+
+         TighterRound,             // the Cellular Automaton went straight on to the last (tightest) criteria round
+         CappedOverlapVersions,    // fewer versions of the raw tracks with hits from overlapping petals
+         SimpleSubset,             // SubsetSimple instead of SubsetHopfieldNN
+         nDegradations
+
+      };
+
+      EventTimeBudget();
+
+      /** Starts the budget of a new event now and forgets the degradations
+       *
+       * @param budgetMs the time the event may take in ms, 0 or less means no limit
+       */
+      void start( double budgetMs );
+
+      /** @return whether the event has taken longer than the budget already */
+      bool isExhausted() const;
+
+      /** Records a degradation */
+      void degrade( Degradation degradation ){ _degraded[ degradation ] = true; }
+
+      /** @return whether the degradation was recorded */
+      bool isDegraded( Degradation degradation ) const { return _degraded[ degradation ]; }
+
+      /** @return whether any degradation was recorded */
+      bool isDegraded() const;
+
+      /** @return the names of the recorded degradations, separated by commas */
+      std::string getDegradationNames() const;
+
+      static const char* getDegradationName( Degradation degradation );
+
+
+   private:
+
+      bool _limited;
+
+      std::chrono::steady_clock::time_point _deadline;
+
+      std::atomic< bool > _degraded[ nDegradations ];
+
+   };
+
+
+}
+
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef FitResultCache_h
+#define FitResultCache_h
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "KiTrack/IHit.h"
+#include "KiTrack/ITrack.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** Remembers the results of the helix and Kalman fits of an event, so the same set of hits is only fitted once.
+    *
+    * Different raw tracks from the Cellular Automaton and their versions with hits from overlapping petals often
+    * consist of the same hits. The results are stored with the set of hits as key: the order of the hits doesn't
+    * matter. Failed fits are stored as well.
+    *
+    * All methods are thread safe. The cache has to be cleared, when the hits of the event are gone.
+    */
+   class FitResultCache{
+
+
+   public:
+
+      /** The result of a helix fit */
+      struct HelixResult{
+
+         /** whether the fit threw an exception */
+         bool failed;
+
+         double chi2;
+
+         int ndf;
+
+      };
+
+      /** The result of a Kalman fit */
+      struct KalmanResult{
+
+         /** whether the fit threw an exception */
+         bool failed;
+
+         double chi2;
+
+         int ndf;
+
+         double chi2Prob;
+
+         /** the fitted track. It has to live as long as the cache is used. */
+         ITrack* track;
+
+      };
+
+      FitResultCache();
+
+      /** @return whether the result of a helix fit of the hits is known
+       *
+       * @param hits the hits, in any order
+       *
+       * @param result here the result gets stored, if it is known
+       */
+      bool findHelix( const std::vector< IHit* >& hits, HelixResult& result );
+
+      /** @return whether the result of a Kalman fit of the hits is known
+       *
+       * @param hits the hits, in any order
+       *
+       * @param result here the result gets stored, if it is known
+       */
+      bool findKalman( const std::vector< IHit* >& hits, KalmanResult& result );
+
+      /** Stores the result of a helix fit of the hits (if there is none yet) */
+      void storeHelix( const std::vector< IHit* >& hits, const HelixResult& result );
+
+      /** Stores the result of a Kalman fit of the hits (if there is none yet) */
+      void storeKalman( const std::vector< IHit* >& hits, const KalmanResult& result );
+
+      /** Forgets all results and resets the counters */
+      void clear();
+
+      unsigned getNumberOfHelixLookups() const { return _nHelixLookups; }
+      unsigned getNumberOfHelixHits() const { return _nHelixHits; }
+      unsigned getNumberOfKalmanLookups() const { return _nKalmanLookups; }
+      unsigned getNumberOfKalmanHits() const { return _nKalmanHits; }
+
+
+   private:
+
+      typedef std::vector< IHit* > HitSet;
+
+      struct HitSetHash{
+
+         std::size_t operator()( const HitSet& hitSet ) const;
+
+      };
+
+      /** The known results of a set of hits */
+      struct Entry{
+
+         bool helixKnown;
+         HelixResult helix;
+
+         bool kalmanKnown;
+         KalmanResult kalman;
+
+         Entry(): helixKnown( false ), kalmanKnown( false ){}
+
+      };
+
+      /** @return the hits sorted by their address, as key for the map */
+      static HitSet getKey( const std::vector< IHit* >& hits );
+
+      std::unordered_map< HitSet, Entry, HitSetHash > _entries;
+
+      std::mutex _mutex;
+
+      std::atomic< unsigned > _nHelixLookups;
+      std::atomic< unsigned > _nHelixHits;
+      std::atomic< unsigned > _nKalmanLookups;
+      std::atomic< unsigned > _nKalmanHits;
+
+   };
+
+
+}
+
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef FittedFTDTrack_h
+#define FittedFTDTrack_h
+
+#include <memory>
+
+#include "ILDImpl/FTDTrack.h"
+#include "Tools/Fitter.h"
+
+
+namespace KiTrackMarlin{
+
+
+   /** An FTDTrack, that keeps its Kalman fit.
+    *
+    * FTDTrack::fit() throws the Fitter away after taking the chi2 and the track state at the IP. This track keeps it,
+    * so the track states at the other reference points (first and last hit, calorimeter) can later be taken from the
+    * same fit, instead of fitting the track again.
+    *
+    * The Fitter uses the IMarlinTrkSystem of the track: it must not be used by anybody else, as long as the Fitter is used.
+    */
+   class FittedFTDTrack : public FTDTrack {
+
+
+   public:
+
+      /** @param trkSystem An IMarlinTrkSystem, which is needed for fitting of the tracks */
+      FittedFTDTrack( MarlinTrk::IMarlinTrkSystem* trkSystem ): FTDTrack( trkSystem ){}
+
+      FittedFTDTrack( const FittedFTDTrack& ) = delete;
+      FittedFTDTrack& operator=( const FittedFTDTrack& ) = delete;
+
+      /** Fits the track like FTDTrack::fit() and keeps the Fitter */
+      virtual void fit() throw( FitterException );
+
+      /** @return the Fitter of the last fit or NULL, if the track wasn't fitted (or the fit was released) */
+      Fitter* getFitter(){ return _fitter.get(); }
+
+      /** Throws the fit away, to free its memory (the chi2, Ndf and the track state at the IP stay) */
+      void releaseFitter(){ _fitter.reset(); }
+
+      /** Hands the lcio track over to the caller, who has to delete it (or give it to a collection).
+       * Afterwards the track has no lcio track anymore: only its hits can still be used.
+       *
+       * @return the lcio track or NULL, if it was already released
+       */
+      IMPL::TrackImpl* releaseLcioTrack(){
+
+         IMPL::TrackImpl* lcioTrack = _lcioTrack;
+         _lcioTrack = NULL;
+
+         return lcioTrack;
+
+      }
+
+
+   private:
+
+      std::unique_ptr< Fitter > _fitter;
+
+   };
+
+
+}
+
+
+#endif
@@ -2,6 +2,8 @@
 #define ForwardTracking_h 1
 
 #include <string>
+#include <atomic>
+#include <mutex>
 
 #include "marlin/Processor.h"
 #include "lcio.h"
@@ -15,6 +17,23 @@
 #include "KiTrack/ITrack.h"
 #include "Criteria/Criteria.h"
 #include "ILDImpl/SectorSystemFTD.h"
+#include "ILDImpl/FTDHit01.h"
+#include "ILDImpl/FTDHitSimple.h"
+#include "ILDImpl/FTDTrack.h"
+
+#include "MarlinTrkSystemPool.h"
+#include "ObjectPool.h"
+#include "SectorHitIndex.h"
+#include "OverlapHitGrid.h"
+#include "CriteriaRounds.h"
+#include "TrackingStatistics.h"
+#include "FitResultCache.h"
+#include "TrackConflictGraph.h"
+#include "FittedFTDTrack.h"
+#include "EventTimeBudget.h"
+#include "RoundPredictor.h"
+#include "AutomatonEngine.h"
+#include "TripletCircleCache.h"
 
 using namespace lcio ;
 using namespace marlin ;
@@ -91,7 +110,23 @@ typedef std::vector< IHit* > RawTrack;
  * @param HNN_TInf The temperature limit of the Hopfield Neural Network<br>
  * (default value 0.1)
  * 
+ * @param SubsetComponents Whether to split the track candidates into groups, that are only in conflict (share hits) with tracks
+ * of the same group, and find the best subset of every group on its own. A track without conflicts is accepted right away,
+ * groups up to SubsetExactMaxSize tracks get the subset with the highest sum of the quality indicators exactly and only larger groups
+ * are given to the BestSubsetFinder. Only used with SubsetHopfieldNN and SubsetSimple. (SubsetHopfieldNN then runs as
+ * SubsetSeededHopfieldNN with its own random numbers, so its result doesn't depend on SubsetThreads.)<br>
+ * (default value false)
+ * 
+ * @param SubsetExactMaxSize The largest group of conflicting tracks, whose best subset is searched exactly (the time grows
+ * exponentially with it), if SubsetComponents is set.<br>
+ * (default value 12)
+ * 
+ * @param SubsetThreads The number of threads used for the groups of tracks given to the BestSubsetFinder, if SubsetComponents
+ * is set.<br>
+ * (default value 1)
+ * 
  * @param MaxConnectionsAutomaton If the automaton has more connections than this it will be redone with the next cut off values for the criteria.<br>
+ * Building the segments stops as soon as there are more (see IncrementalRounds for the exception).<br>
  * If there are no further new values for the criteria, the event will be skipped.<br>
  * (default value 100000 )
  * 
@@ -101,6 +136,123 @@ typedef std::vector< IHit* > RawTrack;
  * prevents it) <br>
  * (default value 1000)
  * 
+ * @param SplitOverflowingSectors Instead of dropping a sector with more than MaxHitsPerSector hits, sort its hits by radius and
+ * split it into sub-sectors (rings) of at most MaxHitsPerSector hits, by halving it up to MaxSectorSplitDepth times. Only the 
+ * sub-sectors with radii passing the cut on Crit2_DeltaRho get connected, so the connections are the same as without MaxHitsPerSector,
+ * but the pairs of hits to test stay bounded. Sectors that would need more halvings are still dropped. If a sector got split,
+ * the QualityCode is "Fair" (unless it is "Poor"). The number of split and dropped sectors and the time of the splitting are in
+ * the statistics (Count_SplitSectors, Count_DroppedSectors, TimeMs_SectorSplitting).<br>
+ * (default value false)
+ * 
+ * @param MaxSectorSplitDepth How often an overflowing sector may be halved at most, if SplitOverflowingSectors is set.<br>
+ * (default value 3)
+ * 
+ * @param NumberOfFitThreads The number of threads used to fit the track candidates. Every thread uses its own
+ * MarlinTrkSystem. The track candidates are the same for any number of threads. As the MarlinTrk::Factory only
+ * provides one shared system per type, values above 1 are rejected for now.<br>
+ * (default value 1)
+ * 
+ * @param SplitSides Whether to search the tracks on the forward and the backward side of the FTD as two independent
+ * jobs (running at the same time, if there are track fitting systems for both). As no track crosses from one side
+ * to the other, the found tracks are the same, except that a side needing tighter cuts (because of
+ * MaxConnectionsAutomaton) doesn't tighten them for the other side.<br>
+ * (default value false)
+ * 
+ * @param IncrementalRounds If the Automaton has too many connections and gets redone with the next values of the criteria,
+ * don't search the connections between the hits again, but filter the ones of the last round with the new 2-hit criteria.
+ * This is only done, if no 2-hit criterion gets looser (then the result is the same). Else the connections are searched again.
+ * The price: a round, whose connections the next round can filter, is always built completely, while otherwise the
+ * building stops as soon as there are more than MaxConnectionsAutomaton connections. So for events, where already the
+ * first round has far too many connections, it can be slower.<br>
+ * (default value false)
+ * 
+ * @param BatchedCrit2Prefilter Whether the cuts of Crit2_DeltaRho and Crit2_RZRatio are first tested for a hit against all hits
+ * of a connected sector at once (vectorised, on a HitStore), before the 2-hit criteria test the remaining pairs. The connections
+ * are the same.<br>
+ * (default value false)
+ * 
+ * @param ReuseCandidateFit Whether the track states of the saved tracks (at the IP, first and last hit and calorimeter) are taken
+ * from the Kalman fit of the track candidate, instead of fitting the tracks once more. The fits of the candidates are kept until
+ * the end of the event (those of rejected candidates are freed).<br>
+ * (default value true)
+ * 
+ * @param UseFitCache Whether to remember the results of the helix and Kalman fits in an event. Raw tracks and their versions
+ * with hits from overlapping petals often consist of the same hits, these are then only fitted once. A track candidate
+ * with the same hits as an earlier one is the same object then.<br>
+ * (default value true)
+ * 
+ * @param StatisticsFile A CSV file, to which the summary (mean, median and 99th percentile) of the times of the stages
+ * (in ms) and the counters of the combinatorics (rounds, connections, raw tracks, versions, fits, ...) of all events
+ * is written at the end. The values of every event are also stored as parameters of the output track collection
+ * (TimeMs_<stage> and Count_<counter>). The times of stages running in several threads are summed over the threads.
+ * Empty means no file.<br>
+ * (default value "")
+ * 
+ * @param MaxOverlapVersions The maximum number of versions of a track with hits from overlapping petals, that get fitted.
+ * The versions are created the most promising first (the added hits being closest to the circle through the track)
+ * and hits or combinations of hits, that fail the HelixFitMax cut, are not used. The track without any added hits is
+ * always kept. 0 means all
+ * combinations are fitted (their number grows exponentially with busy petals).<br>
+ * (default value 0)
+ * 
+ * @param KalmanFitBestHelixVersions If TakeBestVersionOfTrack is set: the versions of a track passing HelixFitMax are ranked
+ * by the chi2/Ndf of their helix fit and only the best ones get the Kalman fit, until this many are accepted. Versions
+ * further down are only Kalman fitted, if the fits of better ones fail or are rejected by Chi2ProbCut. 0 means all
+ * versions are Kalman fitted.<br>
+ * (default value 0)
+ * 
+ * @param IncrementalOverlapFit Instead of fitting every version of a track with hits from overlapping petals, fit the 
+ * track once and judge every overlapping hit by the increase of the chi2 it would cause in the Kalman filter. For every hit
+ * of the track the overlapping hit with the smallest increase is added and only this version gets the full fits. If it fails them,
+ * the track without overlapping hits is tried. So there is at most one version per track. If the single fit fails, all versions
+ * are created as usual (see MaxOverlapVersions).<br>
+ * (default value false)
+ * 
+ * @param OverlapChi2IncrementMax The maximum increase of the chi2 by a hit from an overlapping petal, for it to be added
+ * in the IncrementalOverlapFit mode.<br>
+ * (default value 10)
+ * 
+ * @param EventTimeBudget The time in ms an event may take. It is checked between the stages of the search, and once it is
+ * used up the rest of the event is done the cheaper way: a criteria round of the Cellular Automaton that has to be redone
+ * (see MaxConnectionsAutomaton) goes straight on to the last (tightest) round instead of the next one, and a round still being
+ * built is given up for the last one after the segment building or the 2-hit segments, the raw tracks get at most
+ * TimeBudgetMaxOverlapVersions versions with hits from overlapping petals and SubsetHopfieldNN is replaced by SubsetSimple.
+ * The QualityCode of such an event is at most "Fair" and the output collection gets the parameter TimeBudgetDegradations
+ * naming what was done. The search is never interrupted, so an event can still take longer. 0 means no limit.<br>
+ * (default value 0)
+ * 
+ * @param TimeBudgetMaxOverlapVersions The maximum number of versions of a raw track with hits from overlapping petals,
+ * once the EventTimeBudget is used up (the most promising ones, see MaxOverlapVersions).<br>
+ * (default value 1)
+ * 
+ * @param PredictFirstRound Whether to predict the connections of the rounds of the Cellular Automaton from the occupancies
+ * of the sectors before building anything, and to start directly at the first round predicted to stay under
+ * MaxConnectionsAutomaton (see RoundPredictor). Only rounds with an acceptance in RoundPredictorAcceptances, that are predicted
+ * to exceed the limit by more than RoundPredictorSafetyFactor, are skipped. At the end the acceptances measured in the run and
+ * how often the predictions were right are reported, so they can be used to calibrate the next run. Only the predictions of
+ * built rounds can be checked: a skipped round is never built, so the rate doesn't tell, how often a round was skipped
+ * without need.<br>
+ * (default value false)
+ * 
+ * @param RoundPredictorAcceptances The calibrated acceptances of the rounds for PredictFirstRound: the fraction of the pairs
+ * of hits in connected sectors, that the 2-hit criteria of the round connect. Rounds without a value (or with -1) are never
+ * skipped.<br>
+ * (default value empty)
+ * 
+ * @param RoundPredictorSafetyFactor A round is only skipped by PredictFirstRound, if its predicted connections are more than
+ * this factor times MaxConnectionsAutomaton (values below 1 count as 1).<br>
+ * (default value 2)
+ * 
+ * @param CompactAutomaton Whether to run the Cellular Automaton on the flat arrays of the CompactAutomaton instead of the
+ * KiTrack::Automaton. The tracks are the same. (With CED only the KiTrack::Automaton gets drawn.)<br>
+ * (default value false)
+ * 
+ * @param CacheTripletCircles Whether the criteria calculated from circles through hit triplets (Crit3_PT and
+ * Crit4_DistOfCircleCenters) take the circles from a cache of the event, so every circle is only calculated once
+ * (see TripletCircleCache). The decisions are the same. The lookups and hits of the cache are the counters
+ * CircleCacheLookups and CircleCacheHits of the statistics.<br>
+ * (default value false)
+ * 
  * @author Robin Glattauer HEPHY, Wien
  *
  */
@@ -129,8 +281,7 @@ class ForwardTracking : public Processor {
    *    -# Read in all collections of hits on the FTD that are passed as steering parameters
    *    -# From every hit in these collections an FTDHit01 is created. This is, because the SegmentBuilder and the Automaton
    * need their own hit classes.
-   *    -# The hits are stored in the map _map_sector_hits. The keys in this map are the sectors and the values of the map are vectors
-   * of the hits within those sectors. Sector here means an integer somehow representing a place in the detector.
+   *    -# The hits are sorted into the SectorHitIndex of the EventContext. It gives for every sector the hits within it. Sector here means an integer somehow representing a place in the detector.
    * (For using this numbers and getting things like layer or side the class SectorSystemFTD is used.)
    *    -# Make a safety check to ensure no single sector is overflowing with hits. This could give a combinatorial
    * disaster leading to endless calculation times.
@@ -190,21 +341,116 @@ class ForwardTracking : public Processor {
   
  protected:
    
-   /**
-   * @return a map that links hits with overlapping hits on the petals behind
-   * 
-   * @param map_sector_hits a map with first= the sector number. second = the hits in the sector. 
+   /** Everything that belongs to a single event.
+    * 
+    * processEvent keeps all its per event state in a local EventContext and doesn't change the processor (except for
+    * the counters, that are summed up). The state shared by all events (sector system, criteria cut offs, fitter 
+    * configuration) is only set in init(). So one instance of the processor can process several events at once.
+    */
+   struct EventContext{
+      
+      /** @param nSectors the number of possible sectors
+       * 
+       * @param sectorSystemFTD the sector system of the hits
+       * 
+       * @param criteriaRounds the criteria of the Cellular Automaton, copied for every job
+       * 
+       * @param cacheTripletCircles whether the criteria of the jobs use the circle caches
+       */
+      EventContext( unsigned nSectors, const SectorSystemFTD* sectorSystemFTD, const KiTrackMarlin::CriteriaRounds& criteriaRounds,
+                    bool cacheTripletCircles );
+      
+      /** Destroys the created hits and tracks and gives the acquired track fitting systems back */
+      ~EventContext();
+      
+      EventContext( const EventContext& ) = delete;
+      EventContext& operator=( const EventContext& ) = delete;
+      
+      /** Destroys the created hits and tracks, gives the acquired track fitting systems back and resets the counters. 
+       * The memory of the containers and arenas is kept, so the context can be used for the next event. */
+      void clear();
+      
+      /** @return a track fitting system from the pool, that is given back when the event is done */
+      MarlinTrk::IMarlinTrkSystem* acquireTrkSystem( KiTrackMarlin::MarlinTrkSystemPool* trkSystemPool );
+      
+      /** Keeps a track fitting system acquired from the pool elsewhere and gives it back, when the event is done */
+      void holdTrkSystem( KiTrackMarlin::MarlinTrkSystemPool* trkSystemPool, MarlinTrk::IMarlinTrkSystem* trkSystem );
+      
+      /** The number of the event (counting the events processed by the processor) */
+      int eventNumber;
+      
+      /** The quality of the output track collection */
+      int quality;
+      
+      /** The number of track candidates from the Cellular Automaton in this event */
+      unsigned nTrackCandidates;
+      
+      /** The number of versions of the track candidates with hits from overlapping petals in this event */
+      unsigned nTrackCandidatesPlus;
+      
+      /** The times of the stages and the counters of this event */
+      KiTrackMarlin::TrackingStatistics statistics;
+      
+      /** The results of the fits of this event */
+      KiTrackMarlin::FitResultCache fitCache;
+      
+      /** All hits of the event: the ones created from the TrackerHits and the virtual IP hits */
+      std::vector< IHit* > hits;
+      
+      /** The arena of the hits created from the TrackerHits */
+      KiTrackMarlin::ObjectPool< FTDHit01 > hitPool;
+      
+      /** The arena of the virtual IP hits */
+      KiTrackMarlin::ObjectPool< FTDHitSimple > virtualHitPool;
+      
+      /** The arena of the track candidates. They all live until the end of the event, even the rejected ones. */
+      KiTrackMarlin::ObjectPool< KiTrackMarlin::FittedFTDTrack > trackPool;
+      
+      /** The hits sorted by their sectors */
+      KiTrackMarlin::SectorHitIndex sectorHitIndex;
+      
+      /** Finds the hits on overlapping petals */
+      KiTrackMarlin::OverlapHitGrid overlapHitGrid;
+      
+      /** The hits of the forward (0) and backward (1) side, when the sides are searched separately */
+      std::vector< IHit* > sideHits[2];
+      
+      /** The hits of the forward (0) and backward (1) side sorted by their sectors */
+      KiTrackMarlin::SectorHitIndex sideSectorHitIndex[2];
+      
+      /** The acquired track fitting systems and the pools they belong to */
+      std::vector< std::pair< KiTrackMarlin::MarlinTrkSystemPool* , MarlinTrk::IMarlinTrkSystem* > > trkSystems;
+      
+      /** The criteria of the Cellular Automaton for every job (the forward and backward side may be searched at 
+       * the same time, and the criteria can't be shared) */
+      KiTrackMarlin::CriteriaRounds jobCriteriaRounds[2];
+      
+      /** The circles through hit triplets for the criteria of every job */
+      KiTrackMarlin::TripletCircleCache jobCircleCaches[2];
+      
+      /** The time the event may take and the ways the search got cheaper to keep to it */
+      KiTrackMarlin::EventTimeBudget timeBudget;
+      
+   };
+   
+   /** @return an EventContext, that is not used by any other event: a free one or a new one */
+   EventContext* acquireEventContext();
+   
+   /** Clears the EventContext and keeps it for the next event */
+   void releaseEventContext( EventContext* context );
+   
+   /** @return a virtual hit in the place of the IP, created in the passed arena
    * 
-   * @param secSysFTD the SectorSystemFTD that is used
+   * @param side the side of the FTD (+1 forward, -1 backward)
    * 
-   * @param distMax the maximum distance of two hits. If two hits are on the right petals and their distance is smaller
-   * than this, the connection will be saved in the returned map.
+   * @param virtualHitPool the arena for the hit
    */
-   std::map< IHit* , std::vector< IHit* > > getOverlapConnectionMap( const std::map< int , std::vector< IHit* > > & map_sector_hits, 
-                                                                     const SectorSystemFTD* secSysFTD,
-                                                                     float distMax);
+   FTDHitSimple* createVirtualIPHit( int side , KiTrackMarlin::ObjectPool< FTDHitSimple >& virtualHitPool ) const;
    
-   /** Adds hits from overlapping areas to a RawTrack in every possible combination.
+   /** Adds hits from overlapping areas to a RawTrack in every possible combination. If MaxOverlapVersions is set,
+   * only the MaxOverlapVersions most promising combinations are created (see OverlapVersionEnumerator): hits
+   * failing the helix fit when added to the RawTrack are not used and neither are combinations failing it.
+   * The RawTrack itself is always kept (as the last version, if it isn't among the most promising ones).
    * 
    * @return all of the resulting RawTracks
    * 
@@ -212,37 +458,215 @@ class ForwardTracking : public Processor {
    * 
    * @param map_hitFront_hitsBack a map, where IHit* are the keys and the values are vectors of hits that
    * are in an overlapping region behind them.
+   * 
+   * @param fitCache the known helix fits (NULL = none)
+   * 
+   * @param statistics the helix fits done to judge the versions are added here
+   * 
+   * @param maxVersions the maximum number of versions, 0 = all combinations (MaxOverlapVersions, or less when the
+   * EventTimeBudget is used up). At most as many combinations get rejected, before the search stops.
+   */
+   std::vector < RawTrack > getRawTracksPlusOverlappingHits( RawTrack rawTrack , 
+                                                             const std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                             KiTrackMarlin::FitResultCache* fitCache,
+                                                             KiTrackMarlin::TrackingStatistics& statistics,
+                                                             int maxVersions ) const;
+   
+   /** Chooses the hits from overlapping areas for a RawTrack with a single Kalman fit of it: for every hit of the RawTrack
+   * the hit from the back with the smallest chi2 increment (at most OverlapChi2IncrementMax) is added.
+   * 
+   * @return whether the versions could be chosen. If not (the fit failed), rawTracksPlus is empty.
+   * 
+   * @param rawTrack a RawTrack (vector of IHit* ), we want to add hits from overlapping regions
+   * 
+   * @param map_hitFront_hitsBack a map, where IHit* are the keys and the values are vectors of hits that
+   * are in an overlapping region behind them.
+   * 
+   * @param trkSystem the IMarlinTrkSystem used for the Kalman fit
+   * 
+   * @param statistics the time and the fit are added here
+   * 
+   * @param rawTracksPlus here the versions get stored: the one with the chosen hits (if any) and then the RawTrack itself
+   */
+   bool getRawTracksPlusOverlappingHitsIncremental( const RawTrack& rawTrack , 
+                                                    const std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                    MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                                    KiTrackMarlin::TrackingStatistics& statistics,
+                                                    std::vector< RawTrack >& rawTracksPlus ) const;
+   
+   /** @return whether the helix fit of the hits has a chi2/Ndf not above HelixFitMax. Virtual hits are left out.
+   * If the fit is not possible (too few hits), true is returned.
+   * 
+   * @param fitCache the fit is looked up and stored here (NULL = no cache)
+   * 
+   * @param statistics the fit is counted here
+   */
+   bool passesHelixFit( const RawTrack& hits, KiTrackMarlin::FitResultCache* fitCache, KiTrackMarlin::TrackingStatistics& statistics ) const;
+   
+   /** @return the result of the helix fit of the hits. Virtual hits are left out.
+   * 
+   * @param hits the hits to fit
+   * 
+   * @param fitCache the fit is looked up and stored here (NULL = no cache)
+   * 
+   * @param statistics if not NULL, the time and the fit are added here
    */
-   std::vector < RawTrack > getRawTracksPlusOverlappingHits( RawTrack rawTrack , std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack );
+   KiTrackMarlin::FitResultCache::HelixResult getHelixResult( const RawTrack& hits, 
+                                                              KiTrackMarlin::FitResultCache* fitCache,
+                                                              KiTrackMarlin::TrackingStatistics* statistics ) const;
+   
+   /** @return whether the helix fit of a version of a raw track succeeds and passes HelixFitMax
+   * 
+   * @param chi2OverNdf here the chi2/Ndf of the helix fit gets stored, if it succeeds
+   */
+   bool passesHelixFitCut( const RawTrack& rawTrackPlus, 
+                           KiTrackMarlin::TrackingStatistics& statistics, 
+                           KiTrackMarlin::FitResultCache* fitCache,
+                           float& chi2OverNdf ) const;
+   
+   /** Fits a version of a raw track with the Kalman filter and applies Chi2ProbCut (without helix fit).
+   * 
+   * @return the track candidate (owned by the trackPool) or NULL, if it was rejected
+   */
+   ITrack* kalmanFitTrackCandidate( const RawTrack& rawTrackPlus,
+                                    MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                    KiTrackMarlin::ObjectPool< KiTrackMarlin::FittedFTDTrack >& trackPool,
+                                    KiTrackMarlin::TrackingStatistics& statistics,
+                                    KiTrackMarlin::FitResultCache* fitCache ) const;
+   
+   /** Fits a version of a raw track with the helix fit and the Kalman filter and applies the cuts.
+   * 
+   * @return the track candidate (owned by the trackPool) or NULL, if it was rejected
+   * 
+   * @param rawTrackPlus the hits of the version
+   * 
+   * @param trkSystem the IMarlinTrkSystem used for the Kalman fit
+   * 
+   * @param trackPool the arena the track candidate is created in
+   * 
+   * @param statistics the times and counters of the fits are added here
+   * 
+   * @param fitCache the results of fits of the same hits are taken from here, new ones are stored (NULL = no cache)
+   */
+   ITrack* fitTrackCandidate( const RawTrack& rawTrackPlus,
+                              MarlinTrk::IMarlinTrkSystem* trkSystem,
+                              KiTrackMarlin::ObjectPool< KiTrackMarlin::FittedFTDTrack >& trackPool,
+                              KiTrackMarlin::TrackingStatistics& statistics,
+                              KiTrackMarlin::FitResultCache* fitCache ) const;
+   
+   /** Creates all versions of a raw track with hits from overlapping petals, fits them and applies the helix and
+   * Kalman cuts.
+   * 
+   * Doesn't change the state of the processor, so it can be called for different raw tracks in parallel, as long
+   * as every thread uses its own trkSystem.
+   * 
+   * @return the accepted track candidates: only the best version, if TakeBestVersionOfTrack is set, else all 
+   * accepted versions (in the IncrementalOverlapFit mode at most one). They are owned by the trackPool.
+   * 
+   * @param rawTrack the raw track from the Cellular Automaton
+   * 
+   * @param map_hitFront_hitsBack the hits on overlapping petals, as returned by OverlapHitGrid::getOverlapConnectionMap
+   * 
+   * @param trkSystem the IMarlinTrkSystem used for the Kalman fit
+   * 
+   * @param trackPool the arena the track candidates are created in
+   * 
+   * @param statistics the times and counters of the versions and fits are added here
+   * 
+   * @param fitCache the results of fits of the same hits are taken from here, new ones are stored (NULL = no cache)
+   * 
+   * @param nVersions here the number of versions of the raw track is stored
+   * 
+   * @param otherVersions here the accepted versions, that were not taken because a better one was there, are stored.
+   * Their fits can't be released here: the fit cache may hand the same track to other raw tracks in other threads.
+   * 
+   * @param timeBudget the time budget of the event: once it is used up, the versions get capped
+   */
+   std::vector< ITrack* > getTrackCandidates( const RawTrack& rawTrack , 
+                                              const std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                              MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                              KiTrackMarlin::ObjectPool< KiTrackMarlin::FittedFTDTrack >& trackPool,
+                                              KiTrackMarlin::TrackingStatistics& statistics,
+                                              KiTrackMarlin::FitResultCache* fitCache,
+                                              unsigned& nVersions,
+                                              std::vector< ITrack* >& otherVersions,
+                                              KiTrackMarlin::EventTimeBudget& timeBudget ) const;
+   
+   /** Searches the tracks in the passed hits: Cellular Automaton, track candidates with hits from overlapping petals, 
+   * fits, cuts and the best subset.
+   * 
+   * Doesn't change the state of the processor, so it can be called for independent sets of hits in parallel, as long
+   * as every call gets its own criteriaRounds.
+   * 
+   * @return the best subset of tracks. They are owned by the trackPool.
+   * 
+   * @param sectorHitIndex the hits (including the virtual IP hits) sorted by their sectors
+   * 
+   * @param map_hitFront_hitsBack the hits on overlapping petals, as returned by OverlapHitGrid::getOverlapConnectionMap
+   * 
+   * @param trackPool the arena the track candidates are created in
+   * 
+   * @param criteriaRounds the criteria for the rounds of the Cellular Automaton
+   * 
+   * @param statistics the times and counters of the stages are added here
+   * 
+   * @param fitCache the results of the fits of the event (NULL = no cache)
+   * 
+   * @param trkSystems here the track fitting systems acquired for the fits get added (also if an exception is thrown).
+   * The kept fits of the tracks are bound to them, so the caller gives them back to the pool, when the tracks are finalised.
+   * 
+   * @param nTrackCandidates here the number of raw tracks from the Cellular Automaton is added
+   * 
+   * @param nTrackCandidatesPlus here the number of versions of the raw tracks with hits from overlapping petals is added
+   * 
+   * @param timeBudget the time budget of the event, checked between the stages (see EventTimeBudget)
+   */
+   std::vector< ITrack* > findTracks( const KiTrackMarlin::SectorHitIndex& sectorHitIndex, 
+                                      const std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                      KiTrackMarlin::ObjectPool< KiTrackMarlin::FittedFTDTrack >& trackPool,
+                                      const KiTrackMarlin::CriteriaRounds& criteriaRounds,
+                                      KiTrackMarlin::TrackingStatistics& statistics,
+                                      KiTrackMarlin::FitResultCache* fitCache,
+                                      std::vector< MarlinTrk::IMarlinTrkSystem* >& trkSystems,
+                                      unsigned& nTrackCandidates,
+                                      unsigned& nTrackCandidatesPlus,
+                                      KiTrackMarlin::EventTimeBudget& timeBudget ) const;
+   
+   /** Finds the best subset of the track candidates for every connected component of the conflict graph on its own
+   * (see SubsetComponents).
+   * 
+   * @param trackCandidates the track candidates
+   * 
+   * @param conflictGraph the conflicts of the track candidates
+   * 
+   * @param accepted here the accepted tracks get added, in the order of the track candidates
+   * 
+   * @param rejected here the rejected tracks get added, in the order of the track candidates
+   * 
+   * @param bestSubsetFinder the finder for the large components (SubsetHopfieldNN or SubsetSimple)
+   */
+   void getBestSubsetOfComponents( const std::vector< ITrack* >& trackCandidates,
+                                   const KiTrackMarlin::TrackConflictGraph& conflictGraph,
+                                   std::vector< ITrack* >& accepted,
+                                   std::vector< ITrack* >& rejected,
+                                   const std::string& bestSubsetFinder ) const;
    
    /** Finalises the track: fits it and adds TrackStates at IP, Calorimeter Face, inner- and outermost hit.
    * Sets the subdetector hit numbers and the radius of the innermost hit.
    * Also sets chi2 and Ndf.
    */
-   void finaliseTrack( TrackImpl* trackImpl );
+   void finaliseTrack( TrackImpl* trackImpl, MarlinTrk::IMarlinTrkSystem* trkSystem ) const;
    
-   /** Sets the cut off values for all the criteria
-    * 
-    * This method is necessary for cases where the CA just finds too much.
-    * Therefore it is possible to enter a whole list of cut off values for every criterion (for every min and every max to be more precise),
-    * that are then used one after the other. 
-    * If the CA finds way too many connections, we can thus make the cuts tighter and rerun it. If there are still too many
-    * connections, just tighten them again.
-    * 
-    * This method will set the according values. It will read the passed (as steering parameter) cut off values, create
-    * criteria from them and store them in the corresponding vectors.
-    * 
-    * If there are no new cut off values for a criterion, the last one remains.
-    * 
-    * @return whether any new cut off value was set. false == there are no new cutoff values anymore
-    * 
-    * @param round The number of the round we are in. I.e. the nth time we run the Cellular Automaton.
-    */
-   bool setCriteria( unsigned round );
+   /** Finalises the track like above, but takes the track states from an existing fit of the same hits.
+   */
+   void finaliseTrack( TrackImpl* trackImpl, Fitter& fitter ) const;
    
    
-   /** @return Info on the content of _map_sector_hits. Says how many hits are in each sector */
-   std::string getInfo_map_sector_hits();
+   /** @return Info on the content of the sectorHitIndex. Says how many hits are in each sector */
+   std::string getInfoSectorHits( const KiTrackMarlin::SectorHitIndex& sectorHitIndex ) const;
+   
+   /** @return a new empty Cellular Automaton: a CompactAutomaton or the KiTrack::Automaton (see CompactAutomaton) */
+   KiTrackMarlin::IAutomatonEngine* createAutomatonEngine() const;
    
    
    /** Input collection names */
@@ -253,7 +677,9 @@ class ForwardTracking : public Processor {
 
 
    int _nRun ;
-   int _nEvt ;
+   
+   /** counts the events; atomic, as events may be processed at the same time */
+   std::atomic< int > _nEvt ;
 
    /** B field in z direction */
    double _Bz;
@@ -273,14 +699,26 @@ class ForwardTracking : public Processor {
     * and the quality of the output track collection will be set to poor */
    int _maxHitsPerSector;
    
+   /** Whether sectors with too many hits are split into sub-sectors instead of being dropped */
+   bool _splitOverflowingSectors;
+   
+   /** How often an overflowing sector may be halved at most */
+   int _maxSectorSplitDepth;
+   
    
    // Properties for the Hopfield Neural Network
    double _HNN_Omega;
    double _HNN_ActivationThreshold;
    double _HNN_TInf;
    
-   /** A map to store the hits according to their sectors */
-   std::map< int , std::vector< IHit* > > _map_sector_hits;
+   /** Whether the best subset is searched for every group of conflicting tracks on its own */
+   bool _subsetComponents;
+   
+   /** The largest group of conflicting tracks, that is solved exactly */
+   int _subsetExactMaxSize;
+   
+   /** The number of threads used for the large groups of conflicting tracks */
+   int _subsetThreads;
    
    /** Names of the used criteria */
    std::vector< std::string > _criteriaNames;
@@ -294,17 +732,15 @@ class ForwardTracking : public Processor {
    /** Minimum number of hits a track has to have in order to be stored */
    int _hitsPerTrackMin;
    
-   /** A vector of criteria for 2 hits (2 1-hit segments) */
-   std::vector <ICriterion*> _crit2Vec;
-   
-   /** A vector of criteria for 3 hits (2 2-hit segments) */
-   std::vector <ICriterion*> _crit3Vec;
+   const SectorSystemFTD* _sectorSystemFTD;
    
-   /** A vector of criteria for 4 hits (2 3-hit segments) */
-   std::vector <ICriterion*> _crit4Vec;
+   /** The number of possible sectors of the _sectorSystemFTD */
+   unsigned _nSectors;
    
+   /** The EventContexts not used at the moment, kept for the next events */
+   std::vector< EventContext* > _freeEventContexts;
    
-   const SectorSystemFTD* _sectorSystemFTD;
+   std::mutex _eventContextMutex;
    
    
    bool _useCED;
@@ -321,23 +757,85 @@ class ForwardTracking : public Processor {
     * the automaton with tighter cuts or stop it entirely. */
    int _maxConnectionsAutomaton;
    
+   /** The criteria of all rounds of the Cellular Automaton, created in init. The EventContexts get copies of them. */
+   KiTrackMarlin::CriteriaRounds* _criteriaRounds;
+   
    /** The method used to find the best subset of tracks */
    std::string _bestSubsetFinder;
    
-   unsigned _nTrackCandidates;
-   unsigned _nTrackCandidatesPlus;
+   std::atomic< unsigned > _nTrackCandidates;
+   std::atomic< unsigned > _nTrackCandidatesPlus;
+   
+   /** The times and counters of all events */
+   KiTrackMarlin::TrackingStatisticsSummary _statisticsSummary;
+   
+   /** The CSV file the summary of the statistics is written to in end() */
+   std::string _statisticsFile;
+   
+   /** Whether the results of the fits are remembered in an event */
+   bool _useFitCache;
+   
+   /** Whether the saved tracks take their track states from the fit of the track candidate */
+   bool _reuseCandidateFit;
 
    
    
-   MarlinTrk::IMarlinTrkSystem* _trkSystem;
+   /** The track fitting systems: one for every thread, that fits tracks */
+   KiTrackMarlin::MarlinTrkSystemPool* _trkSystemPool;
 
    std::string _trkSystemName ;
+   
+   /** The number of threads used for fitting the track candidates */
+   int _nFitThreads;
+   
+   /** Whether the forward and backward side are searched as independent jobs at the same time */
+   bool _splitSides;
+   
+   /** Whether the connections of a round of the Automaton are filtered for the next round instead of made again */
+   bool _incrementalRounds;
+   
+   /** Whether the 2-hit criteria get a batched prefilter in the segment builder */
+   bool _batchedCrit2Prefilter;
+   
+   /** The maximum number of versions of a raw track with hits from overlapping petals, 0 = no limit */
+   int _maxOverlapVersions;
+   
+   /** The number of versions of a raw track with the best helix fit, that get Kalman fitted (0 = all) */
+   int _kalmanFitBestHelixVersions;
+   
+   /** Whether the hits from overlapping petals are chosen by their chi2 increment after a single fit of the raw track */
+   bool _incrementalOverlapFit;
+   
+   /** The maximum chi2 increment of a hit from an overlapping petal in the incremental mode */
+   double _overlapChi2IncrementMax;
+   
+   /** The time an event may take in ms, 0 = no limit */
+   double _eventTimeBudget;
+   
+   /** The maximum number of versions of a raw track with hits from overlapping petals, once the time budget is used up */
+   int _timeBudgetMaxOverlapVersions;
+   
+   /** Whether the first round of the Cellular Automaton is predicted from the occupancies of the sectors */
+   bool _predictFirstRound;
+   
+   /** The calibrated acceptances of the rounds for the prediction */
+   std::vector< float > _roundPredictorAcceptances;
+   
+   /** How many times MaxConnectionsAutomaton the predicted connections of a round must be, to skip it */
+   float _roundPredictorSafetyFactor;
+   
+   /** Predicts the first round of the Cellular Automaton, created in init (shared by all events) */
+   KiTrackMarlin::RoundPredictor* _roundPredictor;
+   
+   /** Whether the CompactAutomaton is used instead of the KiTrack::Automaton */
+   bool _compactAutomaton;
+   
+   /** Whether the criteria take the circles through hit triplets from a cache */
+   bool _cacheTripletCircles;
 
   bool _getTrackStateAtCaloFace ;
 
-   /** The quality of the output track collection */
-   int _output_track_col_quality ; 
-  
+   // The possible qualities of the output track collection
    static const int _output_track_col_quality_GOOD;
    static const int _output_track_col_quality_FAIR;
    static const int _output_track_col_quality_POOR;
@@ -0,0 +1,216 @@
+#ifndef HitStore_h
+#define HitStore_h
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "KiTrack/IHit.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** The positions of hits as a structure of arrays: x, y, z, r and the sector of every hit in their own
+    * contiguous arrays.
+    *
+    * The hits are read once through their virtual getters, when they are added. The geometric kernels then work on the
+    * arrays only: they have no branches and no calls in their loops, so the compiler can vectorise them. There are no
+    * intrinsics, the width of the vectors is the one the library is compiled for.
+    *
+    * The kernels work on a range [begin,end) of the hits. The selecting kernels write the indices of the selected hits
+    * into an array, that must have space for end - begin indices, and return how many they wrote. The selected
+    * indices are in ascending order.
+    *
+    * The memory is kept when the store is cleared, so it can be reused for the next event without allocating.
+    *
+    * @param RealT the type of the coordinates: float (the precision of IHit) or double
+    */
+   template< class RealT >
+   class HitStoreT{
+
+
+   public:
+
+      /** the type of the coordinates */
+      typedef RealT Real;
+
+      /** Removes all hits */
+      void clear(){
+
+         _hits.clear();
+         _x.clear();
+         _y.clear();
+         _z.clear();
+         _r.clear();
+         _sector.clear();
+
+      }
+
+      /** Reserves memory for nHits hits */
+      void reserve( unsigned nHits ){
+
+         _hits.reserve( nHits );
+         _x.reserve( nHits );
+         _y.reserve( nHits );
+         _z.reserve( nHits );
+         _r.reserve( nHits );
+         _sector.reserve( nHits );
+
+      }
+
+      /** Adds a hit behind the others */
+      void add( IHit* hit ){
+
+         Real x = hit->getX();
+         Real y = hit->getY();
+
+         _hits.push_back( hit );
+         _x.push_back( x );
+         _y.push_back( y );
+         _z.push_back( hit->getZ() );
+         _r.push_back( std::sqrt( x*x + y*y ) );
+         _sector.push_back( hit->getSector() );
+
+      }
+
+      /** Clears the store and adds the hits in their order */
+      void build( const std::vector< IHit* >& hits ){
+
+         clear();
+         reserve( hits.size() );
+
+         for( unsigned i=0; i < hits.size(); i++ ) add( hits[i] );
+
+      }
+
+      unsigned size() const { return _hits.size(); }
+
+      IHit* getHit( unsigned i ) const { return _hits[i]; }
+
+      Real getX( unsigned i ) const { return _x[i]; }
+      Real getY( unsigned i ) const { return _y[i]; }
+      Real getZ( unsigned i ) const { return _z[i]; }
+
+      /** @return the distance of the hit to the z axis */
+      Real getR( unsigned i ) const { return _r[i]; }
+
+      int getSector( unsigned i ) const { return _sector[i]; }
+
+
+
+      /** Calculates the squared distances of a point to the hits [begin,end)
+       *
+       * @param dist2 the output: dist2[ j - begin ] is the squared distance to hit j
+       */
+      void getDistances2( Real x, Real y, Real z, unsigned begin, unsigned end, Real* dist2 ) const{
+
+         const Real* xs = _x.data();
+         const Real* ys = _y.data();
+         const Real* zs = _z.data();
+
+         for( unsigned j = begin; j < end; j++ ){
+
+            Real dx = x - xs[j];
+            Real dy = y - ys[j];
+            Real dz = z - zs[j];
+
+            dist2[ j - begin ] = dx*dx + dy*dy + dz*dz;
+
+         }
+
+      }
+
+      /** Selects the hits of [begin,end), that are closer than sqrt( distMax2 ) to a point and behind it
+       * ( |z| of the hit bigger than |z| of the point ). This is the test for hits on overlapping petals.
+       */
+      unsigned selectCloseAndBehind( Real x, Real y, Real z, unsigned begin, unsigned end, Real distMax2, unsigned* selected ) const{
+
+         const Real* xs = _x.data();
+         const Real* ys = _y.data();
+         const Real* zs = _z.data();
+
+         Real absZ = std::fabs( z );
+         unsigned nSelected = 0;
+         unsigned char pass[ blockSize ];
+
+         for( unsigned blockBegin = begin; blockBegin < end; blockBegin += blockSize ){
+
+
+            unsigned n = std::min( blockSize, end - blockBegin );
+
+            for( unsigned j=0; j < n; j++ ){
+
+               Real dx = x - xs[ blockBegin + j ];
+               Real dy = y - ys[ blockBegin + j ];
+               Real dz = z - zs[ blockBegin + j ];
+
+               pass[j] = ( dx*dx + dy*dy + dz*dz < distMax2 ) & ( std::fabs( zs[ blockBegin + j ] ) > absZ );
+
+            }
+
+            nSelected += compact( pass, n, blockBegin, selected + nSelected );
+
+
+         }
+
+         return nSelected;
+
+      }
+
+      /** The selecting kernels test blocks of this many hits into a mask (this loop is vectorised) and then collect
+       * the indices of the passing hits. Kernels outside of the store can do the same.
+       */
+      static const unsigned blockSize = 64;
+
+      /** Writes first + j for every j in [0,n) with pass[j] into selected
+       *
+       * @return the number of written indices
+       */
+      static unsigned compact( const unsigned char* pass, unsigned n, unsigned first, unsigned* selected ){
+
+         unsigned nSelected = 0;
+
+         for( unsigned j=0; j < n; j++ ){
+
+            selected[ nSelected ] = first + j;
+            nSelected += pass[j];
+
+         }
+
+         return nSelected;
+
+      }
+
+
+   private:
+
+      std::vector< IHit* > _hits;
+
+      std::vector< Real > _x;
+      std::vector< Real > _y;
+      std::vector< Real > _z;
+      std::vector< Real > _r;
+      std::vector< int > _sector;
+
+   };
+
+   template< class RealT >
+   const unsigned HitStoreT< RealT >::blockSize;
+
+
+#ifdef HITSTORE_DOUBLE
+   /** The hit store with double precision coordinates (compiled with -DHITSTORE_DOUBLE) */
+   typedef HitStoreT< double > HitStore;
+#else
+   /** The hit store with the precision of IHit */
+   typedef HitStoreT< float > HitStore;
+#endif
+
+
+}
+
+
+#endif
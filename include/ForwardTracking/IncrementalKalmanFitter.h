@@ -0,0 +1,85 @@
+#ifndef IncrementalKalmanFitter_h
+#define IncrementalKalmanFitter_h
+
+#include <vector>
+
+#include "EVENT/TrackerHit.h"
+#include "MarlinTrk/IMarlinTrkSystem.h"
+#include "MarlinTrk/IMarlinTrack.h"
+
+#include "KiTrack/IHit.h"
+#include "Tools/Fitter.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** Fits a track once with the Kalman filter and then tells for single additional hits, by how much they
+    * would increase the chi2, without fitting again.
+    *
+    * This is meant to judge hits from overlapping petals: instead of fitting every version of a track,
+    * the track is fitted once and every overlapping hit is tested against the fitted state. The test is a single
+    * filter step from the last site of the fit (the innermost hit), so it is an estimate: only the versions chosen with it
+    * should get a full fit.
+    *
+    * Virtual hits are left out. An IMarlinTrkSystem must only be used by one thread at a time and must live as long
+    * as the fitter.
+    */
+   class IncrementalKalmanFitter{
+
+
+   public:
+
+      /** Fits the hits.
+       *
+       * @param hits the hits of the track, in any order. They have to be IFTDHits.
+       *
+       * @param trkSystem the system used for fitting
+       *
+       * Throws a FitterException, if the fit fails
+       */
+      IncrementalKalmanFitter( const std::vector< IHit* >& hits, MarlinTrk::IMarlinTrkSystem* trkSystem ) throw( FitterException );
+
+      ~IncrementalKalmanFitter();
+
+      IncrementalKalmanFitter( const IncrementalKalmanFitter& ) = delete;
+      IncrementalKalmanFitter& operator=( const IncrementalKalmanFitter& ) = delete;
+
+      /** @return the chi2 of the fit */
+      double getChi2() const { return _chi2; }
+
+      /** @return the degrees of freedom of the fit */
+      int getNdf() const { return _ndf; }
+
+      /** @return whether the chi2 increment of the hit could be calculated
+       *
+       * @param hit an additional hit (not yet part of the track). It has to be an IFTDHit.
+       *
+       * @param chi2Increment here the increase of the chi2, if the hit was added, gets stored. For a hit made of two
+       * strips it is the sum of both.
+       */
+      bool getChi2Increment( IHit* hit, double& chi2Increment );
+
+
+   private:
+
+      /** @return the TrackerHits, that are added to the MarlinTrack for the hit: the strips of a composite spacepoint
+       * or the hit itself.
+       */
+      static std::vector< EVENT::TrackerHit* > getMeasurements( EVENT::TrackerHit* trackerHit );
+
+      MarlinTrk::IMarlinTrack* _marlinTrk;
+
+      double _chi2;
+
+      int _ndf;
+
+   };
+
+
+}
+
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef MarlinTrkSystemPool_h
+#define MarlinTrkSystemPool_h
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MarlinTrk/IMarlinTrkSystem.h"
+
+
+namespace KiTrackMarlin{
+
+
+   /** The IMarlinTrkSystems used for fitting, of the same type and configuration.
+    *
+    * An IMarlinTrkSystem must not be used by two threads at the same time. So every thread that fits
+    * tracks acquires a system from the pool and gives it back, when it is done.
+    *
+    * The MarlinTrk::Factory however creates only one system per type and hands out that same system on every call
+    * (and owns it). Until there is a way to create independent systems, the pool has just this one: all users
+    * get the same system, so only one of them may fit at a time (see getMaxConcurrentUsers()).
+    */
+   class MarlinTrkSystemPool{
+
+
+   public:
+
+      /** @param systemName the name of the track fitting system passed to the MarlinTrk::Factory ( DDKalTest, aidaTT, ... )
+       *
+       * @param MSOn whether to use multiple scattering in the fit
+       *
+       * @param ElossOn whether to use energy loss in the fit
+       *
+       * @param SmoothOn whether to smooth all measurement sites in the fit
+       */
+      MarlinTrkSystemPool( const std::string& systemName, bool MSOn, bool ElossOn, bool SmoothOn );
+
+      /** Doesn't delete the system: it belongs to the MarlinTrk::Factory */
+      ~MarlinTrkSystemPool(){}
+
+      MarlinTrkSystemPool( const MarlinTrkSystemPool& ) = delete;
+      MarlinTrkSystemPool& operator=( const MarlinTrkSystemPool& ) = delete;
+
+      /** Makes sure, there are systems for n users fitting at the same time, so they don't have to be created while
+       * processing events. Throws an EVENT::Exception, if n > getMaxConcurrentUsers().
+       */
+      void reserve( unsigned n );
+
+      /** @return a system to fit with, until it is released again. All users get the same one. */
+      MarlinTrk::IMarlinTrkSystem* acquire();
+
+      /** Gives a system back to the pool */
+      void release( MarlinTrk::IMarlinTrkSystem* trkSystem );
+
+      /** @return the number of users, that may fit at the same time with the systems of the pool */
+      unsigned getMaxConcurrentUsers() const { return 1; }
+
+      /** @return the number of systems created so far */
+      unsigned size() const;
+
+
+   private:
+
+      /** Gets the system from the MarlinTrk::Factory and initialises it (the mutex is locked). Throws an EVENT::Exception
+       * if that is not possible */
+      MarlinTrk::IMarlinTrkSystem* getTrkSystem();
+
+      std::string _systemName;
+      bool _MSOn;
+      bool _ElossOn;
+      bool _SmoothOn;
+
+      /** the system of the MarlinTrk::Factory, NULL until it is first needed */
+      MarlinTrk::IMarlinTrkSystem* _trkSystem;
+
+      mutable std::mutex _mutex;
+
+   };
+
+
+}
+
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef ObjectPool_h
+#define ObjectPool_h
+
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace KiTrackMarlin{
+
+
+   /** An arena for objects of type T, that all live until the arena is cleared.
+    *
+    * The objects are constructed in blocks of memory, that are allocated when needed. clear() destroys all the objects
+    * in one go, but keeps the blocks, so when the arena is used again (for example for the next event), no memory
+    * needs to be allocated anymore.
+    *
+    * The objects must not be deleted by anybody else. Creating objects is thread safe.
+    */
+   template< class T >
+   class ObjectPool{
+
+
+   public:
+
+      /** @param blockSize the number of objects, that fit in one block of memory */
+      ObjectPool( unsigned blockSize = 256 ): _blockSize( blockSize ), _nObjects( 0 ){}
+
+      /** Destroys all objects and frees the memory */
+      ~ObjectPool(){
+
+         clear();
+         for( unsigned i=0; i < _blocks.size(); i++ ) delete[] _blocks[i];
+
+      }
+
+      ObjectPool( const ObjectPool& ) = delete;
+      ObjectPool& operator=( const ObjectPool& ) = delete;
+
+      /** @return a new object of type T, constructed with the passed arguments. It lives until clear() is called. */
+      template< class... Args >
+      T* create( Args&&... args ){
+
+         std::lock_guard< std::mutex > lock( _mutex );
+
+         unsigned iBlock = _nObjects / _blockSize;
+         if( iBlock == _blocks.size() ) _blocks.push_back( new Storage[ _blockSize ] );
+
+         T* object = new( &_blocks[ iBlock ][ _nObjects % _blockSize ] ) T( std::forward< Args >( args )... );
+         _nObjects++; // only count it, when the constructor didn't throw
+
+         return object;
+
+      }
+
+      /** Destroys all objects (the last created first). The memory is kept for new objects. */
+      void clear(){
+
+         std::lock_guard< std::mutex > lock( _mutex );
+
+         while( _nObjects > 0 ){
+
+            _nObjects--;
+            reinterpret_cast< T* >( &_blocks[ _nObjects / _blockSize ][ _nObjects % _blockSize ] )->~T();
+
+         }
+
+      }
+
+      /** @return the number of objects in the arena */
+      unsigned size() const{
+
+         std::lock_guard< std::mutex > lock( _mutex );
+         return _nObjects;
+
+      }
+
+
+   private:
+
+      typedef typename std::aligned_storage< sizeof( T ), alignof( T ) >::type Storage;
+
+      unsigned _blockSize;
+
+      unsigned _nObjects;
+
+      std::vector< Storage* > _blocks;
+
+      mutable std::mutex _mutex;
+
+   };
+
+
+}
+
+
+#endif
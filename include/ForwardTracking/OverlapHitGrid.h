@@ -0,0 +1,104 @@
+#ifndef OverlapHitGrid_h
+#define OverlapHitGrid_h
+
+#include <map>
+#include <vector>
+
+#include "KiTrack/IHit.h"
+#include "ILDImpl/SectorSystemFTD.h"
+
+#include "SectorHitIndex.h"
+#include "HitStore.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** Finds hits on overlapping petals of the FTD, that are so close to each other, that they could be from the same track.
+    *
+    * For every hit A the hits B are searched, that are
+    * - on a neighbouring petal (as given by the FTDNeighborPetalSecCon),
+    * - closer than distMax to A and
+    * - behind A ( |z| of B is bigger than |z| of A )
+    *
+    * Neighbouring petals are always on the same disk (side and layer). So the hits of every disk are put into
+    * a uniform grid in (x,y) with a cell size of at least distMax. The hits closer than distMax can then only be in the
+    * same or one of the 8 neighbouring cells, so not every pair of hits on neighbouring petals has to be compared.
+    * The distances are compared squared. The hits of a disk are kept in a HitStore in the order of the cells, so the
+    * 3 neighbouring cells of a row are one range of hits, that is tested by a vectorised kernel.
+    *
+    * The buffers are kept, so an OverlapHitGrid can be reused for the next event without allocating memory.
+    */
+   class OverlapHitGrid{
+
+
+   public:
+
+      /** @param sectorSystemFTD the sector system of the hits */
+      OverlapHitGrid( const SectorSystemFTD* sectorSystemFTD );
+
+      /** @return a map with the hits A as keys and the hits B behind them as values. The hits B of a hit A are sorted
+       * by their position in the sectorHitIndex (i.e. by sector and then in the order they were added to the index).
+       * Virtual hits are ignored.
+       *
+       * @param sectorHitIndex the hits
+       *
+       * @param distMax the maximum distance between the hits
+       */
+      std::map< IHit* , std::vector< IHit* > > getOverlapConnectionMap( const SectorHitIndex& sectorHitIndex, float distMax );
+
+      /** The same as getOverlapConnectionMap, but comparing every hit with every hit on the neighbouring petals.
+       * Much slower for many hits, but useful as a reference.
+       */
+      std::map< IHit* , std::vector< IHit* > > getOverlapConnectionMapAllPairs( const SectorHitIndex& sectorHitIndex, float distMax );
+
+
+   private:
+
+      /** @return the sectors of the petals neighbouring the sector, sorted */
+      const std::vector< int >& getNeighbourSectors( int sector );
+
+      /** @return whether hit B is close enough to hit A and behind it */
+      static bool areOverlapping( IHit* hitA, IHit* hitB, float distMax2 );
+
+      const SectorSystemFTD* _sectorSystemFTD;
+
+      /** the neighbouring sectors of every sector, filled when first needed */
+      std::vector< std::vector< int > > _neighbourSectors;
+      std::vector< bool > _neighbourSectorsKnown;
+
+
+      /** A hit put into the grid */
+      struct GridHit{
+
+         /** the position of the hit in the sectorHitIndex */
+         unsigned position;
+
+         int sector;
+
+         float x;
+         float y;
+
+         /** the cell of the hit */
+         unsigned cell;
+
+      };
+
+      // buffers, reused for every disk and every event
+      std::vector< GridHit > _diskHits;
+      std::vector< GridHit > _cellHits;
+      HitStore _cellStore; // the same hits as _cellHits in the same order
+      std::vector< unsigned > _selected;
+      std::vector< unsigned > _cellOffsets;
+      std::vector< unsigned > _nextPosition;
+      std::vector< unsigned > _matches;
+
+   };
+
+
+}
+
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef OverlapVersionEnumerator_h
+#define OverlapVersionEnumerator_h
+
+#include <map>
+#include <queue>
+#include <vector>
+
+#include "KiTrack/IHit.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** Enumerates the versions of a raw track with hits from overlapping petals, the most promising version first.
+    *
+    * Every hit of the raw track, that has hits on an overlapping petal behind it, is a choice: add none of them or
+    * exactly one. Instead of creating all combinations (their number is the product of the number of choices and
+    * explodes on busy petals), the versions are created one by one when asked for.
+    *
+    * Every choice gets a cost: a hit from an overlapping petal costs its distance in (x,y) to the circle through the
+    * raw track, adding none costs skipCost. The versions come in the order of their summed costs, so the first
+    * version is the one with the hits closest to the circle. (As choices are independent, the next version is always
+    * one of the already created versions with one choice changed to its next worse option. These candidates are kept
+    * in a priority queue.)
+    */
+   class OverlapVersionEnumerator{
+
+
+   public:
+
+      /**
+       * @param rawTrack the hits of the track
+       *
+       * @param map_hitFront_hitsBack the hits on overlapping petals behind the hits, as from OverlapHitGrid::getOverlapConnectionMap
+       *
+       * @param skipCost the cost of not adding any of the hits behind a hit
+       */
+      OverlapVersionEnumerator( const std::vector< IHit* >& rawTrack,
+                                const std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                float skipCost );
+
+      /** Removes all hits behind the hits of the track, that the passed function doesn't accept. Must be called before
+       * the first call of next().
+       *
+       * @param accept gets the raw track and a hit behind one of its hits, returns whether this hit may be added
+       */
+      template< class Accept >
+      void filterOverlapHits( Accept accept ){
+
+         for( unsigned i=0; i < _choices.size(); i++ ){
+
+            std::vector< Option >& options = _choices[i];
+            std::vector< Option > kept;
+
+            for( unsigned j=0; j < options.size(); j++ ){
+
+               if( ( options[j].hit == NULL ) || accept( _rawTrack, options[j].hit ) ) kept.push_back( options[j] );
+
+            }
+
+            options.swap( kept );
+
+         }
+
+         removeTrivialChoices();
+
+      }
+
+      /** Creates the next version of the track.
+       *
+       * @return false, if there are no more versions
+       *
+       * @param version here the version gets stored: the hits of the raw track plus the added hits
+       */
+      bool next( std::vector< IHit* >& version );
+
+      /** Creates the next version of the track, that the passed function accepts. Versions with only one added hit
+       * are taken as they are (they are judged by filterOverlapHits()), only the combinations of added hits get
+       * judged. As adding more hits doesn't make a rejected combination any better, versions containing all the
+       * added hits of a rejected one are rejected right away, without asking.
+       *
+       * @return false, if there are no more versions or maxRejected versions were rejected (0 = no limit)
+       *
+       * @param version here the version gets stored: the hits of the raw track plus the added hits
+       *
+       * @param accept gets a version, returns whether to keep it
+       */
+      template< class Accept >
+      bool next( std::vector< IHit* >& version, Accept accept, unsigned maxRejected ){
+
+         start();
+
+         while( !_queue.empty() ){
+
+            if( ( maxRejected > 0 ) && ( _nRejected >= maxRejected ) ) return false;
+
+            Version best = _queue.top();
+            _queue.pop();
+
+            pushSuccessors( best );
+            getHits( best, version );
+
+            if( getNumberOfAddedHits( best ) < 2 ) return true;
+
+            if( !containsRejected( best ) ){
+
+               if( accept( version ) ) return true;
+
+               _rejected.push_back( best );
+
+            }
+
+            _nRejected++;
+
+         }
+
+         return false;
+
+      }
+
+      /** @return the number of versions rejected by next( version, accept, maxRejected ) so far */
+      unsigned getNumberOfRejectedVersions() const { return _nRejected; }
+
+      /** @return the number of all possible versions (could be a big number) */
+      double getNumberOfPossibleVersions() const;
+
+
+   private:
+
+      /** One way to decide for a hit of the track: a hit behind it or none (hit == NULL) */
+      struct Option{
+
+         IHit* hit;
+         float cost;
+
+      };
+
+      /** A version: which option was taken for every choice */
+      struct Version{
+
+         float cost;
+
+         std::vector< unsigned > optionIndices;
+
+         /** Only choices from here on may be changed to create new versions, so every version is created once */
+         unsigned firstChangeable;
+
+         bool operator<( const Version& other ) const { return cost > other.cost; } // the cheapest on top of the queue
+
+      };
+
+      /** Removes choices, where only the option to add no hit is left, and sorts the options by their cost */
+      void removeTrivialChoices();
+
+      /** Puts the cheapest version into the queue, when called the first time */
+      void start();
+
+      /** Puts the versions into the queue, that differ from the passed one in one choice */
+      void pushSuccessors( const Version& version );
+
+      /** Stores the hits of the raw track plus the added hits of the version in hits */
+      void getHits( const Version& version, std::vector< IHit* >& hits ) const;
+
+      unsigned getNumberOfAddedHits( const Version& version ) const;
+
+      /** @return whether the version adds all the hits of a rejected version (and maybe more) */
+      bool containsRejected( const Version& version ) const;
+
+      std::vector< IHit* > _rawTrack;
+
+      /** For every hit of the track with hits behind it: the options, sorted by their cost */
+      std::vector< std::vector< Option > > _choices;
+
+      std::priority_queue< Version > _queue;
+
+      /** The versions rejected by the accept function of next( version, accept, maxRejected ) */
+      std::vector< Version > _rejected;
+
+      unsigned _nRejected;
+
+      bool _started;
+
+   };
+
+
+}
+
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef ParallelFor_h
+#define ParallelFor_h
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace KiTrackMarlin{
+
+
+   /** A small fork-join thread pool: calls func( iThread , iItem ) for every item in [0,nItems).
+    *
+    * The items are handed out one after the other to the threads, so expensive items do not block the others.
+    * The calling thread works as thread 0, so for nThreads <= 1 everything is done in the calling thread
+    * in the order of the items.
+    *
+    * iThread is always smaller than nThreads and no two threads run with the same iThread at the same time.
+    * So it can be used to index resources, that must not be shared between threads (like an IMarlinTrkSystem).
+    *
+    * If func throws, no further items are handed out and the first exception is rethrown in the calling thread,
+    * once all threads are finished.
+    */
+   template< class Func >
+   void parallelFor( unsigned nThreads, unsigned nItems, Func func ){
+
+
+      if( nThreads > nItems ) nThreads = nItems;
+
+      if( nThreads <= 1 ){
+
+         for( unsigned i=0; i < nItems; i++ ) func( 0, i );
+         return;
+
+      }
+
+
+      std::atomic< unsigned > nextItem( 0 );
+      std::exception_ptr error;
+      std::mutex errorMutex;
+
+      auto work = [&]( unsigned iThread ){
+
+         try{
+
+            for( unsigned i = nextItem++; i < nItems; i = nextItem++ ) func( iThread, i );
+
+         }
+         catch( ... ){
+
+            std::lock_guard< std::mutex > lock( errorMutex );
+            if( !error ) error = std::current_exception();
+            nextItem = nItems; // let the other threads stop
+
+         }
+
+      };
+
+
+      std::vector< std::thread > threads;
+      for( unsigned iThread=1; iThread < nThreads; iThread++ ) threads.push_back( std::thread( work, iThread ) );
+
+      work( 0 );
+
+      for( unsigned i=0; i < threads.size(); i++ ) threads[i].join();
+
+      if( error ) std::rethrow_exception( error );
+
+   }
+
+
+}
+
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef RoundPredictor_h
+#define RoundPredictor_h
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace KiTrackMarlin{
+
+
+   /** Predicts the first round of the Cellular Automaton, that will not have too many connections, before any segment
+    * is built.
+    *
+    * The number of pairs of hits in connected sectors (see SectorIndexSegmentBuilder::getNumberOfPairs) only depends on
+    * the occupancies of the sectors and the sector connectors. The criteria of a round accept a fraction of them, the
+    * acceptance of the round, which is roughly the same from event to event. So the connections of a round are predicted
+    * as pairs * acceptance.
+    *
+    * Only calibrated acceptances, given from an earlier run, are used for the prediction, so it doesn't depend on the
+    * events seen before. A round is skipped, if its predicted connections exceed the limit by more than the safety factor:
+    * as the acceptance varies from event to event, a round only a bit over the limit is rather built and checked.
+    * A round without a given acceptance is never skipped.
+    *
+    * The acceptances of the built rounds are measured in every event and collected in a histogram, to print the line
+    * to calibrate the next run with: the upper quantile (calibrationQuantile) of the measured acceptances of a round.
+    * A round stopped at the limit only gives a lower bound (the limit over the pairs), that goes in as it is. Rounds, that
+    * are never built, keep their given acceptance.
+    *
+    * Every round built with a given acceptance checks the prediction: it was right, if the round was predicted to stay
+    * under the limit and did, or was predicted to exceed it and did.
+    *
+    * Rounds skipped by predictFirstRound() are never built, so their predictions are never checked: the rate of right
+    * predictions doesn't include them and can't show rounds that were skipped without need.
+    *
+    * Thread safe.
+    */
+   class RoundPredictor{
+
+
+   public:
+
+      /** @param nRounds the number of rounds
+       *
+       * @param acceptances the calibrated acceptances of the rounds. Rounds beyond the passed values or with a negative one
+       * are never skipped.
+       *
+       * @param safetyFactor how many times the limit of the connections the predicted connections of a round must be,
+       * to skip it (at least 1)
+       */
+      RoundPredictor( unsigned nRounds, const std::vector< float >& acceptances, double safetyFactor );
+
+      /** @return the predicted number of connections of the round, or a negative number if its acceptance isn't given */
+      double predictConnections( unsigned round, double nPairs ) const;
+
+      /** @return the first round not predicted to have more than safetyFactor * maxConnections connections (the last
+       * round, if none)
+       */
+      unsigned predictFirstRound( double nPairs, unsigned maxConnections ) const;
+
+      /** Records the connections of a built round: checks the prediction and measures the acceptance
+       *
+       * @param nPairs the pairs of hits in connected sectors
+       *
+       * @param nConnections the connections the round actually had
+       *
+       * @param complete whether nConnections are all connections of the round. If the building stopped at the limit,
+       * the measured acceptance is only a lower bound.
+       */
+      void record( unsigned round, double nPairs, unsigned nConnections, unsigned maxConnections, bool complete = true );
+
+      /** @return the acceptances to calibrate the next run with: the upper quantile of the measured ones and where there
+       * are none the given ones (-1 for rounds with neither) */
+      std::vector< float > getAcceptances() const;
+
+      /** @return the number of built rounds, whose prediction got checked (skipped rounds are not included) */
+      unsigned getNumberOfPredictions() const;
+
+      /** @return the number of right predictions */
+      unsigned getNumberOfRightPredictions() const;
+
+      /** @return a report of the acceptances and the predictions */
+      std::string getInfo() const;
+
+      /** The quantile of the measured acceptances, that is printed for the calibration */
+      static const double calibrationQuantile;
+
+
+   private:
+
+      /** @return the bin of the acceptance in the histograms */
+      static unsigned getBin( double acceptance );
+
+      /** @return the upper edge of the bin */
+      static double getBinUpperEdge( unsigned bin );
+
+      /** @return the calibrationQuantile of the measured acceptances of the round, or a negative number if there are none
+       * (the mutex is locked) */
+      double getMeasuredAcceptance( unsigned round ) const;
+
+      /** The calibrated acceptances (negative = not given) */
+      std::vector< double > _givenAcceptances;
+
+      double _safetyFactor;
+
+      /** For every round the histogram of the measured acceptances: bins equally wide in log10( acceptance ) from
+       * 10^-nDecades to 1, bin 0 takes everything below */
+      std::vector< std::vector< unsigned > > _histograms;
+
+      std::vector< unsigned > _nMeasured;
+      std::vector< unsigned > _nIncomplete;
+
+      std::vector< unsigned > _nPredictions;
+      std::vector< unsigned > _nRightPredictions;
+
+      static const unsigned nDecades = 8;
+      static const unsigned nBinsPerDecade = 20;
+
+      mutable std::mutex _mutex;
+
+   };
+
+
+}
+
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef SectorHitIndex_h
+#define SectorHitIndex_h
+
+#include <vector>
+
+#include "KiTrack/IHit.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** An index of hits sorted by their sectors.
+    *
+    * The hits of all sectors are stored in one contiguous array, the hits of a sector one after the other
+    * (in the order they were passed). A table of offsets, with one entry for every possible sector, tells where the
+    * hits of a sector start. The index is built in two passes: first the hits per sector are counted, then they are
+    * put into their place.
+    *
+    * The memory is kept when the index is built again, so after the first few events no more allocations are needed.
+    *
+    * This replaces a std::map< int , std::vector< IHit* > > with the sectors as keys.
+    */
+   class SectorHitIndex{
+
+
+   public:
+
+      /** @param nSectors the number of possible sectors: all sectors have to be in [0,nSectors) */
+      SectorHitIndex( unsigned nSectors = 0 );
+
+      /** Sets the number of possible sectors. Clears the index. */
+      void setNumberOfSectors( unsigned nSectors );
+
+      /** Clears the index and fills it with the passed hits. Throws an std::out_of_range, if a hit has a sector outside
+       * of [0,nSectors).
+       */
+      void build( const std::vector< IHit* >& hits );
+
+      /** Removes all the hits of the sector from the index */
+      void dropSector( int sector );
+
+      /** Sorts the hits of the sector by their distance to the z axis (the smallest first) */
+      void sortSectorByRadius( int sector );
+
+      /** @return the number of possible sectors */
+      unsigned getNumberOfSectors() const { return _nHitsInSector.size(); }
+
+      /** @return the number of hits in the index */
+      unsigned getNumberOfHits() const;
+
+      /** @return the number of hits in the sector, 0 for a sector outside of [0,nSectors) */
+      unsigned getNumberOfHits( int sector ) const;
+
+      /** @return the position of the first hit of the sector in the contiguous array of all hits */
+      unsigned getOffset( int sector ) const { return _offsets[ sector ]; }
+
+      /** @return a pointer to the first hit of the sector. The hits of the sector follow it. */
+      IHit* const* beginHits( int sector ) const { return _hits.data() + _offsets[ sector ]; }
+
+      /** @return a pointer behind the last hit of the sector */
+      IHit* const* endHits( int sector ) const { return beginHits( sector ) + _nHitsInSector[ sector ]; }
+
+      /** @return the hits of the sector (as a copy) */
+      std::vector< IHit* > getHits( int sector ) const;
+
+      /** @return the contiguous array of all hits (including the ones of dropped sectors) */
+      const std::vector< IHit* >& getAllHits() const { return _hits; }
+
+      /** @return the sectors with at least one hit in ascending order */
+      const std::vector< int >& getOccupiedSectors() const { return _occupiedSectors; }
+
+
+   private:
+
+      /** all hits, sorted by sector */
+      std::vector< IHit* > _hits;
+
+      /** the position of the first hit of every sector in _hits */
+      std::vector< unsigned > _offsets;
+
+      /** the number of hits in every sector */
+      std::vector< unsigned > _nHitsInSector;
+
+      /** the next free position of every sector, used while filling */
+      std::vector< unsigned > _nextPosition;
+
+      std::vector< int > _occupiedSectors;
+
+   };
+
+
+}
+
+
+#endif
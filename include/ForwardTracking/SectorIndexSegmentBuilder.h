@@ -0,0 +1,206 @@
+#ifndef SectorIndexSegmentBuilder_h
+#define SectorIndexSegmentBuilder_h
+
+#include <utility>
+#include <vector>
+
+#include "KiTrack/ISectorConnector.h"
+#include "Criteria/ICriterion.h"
+
+#include "SectorHitIndex.h"
+#include "HitStore.h"
+#include "Crit2Prefilter.h"
+#include "AutomatonEngine.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** Builds the 1-segments and their connections from the hits in a SectorHitIndex.
+    *
+    * Does the same as the KiTrack::SegmentBuilder: every hit becomes a 1-segment with the layer of the hit.
+    * A segment gets connected to the segments in the sectors, that the sector connectors allow, if all criteria
+    * are fulfilled. The segment from the sector we come from is the parent, the one from the target sector the child.
+    * The segments and connections go into an IAutomatonEngine, so any engine of the Cellular Automaton can be filled.
+    *
+    * But instead of copying and walking a std::map of the sectors and their hits, it uses the contiguous arrays
+    * of the SectorHitIndex. The segments are kept in an array parallel to the hits, so no map from hits to
+    * segments is needed either.
+    *
+    * If asked to, the builder remembers the connections it made. When the Automaton has to be built again with
+    * tighter criteria (that only allow a subset of the connections allowed before), the remembered connections
+    * can be filtered with the new criteria, instead of testing all pairs of hits in connected sectors again.
+    *
+    * With a Crit2Prefilter, the pairs of hits in connected sectors are first tested in blocks: one hit against all hits
+    * of the target sector. Only the pairs passing it are tested by the criteria.
+    *
+    * Sectors with too many hits can be split into sub-sectors: the hits of the sector are halved again and again by
+    * their position in the index. If they are sorted by radius (SectorHitIndex::sortSectorByRadius), the sub-sectors
+    * are rings, and only the sub-sectors with radii, that can pass the cut on Crit2_DeltaRho, are connected. As this
+    * only skips pairs the criterion would reject, the connections are the same.
+    *
+    * With a maximum number of connections, the builder stops as soon as it is exceeded: the Automaton is then
+    * incomplete and only good to see, that there are too many connections. So a round of the Cellular Automaton, that
+    * gets rejected for too many connections, doesn't pay for the whole build.
+    */
+   class SectorIndexSegmentBuilder{
+
+
+   public:
+
+      /** @param sectorHitIndex the hits. It has to stay unchanged, while the builder is used. */
+      SectorIndexSegmentBuilder( const SectorHitIndex& sectorHitIndex );
+
+      /** Adds a criterion. */
+      void addCriterion( ICriterion* criterion ){ _criteria.push_back( criterion ); }
+
+      /** Adds criteria */
+      void addCriteria( const std::vector< ICriterion* >& criteria ){ _criteria.insert( _criteria.end(), criteria.begin(), criteria.end() ); }
+
+      /** Removes all criteria, the prefilter and the cuts for the sub-sectors (the sector connectors stay) */
+      void clearCriteria(){ _criteria.clear(); _prefilter = NULL; _subSectorCuts = NULL; }
+
+      /** Sets a prefilter for the criteria. It must not be tighter than the criteria, like the one of CriteriaRounds
+       * for the criteria of the same round. NULL means no prefilter.
+       */
+      void setPrefilter( const Crit2Prefilter* prefilter ){ _prefilter = prefilter; }
+
+      /** Splits sectors with more than maxHits hits into sub-sectors (see above)
+       *
+       * @param maxHits the maximum number of hits of a sub-sector, 0 means the sectors are not split
+       *
+       * @param maxDepth how often a sector may be halved at most
+       */
+      void setSectorSplitting( unsigned maxHits, unsigned maxDepth ){ _maxHitsPerSubSector = maxHits; _maxSplitDepth = maxDepth; }
+
+      /** Sets the cuts deciding which sub-sectors get connected. They must not be tighter than the criteria, like the
+       * Crit2Prefilter of CriteriaRounds for the criteria of the same round. NULL means all are connected.
+       */
+      void setSubSectorCuts( const Crit2Prefilter* cuts ){ _subSectorCuts = cuts; }
+
+      /** Adds a sector connector. The target sectors of all sector connectors are used. */
+      void addSectorConnector( ISectorConnector* connector ){ _sectorConnectors.push_back( connector ); }
+
+      /** Sets the number of connections, after which get1SegAutomaton() and get1SegAutomatonFiltered() stop
+       * (0 = no limit, the default). When they stop, the Automaton has maxConnections + 1 connections and the
+       * remembered connections are forgotten.
+       */
+      void setMaxConnections( unsigned maxConnections ){ _maxConnections = maxConnections; }
+
+      /** @return whether the last Automaton was stopped, because there were more than the maximum connections */
+      bool wasAborted() const { return _aborted; }
+
+      /** @return the time in seconds, that the last get1SegAutomaton() spent on the sub-sectors: splitting the sectors
+       * (only done the first time) and choosing the pairs of sub-sectors to connect. The connecting of the hits is not
+       * part of it.
+       */
+      double getSectorSplittingTime() const { return _sectorSplittingTime; }
+
+      /** Sets whether the connections made by get1SegAutomaton() are remembered (default false) */
+      void setKeepConnections( bool keepConnections ){ _keepConnections = keepConnections; }
+
+      /** @return whether there are remembered connections, that get1SegAutomatonFiltered() can use */
+      bool hasConnections() const { return _hasConnections; }
+
+      /** @return the number of pairs of hits in connected sectors, that get1SegAutomaton() would test (without the
+       * sub-sectors and the prefilter). Only needs the occupancies of the sectors, so it is cheap.
+       */
+      double getNumberOfPairs() const;
+
+      /** Adds all the 1-segments with their connections to the automaton (which should be empty) */
+      void get1SegAutomaton( IAutomatonEngine& automaton );
+
+      /** Adds all the 1-segments and those of the remembered connections, that fulfil the current criteria, to the
+       * automaton (which should be empty). Only the connections kept here are remembered from now on.
+       *
+       * This gives the same result as get1SegAutomaton(), if the current criteria are tighter than the ones used
+       * when the connections were made. Must only be called if hasConnections() is true.
+       */
+      void get1SegAutomatonFiltered( IAutomatonEngine& automaton );
+
+
+   private:
+
+      /** Creates a 1-segment for every hit in the automaton.
+       *
+       * @param segments here the segments are stored, at the same position as their hit in the array of all hits
+       */
+      void createSegments( IAutomatonEngine& automaton, std::vector< Segment* >& segments );
+
+      /** Connects the segment at parentPosition to those at [childBegin,childEnd), that all criteria allow. */
+      void connectHit( unsigned parentPosition, unsigned childBegin, unsigned childEnd,
+                       IAutomatonEngine& automaton, const std::vector< Segment* >& segments, bool usePrefilter,
+                       unsigned& nConnections, unsigned& nConnectionsKilled );
+
+      /** Splits all sectors into their sub-sectors */
+      void fillSubSectors();
+
+      /** Adds the hits at the positions [begin,end) as a sub-sector, or splits them further */
+      void addSubSectors( unsigned begin, unsigned end, unsigned depth );
+
+      /** @return whether all criteria allow connecting parent and child */
+      bool areCompatible( Segment* parent, Segment* child ) const;
+
+      const SectorHitIndex& _sectorHitIndex;
+
+      std::vector< ICriterion* > _criteria;
+
+      std::vector< ISectorConnector* > _sectorConnectors;
+
+      bool _keepConnections;
+
+      bool _hasConnections;
+
+      /** The remembered connections: the positions of parent and child in the array of all hits */
+      std::vector< std::pair< unsigned, unsigned > > _connections;
+
+      const Crit2Prefilter* _prefilter;
+
+      const Crit2Prefilter* _subSectorCuts;
+
+      unsigned _maxHitsPerSubSector;
+      unsigned _maxSplitDepth;
+
+      unsigned _maxConnections;
+      bool _aborted;
+
+      double _sectorSplittingTime;
+
+      /** A part of a sector: the hits at the positions [begin,end) */
+      struct SubSector{
+
+         unsigned begin;
+         unsigned end;
+
+         float rMin;
+         float rMax;
+
+      };
+
+      /** The sub-sectors of all sectors, those of a sector one after the other */
+      std::vector< SubSector > _subSectors;
+
+      /** The position of the first sub-sector of every sector in _subSectors */
+      std::vector< unsigned > _firstSubSector;
+
+      bool _subSectorsFilled;
+
+      /** The hits of the index in the same order, filled when the prefilter or the sub-sectors are first used */
+      HitStore _hitStore;
+      bool _hitStoreFilled;
+
+      /** The index of the segment of every hit in the automaton */
+      std::vector< unsigned > _segmentIndex;
+
+      /** the hits passing the prefilter */
+      std::vector< unsigned > _selected;
+
+   };
+
+
+}
+
+
+#endif
@@ -17,6 +17,9 @@
 #include "ILDImpl/SectorSystemVXD.h"
 #include "SectorSystemEndcap.h"
 #include "EndcapHitSimple.h"
+#include "SectorHitIndex.h"
+#include "AutomatonEngine.h"
+#include "TripletCircleCache.h"
 
 
 using namespace lcio ;
@@ -104,6 +107,16 @@ typedef std::vector< IHit* > RawTrack;
  * prevents it) <br>
  * (default value 1000)
  * 
+ * @param CompactAutomaton Whether to run the Cellular Automaton on the flat arrays of the CompactAutomaton instead of the
+ * KiTrack::Automaton. The tracks are the same. (With CED only the KiTrack::Automaton gets drawn.)<br>
+ * (default value false)
+ * 
+ * @param CacheTripletCircles Whether the criteria calculated from circles through hit triplets (Crit3_PT and
+ * Crit4_DistOfCircleCenters) take the circles from a cache of the event, so every circle is only calculated once
+ * (see TripletCircleCache). The decisions are the same. The circles asked for and those known already are counted in the
+ * parameters Count_CircleCacheLookups and Count_CircleCacheHits of the output collection.<br>
+ * (default value false)
+ * 
  * @author Robin Glattauer HEPHY, Wien
  *
  */
@@ -261,6 +274,9 @@ class SiliconEndcapTracking : public Processor {
    /** @return Info on the content of _map_sector_hits. Says how many hits are in each sector */
    std::string getInfo_map_sector_hits();
    
+   /** @return a new empty Cellular Automaton: a CompactAutomaton or the KiTrack::Automaton (see CompactAutomaton) */
+   KiTrackMarlin::IAutomatonEngine* createAutomatonEngine() const;
+   
    
    /** Input collection names */
    std::vector<std::string> _FTDHitCollections{};
@@ -305,6 +321,9 @@ class SiliconEndcapTracking : public Processor {
    /** A map to store the hits according to their sectors */
    std::map< int , std::vector< IHit* > > _map_sector_hits{};
    
+   /** The same hits as in _map_sector_hits for the segment builder, its memory is kept from event to event */
+   KiTrackMarlin::SectorHitIndex _sectorHitIndex{};
+   
    /** Names of the used criteria */
    std::vector< std::string > _criteriaNames{};
    
@@ -345,6 +364,19 @@ class SiliconEndcapTracking : public Processor {
     * the automaton with tighter cuts or stop it entirely. */
    int _maxConnectionsAutomaton=0.0;
    
+   /** Whether the CompactAutomaton is used instead of the KiTrack::Automaton */
+   bool _compactAutomaton=false;
+   
+   /** Whether the criteria take the circles through hit triplets from _circleCache */
+   bool _cacheTripletCircles=false;
+   
+   /** The circles through hit triplets of the current event */
+   KiTrackMarlin::TripletCircleCache _circleCache{};
+   
+   /** The lookups and hits of the circle cache in all events */
+   unsigned long _nCircleCacheLookups=0;
+   unsigned long _nCircleCacheHits=0;
+   
    /** The method used to find the best subset of tracks */
    std::string _bestSubsetFinder{};
    
@@ -0,0 +1,66 @@
+#ifndef SubsetBranchAndBound_h
+#define SubsetBranchAndBound_h
+
+#include <vector>
+
+
+namespace KiTrackMarlin{
+
+
+   /** Finds the best subset exactly: the set of compatible items with the highest sum of their quality indicators
+    * (a maximum weight independent set of the conflict graph).
+    *
+    * This is done by branch and bound, so the time grows exponentially with the number of items. It is meant for
+    * the small groups of tracks in conflict with each other, that are typical for an event.
+    */
+   class SubsetBranchAndBound{
+
+
+   public:
+
+      /** @return for every item, whether it is accepted
+       *
+       * @param conflicts for every item the indices of the items it is in conflict with
+       *
+       * @param qualities the quality indicator of every item, not negative
+       */
+      static std::vector< bool > getBestSubset( const std::vector< std::vector< unsigned > >& conflicts,
+                                                const std::vector< double >& qualities );
+
+
+   private:
+
+      /** The state of the search */
+      struct Search{
+
+         /** the items, best quality first */
+         std::vector< unsigned > order;
+
+         /** for every position in the order: the sum of the qualities from there to the end */
+         std::vector< double > remainingQuality;
+
+         /** how many of the accepted items are in conflict with an item */
+         std::vector< unsigned > nBlocking;
+
+         std::vector< bool > accepted;
+
+         std::vector< bool > bestAccepted;
+         double bestQuality;
+
+      };
+
+      /** Decides about the item at position pos of the order and all after it
+       *
+       * @param quality the sum of the qualities of the items accepted so far
+       */
+      static void branch( Search& search, unsigned pos, double quality,
+                          const std::vector< std::vector< unsigned > >& conflicts,
+                          const std::vector< double >& qualities );
+
+   };
+
+
+}
+
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef SubsetSeededHopfieldNN_h
+#define SubsetSeededHopfieldNN_h
+
+#include <vector>
+
+
+namespace KiTrackMarlin{
+
+
+   /** Finds a good subset with a Hopfield Neural Network, like KiTrack::SubsetHopfieldNN, but with its own random
+    * number generator.
+    *
+    * KiTrack::SubsetHopfieldNN draws the order of the neuron updates from the global rand(). So networks running in
+    * parallel disturb each other and the result depends on the scheduling of the threads. Here every network draws
+    * from its own engine, seeded by the caller: the result only depends on the problem and the seed.
+    *
+    * Every item is a neuron with a state between 0 and 1. Neurons of conflicting items inhibit each other (weight -1),
+    * every neuron is excited by omega times its quality indicator. The states start small and random. In every
+    * iteration all neurons are updated in a random order with the activation 0.5 * ( 1 + tanh( y / T ) ), then the
+    * temperature T is lowered towards TInf. When no state changes by more than 0.01 anymore, the items with a
+    * state of at least the activation threshold are accepted.
+    */
+   class SubsetSeededHopfieldNN{
+
+
+   public:
+
+      /** @return for every item, whether it is accepted
+       *
+       * @param conflicts for every item the indices of the items it is in conflict with
+       *
+       * @param qualities the quality indicator of every item, between 0 and 1
+       *
+       * @param omega how much the quality indicators count compared to the conflicts
+       *
+       * @param activationThreshold the minimum state of an accepted item
+       *
+       * @param TInf the temperature the network cools down to
+       *
+       * @param seed the seed of the random number generator
+       */
+      static std::vector< bool > getBestSubset( const std::vector< std::vector< unsigned > >& conflicts,
+                                                const std::vector< double >& qualities,
+                                                double omega, double activationThreshold, double TInf,
+                                                unsigned seed );
+
+   };
+
+
+}
+
+
+#endif
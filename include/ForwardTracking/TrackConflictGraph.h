@@ -0,0 +1,89 @@
+#ifndef TrackConflictGraph_h
+#define TrackConflictGraph_h
+
+#include <unordered_map>
+#include <vector>
+
+#include "KiTrack/IHit.h"
+#include "KiTrack/ITrack.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** The conflicts between tracks: two tracks are in conflict (incompatible), if they share a hit.
+    *
+    * The graph is built once from an inverted index hit -> tracks, so only tracks that really share a hit are
+    * paired. Asking whether two tracks are compatible is then a lookup, instead of comparing their hits.
+    *
+    * A track is always in conflict with itself. The graph doesn't own the tracks.
+    */
+   class TrackConflictGraph{
+
+
+   public:
+
+      /** Builds the graph
+       *
+       * @param tracks the tracks. The same track may be in the vector more than once.
+       */
+      TrackConflictGraph( const std::vector< ITrack* >& tracks );
+
+      /** @return whether the tracks share no hit. Tracks not passed to the constructor are compared by their hits. */
+      bool areCompatible( ITrack* trackA, ITrack* trackB ) const;
+
+      /** @return the indices (in the vector passed to the constructor) of the tracks in conflict with track i, sorted */
+      const std::vector< unsigned >& getConflicts( unsigned i ) const { return _conflicts[i]; }
+
+      unsigned getNumberOfTracks() const { return _conflicts.size(); }
+
+      /** @return the number of pairs of tracks in conflict */
+      unsigned getNumberOfConflicts() const { return _nConflicts; }
+
+      /** @return the connected components: groups of tracks, that are only in conflict with tracks of the same group.
+       * The indices in a component are sorted and the components are sorted by their first index.
+       */
+      std::vector< std::vector< unsigned > > getComponents() const;
+
+
+   private:
+
+      /** @return whether the tracks share a hit, by comparing their hits */
+      static bool shareHit( ITrack* trackA, ITrack* trackB );
+
+      /** the index of a track (the first one, if it is there more than once) */
+      std::unordered_map< ITrack* , unsigned > _indexOfTrack;
+
+      std::vector< std::vector< unsigned > > _conflicts;
+
+      unsigned _nConflicts;
+
+   };
+
+
+   /** A functor to return whether two tracks are compatible, taken from a TrackConflictGraph. It gives the same
+    * answer as comparing their hits, for the subset finders of KiTrack.
+    */
+   class TrackCompatibilityConflictGraph{
+
+
+   public:
+
+      TrackCompatibilityConflictGraph( const TrackConflictGraph& graph ): _graph( graph ){}
+
+      inline bool operator()( ITrack* trackA, ITrack* trackB ){ return _graph.areCompatible( trackA, trackB ); }
+
+
+   private:
+
+      const TrackConflictGraph& _graph;
+
+   };
+
+
+}
+
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef TrackingStatistics_h
+#define TrackingStatistics_h
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace KiTrackMarlin{
+
+
+   /** The times of the stages of the track search and the counters of the combinatorics, for one event (or a part
+    * of it, like one job or one thread).
+    *
+    * Adding to it is just adding numbers, so it doesn't slow down the tracking. It is not thread safe: every thread
+    * uses its own TrackingStatistics and they are merged afterwards.
+    */
+   class TrackingStatistics{
+
+
+   public:
+
+      /** The stages of the track search, that get timed */
+      enum Stage{
+
+         HitIngestion,      // reading the collections, creating the hits and sorting them into the sectors
+         SectorSplitting,   // splitting the overflowing sectors into sub-sectors and choosing the sub-sectors to connect
+         OverlapMap,        // finding the hits on overlapping petals
+         SegmentBuilding,   // creating the 1-segments and connecting them
+         Automaton2Hit,     // lengthening to 2-hit segments and the Cellular Automaton on them
+         Automaton3Hit,     // lengthening to 3-hit segments and the Cellular Automaton on them
+         OverlapVersions,   // creating the versions of the raw tracks with hits from overlapping petals
+         HelixFit,
+         KalmanFit,
+         Subset,            // finding the best subset of the track candidates
+         Finalisation,      // fitting the final tracks and creating the track states
+         nStages
+
+      };
+
+      /** The counted quantities */
+      enum Counter{
+
+         Hits,
+         SplitSectors,      // sectors with more than MaxHitsPerSector hits, that got split into sub-sectors
+         DroppedSectors,    // sectors with too many hits, that got dropped
+         Rounds,            // rounds of the Cellular Automaton
+         SkippedRounds,     // rounds not built, because the RoundPredictor predicted too many connections
+         Connections1Hit,   // connections of the 1-segments (summed over all rounds, a round stopped at the limit counts the limit + 1)
+         Connections2Hit,   // connections of the 2-hit segments (summed over all rounds)
+         Connections3Hit,   // connections of the 3-hit segments (summed over all rounds)
+         RawTracks,
+         Versions,          // versions of the raw tracks with hits from overlapping petals
+         HelixFits,         // helix fits done (not the ones known from the FitResultCache)
+         KalmanFits,        // Kalman fits done (not the ones known from the FitResultCache)
+         TrackCandidates,   // track candidates, that passed all cuts
+         Conflicts,         // pairs of track candidates sharing a hit
+         Tracks,            // saved tracks
+         HelixFitCacheLookups,
+         HelixFitCacheHits,
+         KalmanFitCacheLookups,
+         KalmanFitCacheHits,
+         CircleCacheLookups,    // circles through hit triplets asked from the TripletCircleCache by the criteria
+         CircleCacheHits,       // ... and known already
+         nCounters
+
+      };
+
+      TrackingStatistics(){ clear(); }
+
+      /** Sets all times and counters to 0 */
+      void clear();
+
+      /** Adds time to a stage
+       *
+       * @param seconds the time in seconds
+       */
+      void addTime( Stage stage, double seconds ){ _times[ stage ] += seconds; }
+
+      /** Adds to a counter */
+      void add( Counter counter, unsigned n = 1 ){ _counters[ counter ] += n; }
+
+      /** Adds the times and counters of other */
+      void merge( const TrackingStatistics& other );
+
+      /** @return the time of the stage in seconds */
+      double getTime( Stage stage ) const { return _times[ stage ]; }
+
+      unsigned getCount( Counter counter ) const { return _counters[ counter ]; }
+
+      static const char* getStageName( Stage stage );
+
+      static const char* getCounterName( Counter counter );
+
+
+   private:
+
+      double _times[ nStages ];
+
+      unsigned _counters[ nCounters ];
+
+   };
+
+
+   /** A stop watch on the monotonic clock */
+   class StageTimer{
+
+
+   public:
+
+      StageTimer(): _start( std::chrono::steady_clock::now() ){}
+
+      /** @return the time in seconds since the creation or the last restart. Starts again from now. */
+      double restart(){
+
+         std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+         double seconds = std::chrono::duration< double >( now - _start ).count();
+         _start = now;
+
+         return seconds;
+
+      }
+
+
+   private:
+
+      std::chrono::steady_clock::time_point _start;
+
+   };
+
+
+   /** Collects the TrackingStatistics of all events and summarises them: mean, median (p50) and 99th percentile
+    * of every time and counter.
+    *
+    * Adding events is thread safe.
+    */
+   class TrackingStatisticsSummary{
+
+
+   public:
+
+      TrackingStatisticsSummary();
+
+      /** Adds the statistics of an event */
+      void add( const TrackingStatistics& statistics );
+
+      unsigned getNumberOfEvents() const;
+
+      /** @return the times and counters summed over all events */
+      TrackingStatistics getTotal() const;
+
+      /** Writes the summary as CSV: one line for every time (in ms) and counter with its mean, p50 and p99
+       *
+       * @return false, if the file couldn't be written
+       */
+      bool writeCSV( const std::string& fileName ) const;
+
+      /** @return the summary as a table */
+      std::string getInfo() const;
+
+
+   private:
+
+      /** A line of the summary */
+      struct Line{
+
+         std::string name;
+         std::string unit;
+         double mean;
+         double p50;
+         double p99;
+
+      };
+
+      std::vector< Line > getLines() const;
+
+      /** For every time and then every counter: the values of all events */
+      std::vector< std::vector< double > > _values;
+
+      TrackingStatistics _total;
+
+      mutable std::mutex _mutex;
+
+   };
+
+
+}
+
+
+#endif
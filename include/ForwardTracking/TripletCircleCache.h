@@ -0,0 +1,96 @@
+#ifndef TripletCircleCache_h
+#define TripletCircleCache_h
+
+#include <cstddef>
+#include <unordered_map>
+
+#include "KiTrack/IHit.h"
+
+using namespace KiTrack;
+
+
+namespace KiTrackMarlin{
+
+
+   /** Remembers the circles (in x,y) through triplets of hits of an event and the helix parameters derived from them.
+    *
+    * The criteria of the Cellular Automaton, that work with circles, calculate the circle of the same three hits
+    * again and again: the circle of a 3-hit segment is needed for every pairing of the segment in the 4-hit criteria,
+    * it is the same triplet the 3-hit criteria already tested when the segment was made, and the next round tests the
+    * same triplets once more. Here every circle is calculated once per event.
+    *
+    * The key are the three hits in their order. The circle is calculated with the same SimpleCircle as in the criteria,
+    * so the values are exactly the same.
+    *
+    * Not thread safe: every concurrent search needs its own cache. It has to be cleared, when the hits of the event
+    * are gone.
+    */
+   class TripletCircleCache{
+
+
+   public:
+
+      /** The circle through three hits a, b, c */
+      struct Circle{
+
+         /** whether there is a circle: false, if SimpleCircle threw or the radius isn't finite (for example for
+          * hits on a straight line) */
+         bool valid;
+
+         float centerX;
+         float centerY;
+         float radius;
+
+         /** the signed curvature: positive, if a, b, c go round counter-clockwise */
+         float omega;
+
+         /** the change of z per arc length in (x,y) from a to c */
+         float tanLambda;
+
+      };
+
+      TripletCircleCache();
+
+      /** @return the circle through the hits, calculated now or known already. It stays valid until clear(). */
+      const Circle& get( IHit* a, IHit* b, IHit* c );
+
+      /** Forgets all circles and resets the counters */
+      void clear();
+
+      unsigned getNumberOfLookups() const { return _nLookups; }
+      unsigned getNumberOfHits() const { return _nHits; }
+
+
+   private:
+
+      struct Key{
+
+         IHit* a;
+         IHit* b;
+         IHit* c;
+
+         bool operator==( const Key& other ) const { return ( a == other.a ) && ( b == other.b ) && ( c == other.c ); }
+
+      };
+
+      struct KeyHash{
+
+         std::size_t operator()( const Key& key ) const;
+
+      };
+
+      /** @return the circle through the hits */
+      static Circle calculate( IHit* a, IHit* b, IHit* c );
+
+      std::unordered_map< Key, Circle, KeyHash > _circles;
+
+      unsigned _nLookups;
+      unsigned _nHits;
+
+   };
+
+
+}
+
+
+#endif
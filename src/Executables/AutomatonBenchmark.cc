@@ -0,0 +1,307 @@
+/** Executable comparing the CompactAutomaton with the KiTrack::Automaton.
+ *
+ * For a rising number of tracks, events are simulated on the forward disks of the FTD: tracks from the IP, slightly
+ * bent, plus random noise hits. Both engines get the same 1-segments from the SectorIndexSegmentBuilder and run the
+ * Cellular Automaton the way ForwardTracking does (2-hit segments, 3-hit segments, the raw tracks). Every stage is timed:
+ * - build: the 1-segments and their connections
+ * - 2-hit: lengthening to 2-hit segments, the states and the cleaning of the bad states
+ * - 3-hit: the same for 3-hit segments
+ * - tracks: reading out the raw tracks
+ *
+ * The raw tracks of both engines have to be the same (in any order), otherwise the executable returns 1.
+ *
+ * Usage: AutomatonBenchmark [number of repetitions per occupancy (default 10)]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Criteria/Criteria.h"
+#include "ILDImpl/FTDHitSimple.h"
+#include "ILDImpl/FTDSectorConnector.h"
+#include "ILDImpl/SectorSystemFTD.h"
+
+#include "SectorHitIndex.h"
+#include "SectorIndexSegmentBuilder.h"
+#include "AutomatonEngine.h"
+#include "CompactAutomaton.h"
+
+
+using namespace KiTrack;
+using namespace KiTrackMarlin;
+
+
+const unsigned nLayers = 8;    // including the IP as layer 0
+const unsigned nModules = 16;  // petals per disk
+const unsigned nSensors = 2;   // sensors per petal
+
+/** The z of the disks (layer 0 is the IP) */
+const float diskZ[ nLayers ] = { 0., 220., 370., 650., 800., 990., 1210., 1430. };
+
+const float rMin = 40.;
+const float rMax = 300.;
+
+
+/** @return a hit on the forward side, the module and sensor from its position */
+IHit* createHit( float r, float phi, unsigned layer, const SectorSystemFTD* sectorSystemFTD ){
+
+
+   const float petalWidth = 2. * M_PI / nModules;
+
+   phi = fmod( phi, float( 2. * M_PI ) );
+   if( phi < 0. ) phi += 2. * M_PI;
+
+   unsigned module = unsigned( phi / petalWidth ) % nModules;
+   unsigned sensor = ( r < 170. ) ? 0 : 1;
+
+   return new FTDHitSimple( r * cos( phi ), r * sin( phi ), diskZ[ layer ], 1, layer, module, sensor, sectorSystemFTD );
+
+
+}
+
+
+/** Creates the hits of an event: the virtual IP hit, the tracks and the noise */
+void createEvent( unsigned nTracks, unsigned nNoiseHits, std::mt19937& generator, const SectorSystemFTD* sectorSystemFTD,
+                  std::vector< IHit* >& hits ){
+
+
+   FTDHitSimple* virtualIPHit = new FTDHitSimple( 0., 0., 0., 1, 0, 0, 0, sectorSystemFTD );
+   virtualIPHit->setIsVirtual( true );
+   hits.push_back( virtualIPHit );
+
+   std::uniform_real_distribution< float > distTanTheta( 0.03, 1. );
+   std::uniform_real_distribution< float > distPhi( 0., 2. * M_PI );
+   std::uniform_real_distribution< float > distBending( -3e-4, 3e-4 ); // the change of phi per mm in r
+   std::uniform_real_distribution< float > distR( rMin, rMax );
+   std::uniform_int_distribution< unsigned > distLayer( 1, nLayers - 1 );
+
+   for( unsigned i=0; i < nTracks; i++ ){
+
+
+      float tanTheta = distTanTheta( generator );
+      float phi0 = distPhi( generator );
+      float bending = distBending( generator );
+
+      for( unsigned layer=1; layer < nLayers; layer++ ){
+
+         float r = diskZ[ layer ] * tanTheta;
+         if( ( r < rMin ) || ( r > rMax ) ) continue;
+
+         hits.push_back( createHit( r, phi0 + bending * r, layer, sectorSystemFTD ) );
+
+      }
+
+
+   }
+
+   for( unsigned i=0; i < nNoiseHits; i++ ){
+
+      hits.push_back( createHit( distR( generator ), distPhi( generator ), distLayer( generator ), sectorSystemFTD ) );
+
+   }
+
+
+}
+
+
+/** The stages of the Cellular Automaton, that get timed */
+enum Stage{ Build, Automaton2Hit, Automaton3Hit, Tracks, nStages };
+
+
+/** Runs the Cellular Automaton like ForwardTracking does
+ *
+ * @param times here the time of every stage in ms gets added
+ *
+ * @return the raw tracks
+ */
+std::vector< std::vector< IHit* > > runAutomaton( IAutomatonEngine& automaton, SectorIndexSegmentBuilder& segBuilder,
+                                                  const std::vector< ICriterion* >& crit3Vec,
+                                                  const std::vector< ICriterion* >& crit4Vec,
+                                                  double* times ){
+
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+   auto restart = [&](){
+
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      double time = std::chrono::duration< double, std::milli >( now - start ).count();
+      start = now;
+      return time;
+
+   };
+
+
+   segBuilder.get1SegAutomaton( automaton );
+
+   times[ Build ] += restart();
+
+
+   automaton.clearCriteria();
+   automaton.addCriteria( crit3Vec );
+   automaton.lengthenSegments();
+   automaton.doAutomaton();
+   automaton.cleanBadStates();
+   automaton.resetStates();
+
+   times[ Automaton2Hit ] += restart();
+
+
+   automaton.clearCriteria();
+   automaton.addCriteria( crit4Vec );
+   automaton.lengthenSegments();
+   automaton.doAutomaton();
+   automaton.cleanBadStates();
+   automaton.resetStates();
+
+   times[ Automaton3Hit ] += restart();
+
+
+   std::vector< std::vector< IHit* > > rawTracks = automaton.getTracks( 3 );
+
+   times[ Tracks ] += restart();
+
+   return rawTracks;
+
+
+}
+
+
+int main( int argc, char* argv[] ){
+
+
+   unsigned nRepetitions = 10;
+   if( argc >= 2 ) nRepetitions = atoi( argv[1] );
+
+   const SectorSystemFTD sectorSystemFTD( nLayers, nModules, nSensors );
+   const unsigned nSectors = 2 * nLayers * nModules * nSensors;
+
+   std::mt19937 generator( 42 );
+
+
+   // loose criteria for tracks from the IP
+   std::vector< ICriterion* > crit2Vec;
+   crit2Vec.push_back( Criteria::createCriterion( "Crit2_RZRatio", 1., 1.5 ) );
+   crit2Vec.push_back( Criteria::createCriterion( "Crit2_StraightTrackRatio", 0.9, 1.1 ) );
+
+   std::vector< ICriterion* > crit3Vec;
+   crit3Vec.push_back( Criteria::createCriterion( "Crit3_3DAngle", 0., 10. ) );
+
+   std::vector< ICriterion* > crit4Vec;
+   crit4Vec.push_back( Criteria::createCriterion( "Crit4_3DAngleChange", 0., 10. ) );
+
+
+   unsigned layerStepMax = 1; // how many layers to go at max
+   unsigned petalStepMax = 1; // how many petals to go at max
+   unsigned lastLayerToIP = 5;// layer 1,2,3 and 4 get connected directly to the IP
+   FTDSectorConnector secCon( &sectorSystemFTD , layerStepMax , petalStepMax , lastLayerToIP );
+
+   std::vector< unsigned > occupancies = { 10, 30, 100, 300 };
+
+   const char* stageNames[ nStages ] = { "build", "2-hit", "3-hit", "tracks" };
+
+   bool allEqual = true;
+
+   std::cout << "\nAutomatonBenchmark: " << nRepetitions << " repetitions\n\n";
+   std::cout << std::setw( 8 ) << "tracks"
+             << std::setw( 8 ) << "hits"
+             << std::setw( 10 ) << "stage"
+             << std::setw( 16 ) << "KiTrack [ms]"
+             << std::setw( 16 ) << "compact [ms]"
+             << std::setw( 10 ) << "speedup"
+             << std::setw( 12 ) << "raw tracks"
+             << std::setw( 8 ) << "equal" << "\n";
+
+
+   for( unsigned iOcc=0; iOcc < occupancies.size(); iOcc++ ){
+
+
+      unsigned nTracks = occupancies[ iOcc ];
+
+      std::vector< IHit* > hits;
+      createEvent( nTracks, 5 * nTracks, generator, &sectorSystemFTD, hits );
+
+      SectorHitIndex sectorHitIndex( nSectors );
+      sectorHitIndex.build( hits );
+
+      SectorIndexSegmentBuilder segBuilder( sectorHitIndex );
+      segBuilder.addCriteria( crit2Vec );
+      segBuilder.addSectorConnector( &secCon );
+
+
+      double timesKiTrack[ nStages ] = {};
+      double timesCompact[ nStages ] = {};
+      bool equal = true;
+      unsigned nRawTracks = 0;
+
+      for( unsigned i=0; i < nRepetitions; i++ ){
+
+
+         KiTrackAutomatonEngine kiTrackAutomaton;
+         std::vector< std::vector< IHit* > > rawTracksKiTrack = runAutomaton( kiTrackAutomaton, segBuilder, crit3Vec, crit4Vec, timesKiTrack );
+
+         CompactAutomaton compactAutomaton;
+         std::vector< std::vector< IHit* > > rawTracksCompact = runAutomaton( compactAutomaton, segBuilder, crit3Vec, crit4Vec, timesCompact );
+
+         // the order of the tracks may differ
+         std::sort( rawTracksKiTrack.begin(), rawTracksKiTrack.end() );
+         std::sort( rawTracksCompact.begin(), rawTracksCompact.end() );
+
+         if( rawTracksKiTrack != rawTracksCompact ) equal = false;
+         nRawTracks = rawTracksKiTrack.size();
+
+
+      }
+
+      if( !equal ) allEqual = false;
+
+
+      for( unsigned stage=0; stage < nStages; stage++ ){
+
+         double timeKiTrack = timesKiTrack[ stage ] / nRepetitions;
+         double timeCompact = timesCompact[ stage ] / nRepetitions;
+
+         std::cout << std::setw( 8 ) << nTracks
+                   << std::setw( 8 ) << hits.size()
+                   << std::setw( 10 ) << stageNames[ stage ]
+                   << std::setw( 16 ) << timeKiTrack
+                   << std::setw( 16 ) << timeCompact
+                   << std::setw( 10 ) << ( timeCompact > 0. ? timeKiTrack / timeCompact : 0. )
+                   << std::setw( 12 ) << nRawTracks
+                   << std::setw( 8 ) << ( equal ? "yes" : "NO" ) << "\n";
+
+      }
+
+
+      for( unsigned i=0; i < hits.size(); i++ ) delete hits[i];
+
+
+   }
+
+
+   for( unsigned i=0; i < crit2Vec.size(); i++ ) delete crit2Vec[i];
+   for( unsigned i=0; i < crit3Vec.size(); i++ ) delete crit3Vec[i];
+   for( unsigned i=0; i < crit4Vec.size(); i++ ) delete crit4Vec[i];
+
+
+   if( !allEqual ){
+
+      std::cout << "\nThe CompactAutomaton and the KiTrack::Automaton found different raw tracks!\n";
+      return 1;
+
+   }
+
+   std::cout << "\nDone!\n";
+
+   return 0;
+
+
+}
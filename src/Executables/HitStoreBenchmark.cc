@@ -0,0 +1,272 @@
+/** Executable comparing the geometric kernels of the HitStore with the same calculations on the IHit pointers
+ * (virtual getX, getY and getZ for every access), as they are done in the loops of the tracking.
+ *
+ * For a rising number of hits, random hits are created on a disk of the FTD, and two things are timed:
+ * - the distances of every hit to all other hits
+ * - the selection of the hits closer than distMax and behind a hit (the test for hits on overlapping petals)
+ *
+ * The results have to be the same, otherwise the executable returns 1. (Only for the float HitStore: compiled
+ * with -DHITSTORE_DOUBLE, hits at the edge of a cut may be selected differently.)
+ *
+ * Usage: HitStoreBenchmark [number of repetitions per occupancy (default 10)]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "ILDImpl/FTDHitSimple.h"
+#include "ILDImpl/SectorSystemFTD.h"
+
+#include "HitStore.h"
+
+
+using namespace KiTrack;
+using namespace KiTrackMarlin;
+
+
+const unsigned nLayers = 8;    // including the IP as layer 0
+const unsigned nModules = 16;  // petals per disk
+const unsigned nSensors = 2;   // sensors per petal
+
+
+/** Creates hits on the first forward disk of the FTD. Every second petal is a bit behind the others. */
+void createHits( unsigned nHits, std::mt19937& generator, const SectorSystemFTD* sectorSystemFTD, std::vector< IHit* >& hits ){
+
+
+   std::uniform_real_distribution< float > distR( 40., 300. );
+   std::uniform_real_distribution< float > distPhi( 0., 2. * M_PI );
+
+   const float petalWidth = 2. * M_PI / nModules;
+
+   for( unsigned i=0; i < nHits; i++ ){
+
+
+      float r = distR( generator );
+      float phi = distPhi( generator );
+
+      unsigned module = unsigned( phi / petalWidth ) % nModules;
+      unsigned sensor = ( r < 170. ) ? 0 : 1;
+
+      float z = 300. + ( ( module % 2 ) ? 2. : 0. );
+
+      hits.push_back( new FTDHitSimple( r * cos( phi ), r * sin( phi ), z, 1, 1, module, sensor, sectorSystemFTD ) );
+
+
+   }
+
+
+}
+
+
+/** @return the sum of the distances of every hit to all hits after it, from the pointers */
+double sumDistancesPointers( const std::vector< IHit* >& hits ){
+
+
+   double sum = 0.;
+
+   for( unsigned i=0; i < hits.size(); i++ ){
+
+      for( unsigned j=i+1; j < hits.size(); j++ ){
+
+         float dx = hits[i]->getX() - hits[j]->getX();
+         float dy = hits[i]->getY() - hits[j]->getY();
+         float dz = hits[i]->getZ() - hits[j]->getZ();
+
+         sum += dx*dx + dy*dy + dz*dz;
+
+      }
+
+   }
+
+   return sum;
+
+
+}
+
+
+/** @return the sum of the distances of every hit to all hits after it, from the HitStore */
+double sumDistancesStore( const HitStore& hitStore, std::vector< HitStore::Real >& dist2 ){
+
+
+   double sum = 0.;
+   unsigned nHits = hitStore.size();
+
+   dist2.resize( nHits );
+
+   for( unsigned i=0; i < nHits; i++ ){
+
+      hitStore.getDistances2( hitStore.getX( i ), hitStore.getY( i ), hitStore.getZ( i ), i+1, nHits, dist2.data() );
+
+      for( unsigned j=0; j < nHits - i - 1; j++ ) sum += dist2[j];
+
+   }
+
+   return sum;
+
+
+}
+
+
+/** @return the number of pairs of hits, where the second is closer than distMax and behind the first, from the pointers */
+unsigned countCloseAndBehindPointers( const std::vector< IHit* >& hits, float distMax ){
+
+
+   unsigned nPairs = 0;
+   float distMax2 = distMax * distMax;
+
+   for( unsigned i=0; i < hits.size(); i++ ){
+
+      for( unsigned j=0; j < hits.size(); j++ ){
+
+         float dx = hits[i]->getX() - hits[j]->getX();
+         float dy = hits[i]->getY() - hits[j]->getY();
+         float dz = hits[i]->getZ() - hits[j]->getZ();
+
+         if( ( dx*dx + dy*dy + dz*dz < distMax2 ) && ( fabs( hits[j]->getZ() ) > fabs( hits[i]->getZ() ) ) ) nPairs++;
+
+      }
+
+   }
+
+   return nPairs;
+
+
+}
+
+
+/** @return the number of pairs of hits, where the second is closer than distMax and behind the first, from the HitStore */
+unsigned countCloseAndBehindStore( const HitStore& hitStore, float distMax, std::vector< unsigned >& selected ){
+
+
+   unsigned nPairs = 0;
+   unsigned nHits = hitStore.size();
+
+   selected.resize( nHits );
+
+   for( unsigned i=0; i < nHits; i++ ){
+
+      nPairs += hitStore.selectCloseAndBehind( hitStore.getX( i ), hitStore.getY( i ), hitStore.getZ( i ),
+                                               0, nHits, distMax * distMax, selected.data() );
+
+   }
+
+   return nPairs;
+
+
+}
+
+
+/** @return the time per repetition in ms */
+template< class Function >
+double timeIt( unsigned nRepetitions, Function function ){
+
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+   for( unsigned i=0; i < nRepetitions; i++ ) function();
+
+   std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+   return std::chrono::duration< double, std::milli >( end - start ).count() / nRepetitions;
+
+
+}
+
+
+int main( int argc, char* argv[] ){
+
+
+   unsigned nRepetitions = 10;
+   if( argc >= 2 ) nRepetitions = atoi( argv[1] );
+
+   float distMax = 3.5;
+
+   const SectorSystemFTD sectorSystemFTD( nLayers, nModules, nSensors );
+
+   std::mt19937 generator( 42 );
+
+   HitStore hitStore;
+   std::vector< HitStore::Real > dist2;
+   std::vector< unsigned > selected;
+
+   std::vector< unsigned > occupancies = { 100, 300, 1000, 3000 };
+
+   bool allEqual = true;
+
+   std::cout << "\nHitStoreBenchmark: " << nRepetitions << " repetitions, " << sizeof( HitStore::Real ) << " byte coordinates\n\n";
+   std::cout << std::setw( 8 ) << "hits"
+             << std::setw( 14 ) << "kernel"
+             << std::setw( 16 ) << "pointers [ms]"
+             << std::setw( 12 ) << "store [ms]"
+             << std::setw( 10 ) << "speedup"
+             << std::setw( 8 ) << "equal" << "\n";
+
+
+   for( unsigned iOcc=0; iOcc < occupancies.size(); iOcc++ ){
+
+
+      std::vector< IHit* > hits;
+      createHits( occupancies[ iOcc ], generator, &sectorSystemFTD, hits );
+
+      // filling the store is part of the work of the store
+      double timeBuild = timeIt( nRepetitions, [&](){ hitStore.build( hits ); } );
+
+
+      const char* names[2] = { "distance", "close+behind" };
+      double timePointers[2];
+      double timeStore[2];
+      bool equal[2];
+
+      double sumPointers = 0.;
+      double sumStore = 0.;
+      timePointers[0] = timeIt( nRepetitions, [&](){ sumPointers = sumDistancesPointers( hits ); } );
+      timeStore[0] = timeIt( nRepetitions, [&](){ sumStore = sumDistancesStore( hitStore, dist2 ); } );
+      equal[0] = ( fabs( sumPointers - sumStore ) <= 1e-6 * fabs( sumPointers ) );
+
+      unsigned nPointers = 0;
+      unsigned nStore = 0;
+      timePointers[1] = timeIt( nRepetitions, [&](){ nPointers = countCloseAndBehindPointers( hits, distMax ); } );
+      timeStore[1] = timeIt( nRepetitions, [&](){ nStore = countCloseAndBehindStore( hitStore, distMax, selected ); } );
+      equal[1] = ( nPointers == nStore );
+
+
+      for( unsigned k=0; k < 2; k++ ){
+
+         if( !equal[k] ) allEqual = false;
+
+         std::cout << std::setw( 8 ) << occupancies[ iOcc ]
+                   << std::setw( 14 ) << names[k]
+                   << std::setw( 16 ) << timePointers[k]
+                   << std::setw( 12 ) << timeStore[k]
+                   << std::setw( 10 ) << ( timeStore[k] > 0. ? timePointers[k] / timeStore[k] : 0. )
+                   << std::setw( 8 ) << ( equal[k] ? "yes" : "NO" ) << "\n";
+
+      }
+
+      std::cout << std::setw( 8 ) << occupancies[ iOcc ] << std::setw( 14 ) << "build" << std::setw( 28 ) << timeBuild << "\n";
+
+
+      for( unsigned i=0; i < hits.size(); i++ ) delete hits[i];
+
+
+   }
+
+
+   if( !allEqual ){
+
+      std::cout << "\nThe HitStore and the pointers gave different results!\n";
+      return 1;
+
+   }
+
+   std::cout << "\nDone!\n";
+
+   return 0;
+
+
+}
@@ -0,0 +1,176 @@
+/** Executable comparing the two ways of finding hits on overlapping petals of the FTD:
+ * the uniform grid of OverlapHitGrid::getOverlapConnectionMap and the comparison of all pairs of hits on neighbouring
+ * petals (OverlapHitGrid::getOverlapConnectionMapAllPairs).
+ *
+ * For a rising number of hits per disk, random hits are created on all disks of both sides, and both methods are
+ * timed. The results have to be the same, otherwise the executable returns 1.
+ *
+ * Usage: OverlapFinderBenchmark [number of repetitions per occupancy (default 10)]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "ILDImpl/FTDHitSimple.h"
+#include "ILDImpl/SectorSystemFTD.h"
+
+#include "SectorHitIndex.h"
+#include "OverlapHitGrid.h"
+
+
+using namespace KiTrack;
+using namespace KiTrackMarlin;
+
+
+const unsigned nLayers = 8;    // including the IP as layer 0
+const unsigned nModules = 16;  // petals per disk
+const unsigned nSensors = 2;   // sensors per petal
+
+
+/** Creates hits on all disks of the FTD. Petals overlap at their edges: there every second petal is a bit behind
+ * the others, and some of the hits there get a twin on the neighbouring petal, as if a track went through both.
+ */
+void createHits( unsigned nHitsPerDisk, std::mt19937& generator, const SectorSystemFTD* sectorSystemFTD, std::vector< IHit* >& hits ){
+
+
+   std::uniform_real_distribution< float > distR( 40., 300. );
+   std::uniform_real_distribution< float > distPhi( 0., 2. * M_PI );
+   std::uniform_real_distribution< float > distUniform( 0., 1. );
+
+   const float petalWidth = 2. * M_PI / nModules;
+
+   for( int side = -1; side <= 1; side += 2 ){
+
+      for( unsigned layer = 1; layer < nLayers; layer++ ){
+
+
+         float zDisk = side * ( 200. + 100. * layer );
+
+         for( unsigned i=0; i < nHitsPerDisk; i++ ){
+
+
+            float r = distR( generator );
+            float phi = distPhi( generator );
+
+            unsigned module = unsigned( phi / petalWidth ) % nModules;
+            unsigned sensor = ( r < 170. ) ? 0 : 1;
+
+            float x = r * cos( phi );
+            float y = r * sin( phi );
+            float z = zDisk + side * ( ( module % 2 ) ? 2. : 0. );
+
+            hits.push_back( new FTDHitSimple( x, y, z, side, layer, module, sensor, sectorSystemFTD ) );
+
+
+            // at the edge of the petal, the track may also go through the previous one
+            bool atEdge = ( phi - module * petalWidth ) < 0.05 * petalWidth;
+
+            if( atEdge && ( distUniform( generator ) < 0.5 ) ){
+
+               unsigned modulePrev = ( module + nModules - 1 ) % nModules;
+               float zPrev = zDisk + side * ( ( modulePrev % 2 ) ? 2. : 0. );
+
+               hits.push_back( new FTDHitSimple( x + 0.3, y - 0.3, zPrev, side, layer, modulePrev, sensor, sectorSystemFTD ) );
+
+            }
+
+         }
+
+      }
+
+   }
+
+
+}
+
+
+int main( int argc, char* argv[] ){
+
+
+   unsigned nRepetitions = 10;
+   if( argc >= 2 ) nRepetitions = atoi( argv[1] );
+
+   float distMax = 3.5;
+
+   const SectorSystemFTD sectorSystemFTD( nLayers, nModules, nSensors );
+   unsigned nSectors = 2 * nLayers * nModules * nSensors;
+
+   std::mt19937 generator( 42 );
+
+   SectorHitIndex sectorHitIndex( nSectors );
+   OverlapHitGrid overlapHitGrid( &sectorSystemFTD );
+
+   std::vector< unsigned > occupancies = { 10, 30, 100, 300, 1000, 3000, 10000 };
+
+   bool allEqual = true;
+
+   std::cout << "\nOverlapFinderBenchmark: " << nRepetitions << " repetitions, distMax = " << distMax << "\n\n";
+   std::cout << std::setw( 14 ) << "hits per disk"
+             << std::setw( 14 ) << "connected"
+             << std::setw( 16 ) << "all pairs [ms]"
+             << std::setw( 12 ) << "grid [ms]"
+             << std::setw( 10 ) << "speedup"
+             << std::setw( 8 ) << "equal" << "\n";
+
+
+   for( unsigned iOcc=0; iOcc < occupancies.size(); iOcc++ ){
+
+
+      std::vector< IHit* > hits;
+      createHits( occupancies[ iOcc ], generator, &sectorSystemFTD, hits );
+
+      sectorHitIndex.build( hits );
+
+      std::map< IHit* , std::vector< IHit* > > mapAllPairs;
+      std::map< IHit* , std::vector< IHit* > > mapGrid;
+
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+      for( unsigned i=0; i < nRepetitions; i++ ) mapAllPairs = overlapHitGrid.getOverlapConnectionMapAllPairs( sectorHitIndex, distMax );
+
+      std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+      for( unsigned i=0; i < nRepetitions; i++ ) mapGrid = overlapHitGrid.getOverlapConnectionMap( sectorHitIndex, distMax );
+
+      std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+
+      double timeAllPairs = std::chrono::duration< double, std::milli >( middle - start ).count() / nRepetitions;
+      double timeGrid = std::chrono::duration< double, std::milli >( end - middle ).count() / nRepetitions;
+
+      bool equal = ( mapAllPairs == mapGrid );
+      if( !equal ) allEqual = false;
+
+      std::cout << std::setw( 14 ) << occupancies[ iOcc ]
+                << std::setw( 14 ) << mapGrid.size()
+                << std::setw( 16 ) << timeAllPairs
+                << std::setw( 12 ) << timeGrid
+                << std::setw( 10 ) << ( timeGrid > 0. ? timeAllPairs / timeGrid : 0. )
+                << std::setw( 8 ) << ( equal ? "yes" : "NO" ) << "\n";
+
+
+      for( unsigned i=0; i < hits.size(); i++ ) delete hits[i];
+
+
+   }
+
+
+   if( !allEqual ){
+
+      std::cout << "\nThe grid and all pairs gave different results!\n";
+      return 1;
+
+   }
+
+   std::cout << "\nDone!\n";
+
+   return 0;
+
+
+}
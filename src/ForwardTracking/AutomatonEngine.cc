@@ -0,0 +1,29 @@
+#include "AutomatonEngine.h"
+
+
+using namespace KiTrackMarlin;
+
+
+unsigned KiTrackAutomatonEngine::add1Segment( IHit* hit ){
+
+
+   Segment* segment = new Segment( hit );
+   segment->setLayer( hit->getLayer() );
+
+   _automaton.addSegment( segment );
+   _segments.push_back( segment );
+
+   return _segments.size() - 1;
+
+
+}
+
+
+void KiTrackAutomatonEngine::connect1Segments( unsigned parent, unsigned child ){
+
+
+   _segments[ parent ]->addChild( _segments[ child ] );
+   _segments[ child ]->addParent( _segments[ parent ] );
+
+
+}
@@ -0,0 +1,102 @@
+#include "CachedCircleCriterion.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+
+using namespace KiTrackMarlin;
+
+
+const float CachedCircleCriterion::Bz = 3.5;
+
+
+bool CachedCircleCriterion::isCacheable( const std::string& name ){
+
+
+   return ( name == "Crit3_PT" ) || ( name == "Crit4_DistOfCircleCenters" );
+
+
+}
+
+
+CachedCircleCriterion::CachedCircleCriterion( ICriterion* criterion, const std::string& name, float min, float max ):
+   _criterion( criterion ),
+   _quantity( PT ),
+   _min( min ),
+   _max( max ),
+   _cache( NULL ){
+
+
+   if( name == "Crit3_PT" ) _quantity = PT;
+   else if( name == "Crit4_DistOfCircleCenters" ) _quantity = DistOfCircleCenters;
+   else throw std::invalid_argument( "CachedCircleCriterion: no cached version of the criterion " + name );
+
+   _name = name;
+   _type = criterion->getType();
+   _saveValues = false;
+
+
+}
+
+
+CachedCircleCriterion::~CachedCircleCriterion(){
+
+
+   delete _criterion;
+
+
+}
+
+
+bool CachedCircleCriterion::areCompatible( Segment* parent , Segment* child )throw( BadSegmentLength ){
+
+
+   if( _cache == NULL ) return _criterion->areCompatible( parent, child );
+
+   std::vector< IHit* > parentHits = parent->getHits();
+   std::vector< IHit* > childHits = child->getHits();
+
+
+   if( ( _quantity == PT ) && ( parentHits.size() == 2 ) && ( childHits.size() == 2 ) ){
+
+
+      const TripletCircleCache::Circle& circle = _cache->get( childHits[0], childHits[1], parentHits[1] );
+
+      if( circle.valid ){
+
+         // |omega| = K*Bz/pt --> pt = R*K*Bz
+         const double K = 0.00029979;
+         double pt = circle.radius * K * Bz;
+
+         return ( pt >= _min ) && ( pt <= _max );
+
+      }
+
+
+   }
+   else if( ( _quantity == DistOfCircleCenters ) && ( parentHits.size() == 3 ) && ( childHits.size() == 3 ) ){
+
+
+      // the circle of the child and the one of the parent
+      const TripletCircleCache::Circle& circle1 = _cache->get( childHits[0], childHits[1], childHits[2] );
+      const TripletCircleCache::Circle& circle2 = _cache->get( parentHits[0], parentHits[1], parentHits[2] );
+
+      if( circle1.valid && circle2.valid ){
+
+         float dX = circle2.centerX - circle1.centerX;
+         float dY = circle2.centerY - circle1.centerY;
+         float distOfCircleCenters = sqrt( dX*dX + dY*dY );
+
+         return ( distOfCircleCenters >= _min ) && ( distOfCircleCenters <= _max );
+
+      }
+
+
+   }
+
+   // no circle or wrong segments: the criterion itself knows what to do
+   return _criterion->areCompatible( parent, child );
+
+
+}
@@ -0,0 +1,420 @@
+#include "CompactAutomaton.h"
+
+#include <algorithm>
+#include <numeric>
+
+
+using namespace KiTrackMarlin;
+
+
+namespace{
+
+   /** Builds compressed sparse rows: the values of row i end up at values[ begin[i] ] to values[ begin[i+1] - 1 ],
+    * in the order they came in.
+    *
+    * @param rows the row of every entry
+    *
+    * @param values the value of every entry (NULL: the index of the entry)
+    */
+   void buildRowsOf( unsigned nRows, const std::vector< unsigned >& rows, const std::vector< unsigned >* values,
+                     std::vector< unsigned >& begin, std::vector< unsigned >& sorted ){
+
+
+      begin.assign( nRows + 1, 0 );
+
+      for( unsigned i=0; i < rows.size(); i++ ) begin[ rows[i] + 1 ]++;
+      for( unsigned row=0; row < nRows; row++ ) begin[ row + 1 ] += begin[ row ];
+
+      std::vector< unsigned > next( begin.begin(), begin.end() - 1 );
+      sorted.resize( rows.size() );
+
+      for( unsigned i=0; i < rows.size(); i++ ){
+
+         sorted[ next[ rows[i] ]++ ] = ( values != NULL ) ? (*values)[i] : i;
+
+      }
+
+
+   }
+
+}
+
+
+CompactAutomaton::CompactAutomaton():
+   _length( 1 ){
+
+}
+
+
+unsigned CompactAutomaton::add1Segment( IHit* hit ){
+
+
+   _hits.push_back( hit );
+   _layers.push_back( hit->getLayer() );
+   _states.push_back( 0 );
+
+   _1Segments.emplace_back( hit );
+   _1Segments.back().setLayer( hit->getLayer() );
+
+   return _layers.size() - 1;
+
+
+}
+
+
+void CompactAutomaton::connect1Segments( unsigned parent, unsigned child ){
+
+
+   _newConnections.push_back( std::make_pair( parent, child ) );
+
+
+}
+
+
+void CompactAutomaton::buildRows(){
+
+
+   unsigned nSegments = _layers.size();
+
+   if( _newConnections.empty() && ( _childBegin.size() == nSegments + 1 ) ) return;
+
+
+   // all connections: those already in the rows and the new ones
+   std::vector< unsigned > parents;
+   std::vector< unsigned > children;
+
+   for( unsigned parent=0; parent + 1 < _childBegin.size(); parent++ ){
+
+      for( unsigned k = _childBegin[ parent ]; k < _childBegin[ parent + 1 ]; k++ ){
+
+         parents.push_back( parent );
+         children.push_back( _children[k] );
+
+      }
+
+   }
+
+   for( unsigned i=0; i < _newConnections.size(); i++ ){
+
+      parents.push_back( _newConnections[i].first );
+      children.push_back( _newConnections[i].second );
+
+   }
+
+   _newConnections.clear();
+
+
+   // the children by their parent, that gives the index of every connection
+   buildRowsOf( nSegments, parents, &children, _childBegin, _children );
+
+   _connectionParents.resize( _children.size() );
+
+   for( unsigned parent=0; parent < nSegments; parent++ ){
+
+      for( unsigned k = _childBegin[ parent ]; k < _childBegin[ parent + 1 ]; k++ ) _connectionParents[k] = parent;
+
+   }
+
+   // and the connections by their child
+   buildRowsOf( nSegments, _children, NULL, _parentBegin, _parentConnections );
+
+
+}
+
+
+void CompactAutomaton::lengthenSegments(){
+
+
+   buildRows();
+
+   unsigned nSegments = _layers.size();
+   unsigned nConnections = _children.size();
+   unsigned length = _length + 1;
+
+
+   // Every connection becomes a segment: the hits of the child plus the outer hit of the parent
+   std::vector< IHit* > hits( nConnections * length );
+   std::vector< int > layers( nConnections );
+
+   for( unsigned k=0; k < nConnections; k++ ){
+
+
+      unsigned parent = _connectionParents[k];
+      unsigned child = _children[k];
+
+      std::copy( _hits.begin() + child * _length, _hits.begin() + ( child + 1 ) * _length, hits.begin() + k * length );
+      hits[ k * length + _length ] = _hits[ parent * _length + _length - 1 ];
+
+      layers[k] = _layers[ child ];
+
+
+   }
+
+   std::deque< Segment > segments;
+
+   for( unsigned k=0; k < nConnections; k++ ){
+
+      segments.emplace_back( std::vector< IHit* >( hits.begin() + k * length, hits.begin() + ( k + 1 ) * length ) );
+      segments.back().setLayer( layers[k] );
+
+   }
+
+
+   // The new segments of a connection to a segment and of a connection from it share the hits of the segment:
+   // they get connected, if the criteria allow it
+   std::vector< std::pair< unsigned, unsigned > > newConnections;
+
+   for( unsigned middle=0; middle < nSegments; middle++ ){
+
+      for( unsigned p = _parentBegin[ middle ]; p < _parentBegin[ middle + 1 ]; p++ ){
+
+
+         unsigned parent = _parentConnections[p];
+
+         for( unsigned child = _childBegin[ middle ]; child < _childBegin[ middle + 1 ]; child++ ){
+
+            if( areCompatible( &segments[ parent ], &segments[ child ] ) ) newConnections.push_back( std::make_pair( parent, child ) );
+
+         }
+
+
+      }
+
+   }
+
+
+   _length = length;
+   _hits.swap( hits );
+   _layers.swap( layers );
+   _states.assign( nConnections, 0 );
+
+   _childBegin.clear();
+   _children.clear();
+   _connectionParents.clear();
+   _parentBegin.clear();
+   _parentConnections.clear();
+   _newConnections.swap( newConnections );
+
+   _1Segments.clear();
+
+
+}
+
+
+void CompactAutomaton::doAutomaton(){
+
+
+   buildRows();
+
+   unsigned nSegments = _layers.size();
+
+   std::vector< unsigned > order( nSegments );
+   std::iota( order.begin(), order.end(), 0 );
+   std::stable_sort( order.begin(), order.end(), [this]( unsigned a, unsigned b ){ return _layers[a] < _layers[b]; } );
+
+
+   // The state of a segment is how many layers down the longest chain of children below it reaches
+   bool hasChanged = true;
+
+   while( hasChanged ){
+
+
+      hasChanged = false;
+
+      for( unsigned i=0; i < nSegments; i++ ){
+
+
+         unsigned segment = order[i];
+         int state = _states[ segment ];
+
+         for( unsigned k = _childBegin[ segment ]; k < _childBegin[ segment + 1 ]; k++ ){
+
+            unsigned child = _children[k];
+            state = std::max( state, _states[ child ] + _layers[ segment ] - _layers[ child ] );
+
+         }
+
+         if( state != _states[ segment ] ){
+
+            _states[ segment ] = state;
+            hasChanged = true;
+
+         }
+
+
+      }
+
+
+   }
+
+
+}
+
+
+void CompactAutomaton::cleanBadStates(){
+
+
+   buildRows();
+
+   unsigned nSegments = _layers.size();
+
+   // only the segments with a chain reaching the IP (layer 0) are good
+   const unsigned removed = nSegments;
+   std::vector< unsigned > newIndex( nSegments, removed );
+   unsigned nGood = 0;
+
+   for( unsigned segment=0; segment < nSegments; segment++ ){
+
+
+      if( _states[ segment ] != _layers[ segment ] ) continue;
+
+      newIndex[ segment ] = nGood;
+
+      std::copy( _hits.begin() + segment * _length, _hits.begin() + ( segment + 1 ) * _length, _hits.begin() + nGood * _length );
+      _layers[ nGood ] = _layers[ segment ];
+      _states[ nGood ] = _states[ segment ];
+
+      nGood++;
+
+
+   }
+
+
+   // the connections between good segments stay
+   for( unsigned segment=0; segment < nSegments; segment++ ){
+
+      if( newIndex[ segment ] == removed ) continue;
+
+      for( unsigned k = _childBegin[ segment ]; k < _childBegin[ segment + 1 ]; k++ ){
+
+         unsigned child = _children[k];
+         if( newIndex[ child ] != removed ) _newConnections.push_back( std::make_pair( newIndex[ segment ], newIndex[ child ] ) );
+
+      }
+
+   }
+
+   _hits.resize( nGood * _length );
+   _layers.resize( nGood );
+   _states.resize( nGood );
+
+   _childBegin.clear();
+   _children.clear();
+   _connectionParents.clear();
+   _parentBegin.clear();
+   _parentConnections.clear();
+
+   _1Segments.clear();
+
+
+}
+
+
+void CompactAutomaton::resetStates(){
+
+
+   _states.assign( _layers.size(), 0 );
+
+
+}
+
+
+unsigned CompactAutomaton::getNumberOfConnections(){
+
+
+   buildRows();
+
+   return _children.size();
+
+
+}
+
+
+std::vector< std::vector< IHit* > > CompactAutomaton::getTracks( unsigned minHits ){
+
+
+   buildRows();
+
+   std::vector< std::vector< IHit* > > tracks;
+
+   unsigned nSegments = _layers.size();
+
+
+   // the tracks start at the segments without parents, from the inner layers to the outer ones
+   std::vector< unsigned > starts;
+
+   for( unsigned segment=0; segment < nSegments; segment++ ){
+
+      if( _parentBegin[ segment ] == _parentBegin[ segment + 1 ] ) starts.push_back( segment );
+
+   }
+
+   std::stable_sort( starts.begin(), starts.end(), [this]( unsigned a, unsigned b ){ return _layers[a] < _layers[b]; } );
+
+
+   std::vector< IHit* > hits;
+
+   for( unsigned i=0; i < starts.size(); i++ ){
+
+      hits.clear();
+      addTracks( starts[i], hits, minHits, tracks );
+
+   }
+
+   return tracks;
+
+
+}
+
+
+void CompactAutomaton::addTracks( unsigned segment, std::vector< IHit* >& hits, unsigned minHits,
+                                  std::vector< std::vector< IHit* > >& tracks ) const{
+
+
+   IHit* const* segmentHits = &_hits[ segment * _length ];
+
+   // the hits of the track so far (the virtual hits, like the one at the IP, are left out as in the KiTrack::Automaton)
+   unsigned nHits = hits.size();
+
+   // every segment adds its outer hit
+   if( !segmentHits[ _length - 1 ]->isVirtual() ) hits.push_back( segmentHits[ _length - 1 ] );
+
+   if( _childBegin[ segment ] == _childBegin[ segment + 1 ] ){
+
+
+      // the last segment adds all its other hits too
+      for( int i = int( _length ) - 2; i >= 0; i-- ){
+
+         if( !segmentHits[i]->isVirtual() ) hits.push_back( segmentHits[i] );
+
+      }
+
+      if( hits.size() >= minHits ) tracks.push_back( hits );
+
+
+   }
+   else{
+
+      for( unsigned k = _childBegin[ segment ]; k < _childBegin[ segment + 1 ]; k++ ) addTracks( _children[k], hits, minHits, tracks );
+
+   }
+
+   hits.resize( nHits );
+
+
+}
+
+
+bool CompactAutomaton::areCompatible( Segment* parent, Segment* child ) const{
+
+
+   for( unsigned iCrit=0; iCrit < _criteria.size(); iCrit++ ){
+
+      if( !_criteria[iCrit]->areCompatible( parent , child ) ) return false;
+
+   }
+
+   return true;
+
+
+}
@@ -0,0 +1,127 @@
+#include "Crit2Prefilter.h"
+
+#include <algorithm>
+
+
+using namespace KiTrackMarlin;
+
+
+const float Crit2Prefilter::tolerance = 1e-5;
+
+
+Crit2Prefilter::Crit2Prefilter():
+   _useDeltaRho( false ),
+   _deltaRhoMin( 0. ),
+   _deltaRhoMax( 0. ),
+   _useRZRatio( false ),
+   _ratioMin2( 0. ),
+   _ratioMax2( 0. ){
+
+}
+
+
+bool Crit2Prefilter::addCut( const std::string& name, float min, float max ){
+
+
+   if( name == "Crit2_DeltaRho" ){
+
+      _deltaRhoMin = _useDeltaRho ? std::max( _deltaRhoMin, min ) : min;
+      _deltaRhoMax = _useDeltaRho ? std::min( _deltaRhoMax, max ) : max;
+      _useDeltaRho = true;
+
+      return true;
+
+   }
+
+   if( name == "Crit2_RZRatio" ){
+
+      // the criterion compares the squares
+      _ratioMin2 = _useRZRatio ? std::max( _ratioMin2, min*min ) : min*min;
+      _ratioMax2 = _useRZRatio ? std::min( _ratioMax2, max*max ) : max*max;
+      _useRZRatio = true;
+
+      return true;
+
+   }
+
+   return false;
+
+
+}
+
+
+bool Crit2Prefilter::mayConnectRadii( float rParentMin, float rParentMax, float rChildMin, float rChildMax ) const{
+
+
+   if( !_useDeltaRho ) return true;
+
+   float slack = tolerance * ( rParentMax + rChildMax ) + 1e-6;
+
+   // the smallest and the biggest deltaRho of the pairs
+   return ( rParentMin - rChildMax <= _deltaRhoMax + slack ) && ( rParentMax - rChildMin >= _deltaRhoMin - slack );
+
+
+}
+
+
+unsigned Crit2Prefilter::select( const HitStore& hitStore, unsigned parent, unsigned begin, unsigned end, unsigned* selected ) const{
+
+
+   typedef HitStore::Real Real;
+
+   Real xP = hitStore.getX( parent );
+   Real yP = hitStore.getY( parent );
+   Real zP = hitStore.getZ( parent );
+   Real rP = hitStore.getR( parent );
+
+   // the cuts, loosened by the tolerance
+   const Real deltaRhoMin = _deltaRhoMin;
+   const Real deltaRhoMax = _deltaRhoMax;
+   const Real ratioMin2 = _ratioMin2 * ( 1. - tolerance );
+   const Real ratioMax2 = _ratioMax2 * ( 1. + tolerance );
+
+   const bool useDeltaRho = _useDeltaRho;
+   const bool useRZRatio = _useRZRatio;
+
+   unsigned nSelected = 0;
+   unsigned char pass[ HitStore::blockSize ];
+
+   for( unsigned blockBegin = begin; blockBegin < end; blockBegin += HitStore::blockSize ){
+
+
+      unsigned n = std::min( HitStore::blockSize, end - blockBegin );
+
+      for( unsigned j=0; j < n; j++ ){
+
+
+         unsigned child = blockBegin + j;
+
+         Real r = hitStore.getR( child );
+         Real deltaRho = rP - r;
+         Real slack = tolerance * ( rP + r ) + Real( 1e-6 );
+
+         bool passDeltaRho = ( deltaRho >= deltaRhoMin - slack ) & ( deltaRho <= deltaRhoMax + slack );
+
+         Real dx = xP - hitStore.getX( child );
+         Real dy = yP - hitStore.getY( child );
+         Real dz = zP - hitStore.getZ( child );
+         Real dist2 = dx*dx + dy*dy + dz*dz;
+         Real dz2 = dz*dz;
+
+         // hits at the same z: the ratio is not defined, leave them to the criterion
+         bool passRZRatio = ( dz2 == 0 ) | ( ( dist2 >= ratioMin2 * dz2 ) & ( dist2 <= ratioMax2 * dz2 ) );
+
+         pass[j] = ( passDeltaRho | !useDeltaRho ) & ( passRZRatio | !useRZRatio );
+
+
+      }
+
+      nSelected += HitStore::compact( pass, n, blockBegin, selected + nSelected );
+
+
+   }
+
+   return nSelected;
+
+
+}
@@ -0,0 +1,166 @@
+#include "CriteriaRounds.h"
+
+#include <algorithm>
+
+#include "marlin/VerbosityLevels.h"
+
+#include "Criteria/Criteria.h"
+
+
+using namespace KiTrackMarlin;
+
+
+CriteriaRounds::CriteriaRounds( const std::vector< std::string >& criteriaNames,
+                                const std::map< std::string , std::vector< float > >& critMinima,
+                                const std::map< std::string , std::vector< float > >& critMaxima ){
+
+
+   // the number of rounds: as many as the most values any criterion has
+   unsigned nRounds = 1;
+
+   for( unsigned i=0; i < criteriaNames.size(); i++ ){
+
+      nRounds = std::max< unsigned >( nRounds, critMinima.find( criteriaNames[i] )->second.size() );
+      nRounds = std::max< unsigned >( nRounds, critMaxima.find( criteriaNames[i] )->second.size() );
+
+   }
+
+   _rounds.resize( nRounds );
+
+
+   for( unsigned round=0; round < nRounds; round++ ){
+
+      for( unsigned i=0; i < criteriaNames.size(); i++ ){
+
+
+         const std::vector< float >& minima = critMinima.find( criteriaNames[i] )->second;
+         const std::vector< float >& maxima = critMaxima.find( criteriaNames[i] )->second;
+
+         // use the value corresponding to the round, if there are no new ones for this criterion, the last one stays
+         CriterionValues values;
+         values.name = criteriaNames[i];
+         values.min = minima[ std::min< unsigned >( round, minima.size() - 1 ) ];
+         values.max = maxima[ std::min< unsigned >( round, maxima.size() - 1 ) ];
+
+         _rounds[ round ].values.push_back( values );
+
+         streamlog_out( DEBUG3 ) << "Criterion " << values.name << ": Min = " << values.min << ", Max = " << values.max
+                                 << ", round " << round << "\n";
+
+      }
+
+   }
+
+
+   createCriteria();
+
+
+}
+
+
+CriteriaRounds::CriteriaRounds( const CriteriaRounds& other ){
+
+
+   _rounds.resize( other._rounds.size() );
+
+   for( unsigned round=0; round < _rounds.size(); round++ ) _rounds[ round ].values = other._rounds[ round ].values;
+
+   createCriteria();
+
+
+}
+
+
+CriteriaRounds::~CriteriaRounds(){
+
+
+   for( unsigned round=0; round < _rounds.size(); round++ ){
+
+      Round& r = _rounds[ round ];
+
+      for( unsigned i=0; i < r.crit2Vec.size(); i++ ) delete r.crit2Vec[i];
+      for( unsigned i=0; i < r.crit3Vec.size(); i++ ) delete r.crit3Vec[i];
+      for( unsigned i=0; i < r.crit4Vec.size(); i++ ) delete r.crit4Vec[i];
+
+   }
+
+
+}
+
+
+void CriteriaRounds::createCriteria(){
+
+
+   for( unsigned round=0; round < _rounds.size(); round++ ){
+
+
+      Round& r = _rounds[ round ];
+
+      r.crit2Nested = ( round > 0 );
+
+      for( unsigned i=0; i < r.values.size(); i++ ){
+
+
+         const CriterionValues& values = r.values[i];
+
+         ICriterion* crit = Criteria::createCriterion( values.name, values.min , values.max );
+
+         std::string type = crit->getType();
+
+         if( ( ( type == "3Hit" ) || ( type == "4Hit" ) ) && CachedCircleCriterion::isCacheable( values.name ) ){
+
+            CachedCircleCriterion* circleCrit = new CachedCircleCriterion( crit, values.name, values.min, values.max );
+            r.circleCriteria.push_back( circleCrit );
+            crit = circleCrit;
+
+         }
+
+
+         // Add the new criterion to the corresponding vector
+         if( type == "2Hit" ){
+
+            r.crit2Vec.push_back( crit );
+            r.crit2Prefilter.addCut( values.name, values.min, values.max );
+
+            // the criteria are in the same order in every round
+            if( round > 0 ){
+
+               const CriterionValues& valuesBefore = _rounds[ round - 1 ].values[i];
+
+               if( ( values.min < valuesBefore.min ) || ( values.max > valuesBefore.max ) ) r.crit2Nested = false;
+
+            }
+
+         }
+         else if( type == "3Hit" ){
+
+            r.crit3Vec.push_back( crit );
+
+         }
+         else if( type == "4Hit" ){
+
+            r.crit4Vec.push_back( crit );
+
+         }
+         else delete crit;
+
+
+      }
+
+   }
+
+
+}
+
+
+void CriteriaRounds::setCircleCache( TripletCircleCache* cache ){
+
+
+   for( unsigned round=0; round < _rounds.size(); round++ ){
+
+      for( unsigned i=0; i < _rounds[ round ].circleCriteria.size(); i++ ) _rounds[ round ].circleCriteria[i]->setCache( cache );
+
+   }
+
+
+}
@@ -87,6 +87,18 @@ EndcapTrack & EndcapTrack::operator= (const EndcapTrack & f){
 
 
 
+TrackImpl* EndcapTrack::releaseLcioTrack(){
+   
+   
+   TrackImpl* lcioTrack = _lcioTrack;
+   _lcioTrack = NULL;
+   
+   return lcioTrack;
+   
+   
+}
+
+
 void EndcapTrack::addHit( IEndcapHit* hit ){
    
    
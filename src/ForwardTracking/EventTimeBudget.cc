@@ -0,0 +1,85 @@
+#include "EventTimeBudget.h"
+
+
+using namespace KiTrackMarlin;
+
+
+EventTimeBudget::EventTimeBudget(){
+
+   start( 0. );
+
+}
+
+
+void EventTimeBudget::start( double budgetMs ){
+
+
+   _limited = ( budgetMs > 0. );
+
+   _deadline = std::chrono::steady_clock::now()
+               + std::chrono::duration_cast< std::chrono::steady_clock::duration >( std::chrono::duration< double, std::milli >( budgetMs ) );
+
+   for( unsigned i=0; i < nDegradations; i++ ) _degraded[i] = false;
+
+
+}
+
+
+bool EventTimeBudget::isExhausted() const{
+
+
+   return _limited && ( std::chrono::steady_clock::now() > _deadline );
+
+
+}
+
+
+bool EventTimeBudget::isDegraded() const{
+
+
+   for( unsigned i=0; i < nDegradations; i++ ){
+
+      if( _degraded[i] ) return true;
+
+   }
+
+   return false;
+
+
+}
+
+
+std::string EventTimeBudget::getDegradationNames() const{
+
+
+   std::string names;
+
+   for( unsigned i=0; i < nDegradations; i++ ){
+
+      if( !_degraded[i] ) continue;
+
+      if( !names.empty() ) names += ",";
+      names += getDegradationName( Degradation( i ) );
+
+   }
+
+   return names;
+
+
+}
+
+
+const char* EventTimeBudget::getDegradationName( Degradation degradation ){
+
+
+   switch( degradation ){
+
+      case TighterRound:          return "TighterRound";
+      case CappedOverlapVersions: return "CappedOverlapVersions";
+      case SimpleSubset:          return "SimpleSubset";
+      default:                    return "Unknown";
+
+   }
+
+
+}
@@ -0,0 +1,144 @@
+#include "FitResultCache.h"
+
+#include <algorithm>
+#include <functional>
+
+
+using namespace KiTrackMarlin;
+
+
+FitResultCache::FitResultCache():
+   _nHelixLookups( 0 ),
+   _nHelixHits( 0 ),
+   _nKalmanLookups( 0 ),
+   _nKalmanHits( 0 ){
+
+}
+
+
+bool FitResultCache::findHelix( const std::vector< IHit* >& hits, HelixResult& result ){
+
+
+   HitSet key = getKey( hits );
+
+   _nHelixLookups++;
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   std::unordered_map< HitSet, Entry, HitSetHash >::const_iterator it = _entries.find( key );
+   if( ( it == _entries.end() ) || !it->second.helixKnown ) return false;
+
+   result = it->second.helix;
+   _nHelixHits++;
+
+   return true;
+
+
+}
+
+
+bool FitResultCache::findKalman( const std::vector< IHit* >& hits, KalmanResult& result ){
+
+
+   HitSet key = getKey( hits );
+
+   _nKalmanLookups++;
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   std::unordered_map< HitSet, Entry, HitSetHash >::const_iterator it = _entries.find( key );
+   if( ( it == _entries.end() ) || !it->second.kalmanKnown ) return false;
+
+   result = it->second.kalman;
+   _nKalmanHits++;
+
+   return true;
+
+
+}
+
+
+void FitResultCache::storeHelix( const std::vector< IHit* >& hits, const HelixResult& result ){
+
+
+   HitSet key = getKey( hits );
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   Entry& entry = _entries[ key ];
+
+   if( !entry.helixKnown ){ // if two threads fitted the same hits, the first result stays
+
+      entry.helix = result;
+      entry.helixKnown = true;
+
+   }
+
+
+}
+
+
+void FitResultCache::storeKalman( const std::vector< IHit* >& hits, const KalmanResult& result ){
+
+
+   HitSet key = getKey( hits );
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   Entry& entry = _entries[ key ];
+
+   if( !entry.kalmanKnown ){
+
+      entry.kalman = result;
+      entry.kalmanKnown = true;
+
+   }
+
+
+}
+
+
+void FitResultCache::clear(){
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   _entries.clear();
+
+   _nHelixLookups = 0;
+   _nHelixHits = 0;
+   _nKalmanLookups = 0;
+   _nKalmanHits = 0;
+
+
+}
+
+
+std::size_t FitResultCache::HitSetHash::operator()( const HitSet& hitSet ) const{
+
+
+   std::hash< IHit* > hashHit;
+   std::size_t seed = hitSet.size();
+
+   for( unsigned i=0; i < hitSet.size(); i++ ){
+
+      seed ^= hashHit( hitSet[i] ) + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 );
+
+   }
+
+   return seed;
+
+
+}
+
+
+FitResultCache::HitSet FitResultCache::getKey( const std::vector< IHit* >& hits ){
+
+
+   HitSet key( hits );
+   std::sort( key.begin(), key.end() );
+
+   return key;
+
+
+}
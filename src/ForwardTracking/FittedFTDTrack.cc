@@ -0,0 +1,28 @@
+#include "FittedFTDTrack.h"
+
+#include "IMPL/TrackStateImpl.h"
+
+
+using namespace KiTrackMarlin;
+
+
+void FittedFTDTrack::fit() throw( FitterException ){
+
+
+   _fitter.reset();
+
+   std::unique_ptr< Fitter > fitter( new Fitter( _lcioTrack , _trkSystem ) );
+
+
+   _lcioTrack->setChi2( fitter->getChi2( lcio::TrackState::AtIP ) );
+   _lcioTrack->setNdf( fitter->getNdf( lcio::TrackState::AtIP ) );
+   _chi2Prob = fitter->getChi2Prob( lcio::TrackState::AtIP );
+
+   IMPL::TrackStateImpl* trkState = new IMPL::TrackStateImpl( *fitter->getTrackState( lcio::TrackState::AtIP ) ) ;
+   trkState->setLocation( lcio::TrackState::AtIP ) ;
+   _lcioTrack->addTrackState( trkState );
+
+   _fitter = std::move( fitter ); // only a successful fit is kept
+
+
+}
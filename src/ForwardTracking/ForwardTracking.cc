@@ -1,6 +1,10 @@
 #include "ForwardTracking.h"
 
 #include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <sstream>
 
 #include "EVENT/TrackerHit.h"
 #include "EVENT/Track.h"
@@ -23,18 +27,32 @@
 //----From KiTrack-----------------------------
 #include "KiTrack/SubsetHopfieldNN.h"
 #include "KiTrack/SubsetSimple.h"
-#include "KiTrack/SegmentBuilder.h"
 #include "KiTrack/Automaton.h"
 
 //----From KiTrackMarlin-----------------------
 #include "ILDImpl/FTDTrack.h"
 #include "ILDImpl/FTDHit01.h"
-#include "ILDImpl/FTDNeighborPetalSecCon.h"
 #include "ILDImpl/FTDSectorConnector.h"
 #include "Tools/KiTrackMarlinTools.h"
 #include "Tools/KiTrackMarlinCEDTools.h"
 #include "Tools/FTDHelixFitter.h"
 
+#include "ParallelFor.h"
+#include "SectorIndexSegmentBuilder.h"
+#include "AutomatonEngine.h"
+#include "CompactAutomaton.h"
+#include "TripletCircleCache.h"
+#include "OverlapHitGrid.h"
+#include "OverlapVersionEnumerator.h"
+#include "CriteriaRounds.h"
+#include "TrackingStatistics.h"
+#include "FitResultCache.h"
+#include "IncrementalKalmanFitter.h"
+#include "TrackConflictGraph.h"
+#include "SubsetBranchAndBound.h"
+#include "SubsetSeededHopfieldNN.h"
+#include "FittedFTDTrack.h"
+
 
 using namespace lcio ;
 using namespace marlin ;
@@ -124,6 +142,21 @@ ForwardTracking::ForwardTracking() : Processor("ForwardTracking") {
                               _HNN_TInf,
                               double( 0.1 ) );
    
+   registerProcessorParameter("SubsetComponents",
+                              "Split the track candidates into groups only in conflict among each other and find the best subset of each group on its own",
+                              _subsetComponents,
+                              bool( false ) );
+   
+   registerProcessorParameter("SubsetExactMaxSize",
+                              "Groups of track candidates up to this size get their best subset exactly (branch and bound), larger ones from the BestSubsetFinder",
+                              _subsetExactMaxSize,
+                              int( 12 ) );
+   
+   registerProcessorParameter("SubsetThreads",
+                              "The number of threads used to find the best subsets of the groups of track candidates",
+                              _subsetThreads,
+                              int( 1 ) );
+   
    
    
    // Security checks to prevent combinatorial disasters
@@ -139,6 +172,16 @@ ForwardTracking::ForwardTracking() : Processor("ForwardTracking") {
                               _maxHitsPerSector,
                               int(1000));
    
+   registerProcessorParameter("SplitOverflowingSectors",
+                              "Split sectors with more than MaxHitsPerSector hits into sub-sectors by radius instead of dropping them",
+                              _splitOverflowingSectors,
+                              bool(false));
+   
+   registerProcessorParameter("MaxSectorSplitDepth",
+                              "How often a sector with more than MaxHitsPerSector hits may be halved at most, if SplitOverflowingSectors is set",
+                              _maxSectorSplitDepth,
+                              int(3));
+   
    
    //For fitting:
    
@@ -168,6 +211,96 @@ ForwardTracking::ForwardTracking() : Processor("ForwardTracking") {
                               "Set to false if no track state at the calorimeter is needed",
                               _getTrackStateAtCaloFace,
                               bool(true));
+   
+   registerProcessorParameter("NumberOfFitThreads",
+                              "The number of threads used to fit the track candidates. Every thread uses its own MarlinTrkSystem. For now only 1 is supported",
+                              _nFitThreads,
+                              int(1));
+   
+   registerProcessorParameter("SplitSides",
+                              "Search the tracks on the forward and the backward side of the FTD as two independent jobs running at the same time",
+                              _splitSides,
+                              bool(false));
+   
+   registerProcessorParameter("IncrementalRounds",
+                              "If the Automaton is redone with tighter cuts, filter the connections of the last round instead of searching them again",
+                              _incrementalRounds,
+                              bool(false));
+   
+   registerProcessorParameter("BatchedCrit2Prefilter",
+                              "Test the cuts of Crit2_DeltaRho and Crit2_RZRatio for a hit against all hits of a connected sector at once, before the 2-hit criteria",
+                              _batchedCrit2Prefilter,
+                              bool(false));
+   
+   registerProcessorParameter("ReuseCandidateFit",
+                              "Take the track states of the saved tracks from the Kalman fit of the track candidate, instead of fitting them again",
+                              _reuseCandidateFit,
+                              bool(true));
+   
+   registerProcessorParameter("UseFitCache",
+                              "Remember the results of the helix and Kalman fits in an event, so the same set of hits is only fitted once",
+                              _useFitCache,
+                              bool(true));
+   
+   registerProcessorParameter("StatisticsFile",
+                              "A CSV file for the summary (mean, median, 99th percentile) of the times and counters of the stages of all events. Empty = no file",
+                              _statisticsFile,
+                              std::string(""));
+   
+   registerProcessorParameter("MaxOverlapVersions",
+                              "The maximum number of versions of a track with hits from overlapping petals. 0 means all combinations",
+                              _maxOverlapVersions,
+                              int(0));
+   
+   registerProcessorParameter("KalmanFitBestHelixVersions",
+                              "If only the best version of a track is taken: Kalman fit only this many versions with the best helix fit (more only if their fits fail). 0 = all",
+                              _kalmanFitBestHelixVersions,
+                              int(0));
+   
+   registerProcessorParameter("IncrementalOverlapFit",
+                              "Fit a raw track once and judge the hits from overlapping petals by their chi2 increment, only the chosen version gets a full fit",
+                              _incrementalOverlapFit,
+                              bool(false));
+   
+   registerProcessorParameter("OverlapChi2IncrementMax",
+                              "The maximum chi2 increment of a hit from an overlapping petal to be added in the IncrementalOverlapFit mode",
+                              _overlapChi2IncrementMax,
+                              double(10.));
+   
+   registerProcessorParameter("EventTimeBudget",
+                              "The time in ms an event may take. Once it is used up, the rest of the event is done the cheaper way (tighter round, capped overlap versions, SubsetSimple). 0 = no limit",
+                              _eventTimeBudget,
+                              double(0.));
+   
+   registerProcessorParameter("TimeBudgetMaxOverlapVersions",
+                              "The maximum number of versions of a raw track with hits from overlapping petals, once the EventTimeBudget is used up",
+                              _timeBudgetMaxOverlapVersions,
+                              int(1));
+   
+   registerProcessorParameter("PredictFirstRound",
+                              "Predict the connections of the rounds of the Cellular Automaton from the occupancies of the sectors and start at the first round predicted to stay under MaxConnectionsAutomaton",
+                              _predictFirstRound,
+                              bool(false));
+   
+   registerProcessorParameter("RoundPredictorAcceptances",
+                              "The calibrated fraction of the pairs of hits in connected sectors, that get connected, for every round (from the report of an earlier run). Rounds without a value are never skipped",
+                              _roundPredictorAcceptances,
+                              std::vector< float >());
+   
+   registerProcessorParameter("RoundPredictorSafetyFactor",
+                              "A round is only skipped, if its predicted connections are more than this factor times MaxConnectionsAutomaton",
+                              _roundPredictorSafetyFactor,
+                              float(2.));
+   
+   registerProcessorParameter("CompactAutomaton",
+                              "Run the Cellular Automaton on flat arrays (CompactAutomaton) instead of the KiTrack::Automaton. The tracks are the same",
+                              _compactAutomaton,
+                              bool(false));
+   
+   registerProcessorParameter("CacheTripletCircles",
+                              "Let the criteria calculated from circles through hit triplets (Crit3_PT, Crit4_DistOfCircleCenters) take the circles from a cache of the event",
+                              _cacheTripletCircles,
+                              bool(false));
   
 
    // The Criteria for the Cellular Automaton:
@@ -220,6 +353,8 @@ void ForwardTracking::init() {
 
    _nRun = 0 ;
    _nEvt = 0 ;
+   _nTrackCandidates = 0;
+   _nTrackCandidatesPlus = 0;
 
    _useCED = false; // Setting this to on will initialise CED in the processor and tracks or segments (from the CA)
                     // can be printed. As this is mainly used for debugging it is not a steerable parameter.
@@ -252,6 +387,9 @@ void ForwardTracking::init() {
    
    _sectorSystemFTD = new SectorSystemFTD( nLayers, nModules , nSensors );
    
+   // the sectors are numbered from 0 for every side, layer, module and sensor
+   _nSectors = 2 * nLayers * nModules * nSensors;
+   
    
    // Get the B Field in z direction
 
@@ -264,22 +402,24 @@ void ForwardTracking::init() {
    /*       Initialise the MarlinTrkSystem, needed by the tracks for fitting                     */
    /**********************************************************************************************/
 
-  // set up the geometry needed by TrkSystem
-  _trkSystem =  MarlinTrk::Factory::createMarlinTrkSystem( _trkSystemName , 0 , "" ) ;
-  
-  if( _trkSystem == 0 ){
-    
-    throw EVENT::Exception( std::string("  Cannot initialize MarlinTrkSystem of Type: ") + _trkSystemName  ) ;
-    
-  }
+   // Every thread fitting tracks needs its own MarlinTrkSystem, so they are kept in a pool.
+   // Create them already here, so an invalid configuration is noticed right away.
+   if( _nFitThreads < 1 ) _nFitThreads = 1;
    
-   // set the options   
-   _trkSystem->setOption( MarlinTrk::IMarlinTrkSystem::CFG::useQMS,        _MSOn ) ;       //multiple scattering
-   _trkSystem->setOption( MarlinTrk::IMarlinTrkSystem::CFG::usedEdx,       _ElossOn) ;     //energy loss
-   _trkSystem->setOption( MarlinTrk::IMarlinTrkSystem::CFG::useSmoothing,  _SmoothOn) ;    //smoothing
-
-   // initialise the tracking system
-   _trkSystem->init() ;
+   _trkSystemPool = new MarlinTrkSystemPool( _trkSystemName, _MSOn, _ElossOn, _SmoothOn );
+   
+   // The MarlinTrk::Factory only has one (shared) system per type, so there can't be more fitting threads for now
+   if( unsigned( _nFitThreads ) > _trkSystemPool->getMaxConcurrentUsers() ){
+      
+      std::stringstream s;
+      s << "ForwardTracking: NumberOfFitThreads = " << _nFitThreads << " is not supported, the MarlinTrkSystems of type "
+        << _trkSystemName << " can't be used by more than " << _trkSystemPool->getMaxConcurrentUsers() << " thread(s) at the same time";
+      
+      throw EVENT::Exception( s.str() );
+      
+   }
+   
+   _trkSystemPool->reserve( _nFitThreads );
    
    
    
@@ -310,6 +450,12 @@ void ForwardTracking::init() {
    }
    
    
+   // The criteria of all rounds of the Cellular Automaton. Every EventContext gets its own copies of them. 
+   _criteriaRounds = new CriteriaRounds( _criteriaNames, _critMinima, _critMaxima );
+   
+   _roundPredictor = new RoundPredictor( _criteriaRounds->getNumberOfRounds(), _roundPredictorAcceptances, _roundPredictorSafetyFactor );
+   
+   
    
 
 }
@@ -324,7 +470,14 @@ void ForwardTracking::processRunHeader( LCRunHeader* ) {
 
 void ForwardTracking::processEvent( LCEvent * evt ) { 
 
-   streamlog_out( DEBUG4 ) << "processing event number " << _nEvt << "\n";
+   // Everything belonging to this event is kept in the context, so several events can be processed at the same time.
+   // The contexts are reused, so their memory doesn't have to be allocated again for every event.
+   std::unique_ptr< EventContext , std::function< void( EventContext* ) > > context( acquireEventContext(), 
+                                                                                     [this]( EventContext* c ){ releaseEventContext( c ); } );
+   context->eventNumber = _nEvt++;
+   context->timeBudget.start( _eventTimeBudget );
+   
+   streamlog_out( DEBUG4 ) << "processing event number " << context->eventNumber << "\n";
    
    //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
    //                                                                                                              //
@@ -355,14 +508,14 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
   
    // Reset the quality flag of the output track collection (we start with the assumption that our results are good.
    // If anything happens along the way, we modify this value )
-   _output_track_col_quality = _output_track_col_quality_GOOD;
-
-   std::vector< IHit* > hitsTBD; //Hits to be deleted at the end
-   _map_sector_hits.clear();
+   context->quality = _output_track_col_quality_GOOD;
+   
+   TrackingStatistics& statistics = context->statistics;
+   StageTimer timer;
 
    
    /**********************************************************************************************/
-   /*    Read in the collections, create hits from the TrackerHits and store them in a map       */
+   /*    Read in the collections and create hits from the TrackerHits                            */
    /**********************************************************************************************/
    
    streamlog_out( DEBUG4 ) << "\t\t---Reading in Collections---\n" ;
@@ -407,10 +560,9 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
          << " " << KiTrackMarlin::getPositionInfo( trackerHit )<< "\n";
          
          //Make an FTDHit01 from the TrackerHit 
-         FTDHit01* ftdHit = new FTDHit01 ( trackerHit , _sectorSystemFTD );
-         hitsTBD.push_back(ftdHit); //so we can easily delete every created hit afterwards
+         FTDHit01* ftdHit = context->hitPool.create( trackerHit , _sectorSystemFTD ); // lives until the end of the event
+         context->hits.push_back(ftdHit);
          
-         _map_sector_hits[ ftdHit->getSector() ].push_back( ftdHit );         
          
       }
       
@@ -419,29 +571,66 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
 
 
    
-   if( !_map_sector_hits.empty() ){
+   if( !context->hits.empty() ){
+      
+      
+      /**********************************************************************************************/
+      /*                Add the IP as virtual hit for forward and backward                          */
+      /**********************************************************************************************/
+      
+      IHit* virtualIPHitForward = createVirtualIPHit(1 , context->virtualHitPool );
+      context->hits.push_back( virtualIPHitForward );
+      
+      IHit* virtualIPHitBackward = createVirtualIPHit(-1 , context->virtualHitPool );
+      context->hits.push_back( virtualIPHitBackward );
+      
+      
+      /**********************************************************************************************/
+      /*                Sort the hits into their sectors                                            */
+      /**********************************************************************************************/
+      
+      SectorHitIndex& sectorHitIndex = context->sectorHitIndex;
+      sectorHitIndex.build( context->hits );
       
       
       /**********************************************************************************************/
       /*                Check if no sector is overflowing with hits                                 */
       /**********************************************************************************************/
       
+      // (a copy, as dropping a sector changes the occupied sectors)
+      std::vector< int > sectors = sectorHitIndex.getOccupiedSectors();
+      
+      statistics.addTime( TrackingStatistics::HitIngestion, timer.restart() );
       
-      std::map< int , std::vector< IHit* > >::iterator it;
+      // the most hits a sector may have, when it is split
+      double maxHitsSplit = _splitOverflowingSectors ? double( _maxHitsPerSector ) * pow( 2., _maxSectorSplitDepth ) : 0.;
       
-      for( it=_map_sector_hits.begin(); it != _map_sector_hits.end(); it++ ){
+      for( unsigned i=0; i < sectors.size(); i++ ){
        
+         int sector = sectors[i];
+         int nHits = sectorHitIndex.getNumberOfHits( sector );
+         streamlog_out( DEBUG2 ) << "Number of hits in sector " << sector << " = " << nHits << "\n";
          
-         int nHits = it->second.size();
-         streamlog_out( DEBUG2 ) << "Number of hits in sector " << it->first << " = " << nHits << "\n";
-         
-         if( nHits > _maxHitsPerSector ){
+         if( ( nHits > _maxHitsPerSector ) && ( nHits <= maxHitsSplit ) ){
+            
+            // the segment builder splits it into rings
+            sectorHitIndex.sortSectorByRadius( sector );
+            
+            streamlog_out( WARNING ) << " ### EVENT " << evt->getEventNumber() << " :: RUN " << evt->getRunNumber() << " \n ### Number of Hits in FTD Sector " << sector << ": " << nHits << " > " << _maxHitsPerSector << " (MaxHitsPerSector)\n : This sector will be split into sub-sectors, and QualityCode set to \"Fair\" " << std::endl;
+            
+            if( context->quality != _output_track_col_quality_POOR ) context->quality = _output_track_col_quality_FAIR;
             
-            it->second.clear(); //delete the hits in this sector, it will be dropped
+            statistics.add( TrackingStatistics::SplitSectors );
             
-            streamlog_out(ERROR)  << " ### EVENT " << evt->getEventNumber() << " :: RUN " << evt->getRunNumber() << " \n ### Number of Hits in FTD Sector " << it->first << ": " << nHits << " > " << _maxHitsPerSector << " (MaxHitsPerSector)\n : This sector will be dropped from track search, and QualityCode set to \"Poor\" " << std::endl;
+         }
+         else if( nHits > _maxHitsPerSector ){
+            
+            sectorHitIndex.dropSector( sector ); //delete the hits in this sector, it will be dropped
+            statistics.add( TrackingStatistics::DroppedSectors );
+            
+            streamlog_out(ERROR)  << " ### EVENT " << evt->getEventNumber() << " :: RUN " << evt->getRunNumber() << " \n ### Number of Hits in FTD Sector " << sector << ": " << nHits << " > " << _maxHitsPerSector << " (MaxHitsPerSector)\n : This sector will be dropped from track search, and QualityCode set to \"Poor\" " << std::endl;
            
-            _output_track_col_quality = _output_track_col_quality_POOR; // We had to drop hits, so the quality of the result is decreased
+            context->quality = _output_track_col_quality_POOR; // We had to drop hits, so the quality of the result is decreased
             
          }
          
@@ -453,432 +642,138 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
       
       streamlog_out( DEBUG4 ) << "\t\t---Overlapping Hits---\n" ;
       
-      std::map< IHit* , std::vector< IHit* > > map_hitFront_hitsBack = getOverlapConnectionMap( _map_sector_hits, _sectorSystemFTD, _overlappingHitsDistMax);
+      statistics.add( TrackingStatistics::Hits, sectorHitIndex.getNumberOfHits() );
+      statistics.addTime( TrackingStatistics::SectorSplitting, timer.restart() );
       
+      std::map< IHit* , std::vector< IHit* > > map_hitFront_hitsBack = context->overlapHitGrid.getOverlapConnectionMap( sectorHitIndex, _overlappingHitsDistMax );
       
-     
-      /**********************************************************************************************/
-      /*                Add the IP as virtual hit for forward and backward                          */
-      /**********************************************************************************************/
+      statistics.addTime( TrackingStatistics::OverlapMap, timer.restart() );
       
-      IHit* virtualIPHitForward = createVirtualIPHit(1 , _sectorSystemFTD );
-      hitsTBD.push_back( virtualIPHitForward );
-      _map_sector_hits[ virtualIPHitForward->getSector() ].push_back( virtualIPHitForward );
       
-      IHit* virtualIPHitBackward = createVirtualIPHit(-1 , _sectorSystemFTD );
-      hitsTBD.push_back( virtualIPHitBackward );
-      _map_sector_hits[ virtualIPHitBackward->getSector() ].push_back( virtualIPHitBackward );
      
-      
       /**********************************************************************************************/
-      /*                SegmentBuilder and Cellular Automaton                                       */
+      /*                Split the track search into independent jobs                                */
       /**********************************************************************************************/
       
-      unsigned round = 0; // the round we are in
-      std::vector < RawTrack > rawTracks;
+      // The forward and the backward side of the FTD don't share any hits, so there can't be a track or a segment
+      // connecting them. If SplitSides is set, they are searched as two independent jobs, that run at the same time.
+      // Otherwise there is one job with all the hits.
+      std::vector< const SectorHitIndex* > jobSectorHitIndices;
       
-      // The following while loop ideally only runs once. (So we do round 0 and everything works)
-      // It will repeat as long as the Automaton creates too many connections and as long as there are new criteria
-      // parameters to use to cut down the problem.
-      // Ideally already in round 0, there is a reasonable number of connections (not more than _maxConnectionsAutomaton), 
-      // so the loop will be left. If however there are too many connections we stay in the loop and use 
-      // (hopefully) tighter cut offs (if provided in the steering). This should prevent combinatorial breakdown
-      // for very evil events.
-      while( setCriteria( round ) ){
-         
-         
-         round++; // count up the round we are in
-         
-         
-         /**********************************************************************************************/
-         /*                Build the segments                                                          */
-         /**********************************************************************************************/
+      if( _splitSides ){
          
-         streamlog_out( DEBUG4 ) << "\t\t---SegementBuilder---\n" ;
+         context->sideHits[0].clear();
+         context->sideHits[1].clear();
          
-         //Create a segmentbuilder
-         SegmentBuilder segBuilder( _map_sector_hits );
+         const std::vector< int >& occupiedSectors = sectorHitIndex.getOccupiedSectors();
          
-         segBuilder.addCriteria ( _crit2Vec ); // Add the criteria on when to connect two hits. The vector has been filled by the method setCriteria
-         
-         //Also load hit connectors
-         unsigned layerStepMax = 1; // how many layers to go at max
-         unsigned petalStepMax = 1; // how many petals to go at max
-         unsigned lastLayerToIP = 5;// layer 1,2,3 and 4 get connected directly to the IP
-         FTDSectorConnector secCon( _sectorSystemFTD , layerStepMax , petalStepMax , lastLayerToIP );
-         
-         
-         segBuilder.addSectorConnector ( & secCon ); // Add the sector connector (so the SegmentBuilder knows what hits from different sectors it is allowed to look for connections)
-         
-         
-         // And get out the Cellular Automaton with the 1-segments 
-         Automaton automaton = segBuilder.get1SegAutomaton();
-         
-         // Check if there are not too many connections
-         if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
-            
-            streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
-            << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
-            continue;
+         for( unsigned i=0; i < occupiedSectors.size(); i++ ){
             
-         }
-         
-         
-         
-         /**********************************************************************************************/
-         /*                Automaton                                                                   */
-         /**********************************************************************************************/
-         
-         
-         
-         streamlog_out( DEBUG4 ) << "\t\t---Automaton---\n" ;
-         
-         if( _useCED ) KiTrackMarlin::drawAutomatonSegments( automaton ); // draws the 1-segments (i.e. hits)
-         
-         
-         /*******************************/
-         /*      2-hit segments         */
-         /*******************************/
-         
-         streamlog_out( DEBUG4 ) << "\t\t--2-hit-Segments--\n" ;
-         
-         streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
-         
-         automaton.clearCriteria();
-         automaton.addCriteria( _crit3Vec );  // Add the criteria for 3 hits (i.e. 2 2-hit segments )
-         
-         
-         // Let the automaton lengthen its 1-hit-segments to 2-hit-segments
-         automaton.lengthenSegments();
-        
-         
-         // So now we have 2-hit-segments and are ready to perform the Cellular Automaton.
-         
-         // Perform the automaton
-         automaton.doAutomaton();
-         
-         
-         // Clean segments with bad states
-         automaton.cleanBadStates();
-         
-        
-         // Reset the states of all segments
-         automaton.resetStates();
-        
-         streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
-         
-         
-         // Check if there are not too many connections
-         if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
+            int sector = occupiedSectors[i];
+            std::vector< IHit* >& sideHits = context->sideHits[ _sectorSystemFTD->getSide( sector ) > 0 ? 0 : 1 ];
             
-            streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
-            << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
-            continue;
+            sideHits.insert( sideHits.end(), sectorHitIndex.beginHits( sector ), sectorHitIndex.endHits( sector ) );
             
          }
          
-         /*******************************/
-         /*      3-hit segments         */
-         /*******************************/
-         streamlog_out( DEBUG4 ) << "\t\t--3-hit-Segments--\n" ;
-         
-         
-         automaton.clearCriteria();
-         automaton.addCriteria( _crit4Vec );      
-         
-         
-         // Lengthen the 2-hit-segments to 3-hits-segments
-         automaton.lengthenSegments();
-         
-         
-         // Perform the Cellular Automaton
-         automaton.doAutomaton();
-         
-         //Clean segments with bad states
-         automaton.cleanBadStates();
-         
-         
-         //Reset the states of all segments
-         automaton.resetStates();
-         
-         
-         streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
-         
-         
-         // Check if there are not too many connections
-         if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
+         for( unsigned iSide=0; iSide < 2; iSide++ ){
             
-            streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
-            << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
-            continue;
+            context->sideSectorHitIndex[iSide].build( context->sideHits[iSide] );
+            jobSectorHitIndices.push_back( &context->sideSectorHitIndex[iSide] );
             
          }
          
-         // get the raw tracks (raw track = just a vector of hits, the most rudimentary form of a track)
-         rawTracks = automaton.getTracks( 3 );
+      }
+      else{
          
-         break; // if we reached this place all went well and we don't need another round --> exit the loop
+         jobSectorHitIndices.push_back( &sectorHitIndex );
          
       }
       
-      streamlog_out( DEBUG4 ) << "Automaton returned " << rawTracks.size() << " raw tracks \n";
-      
       
       /**********************************************************************************************/
-      /*                Add the overlapping hits                                                    */
+      /*                Search the tracks                                                           */
       /**********************************************************************************************/
       
+      std::vector< std::vector< ITrack* > > tracksOfJob( jobSectorHitIndices.size() );
+      std::vector< unsigned > nTrackCandidatesOfJob( jobSectorHitIndices.size(), 0 );
+      std::vector< unsigned > nTrackCandidatesPlusOfJob( jobSectorHitIndices.size(), 0 );
+      std::vector< TrackingStatistics > statisticsOfJob( jobSectorHitIndices.size() );
+      std::vector< std::vector< MarlinTrk::IMarlinTrkSystem* > > trkSystemsOfJob( jobSectorHitIndices.size() );
       
-      streamlog_out( DEBUG4 ) << "\t\t---Add hits from overlapping petals + fit + helix and Kalman cuts---\n" ;
-      
+      // CED is not thread safe, so when drawing, the jobs are done one after the other.
+      // The same goes for the track fitting systems, if the pool can't give every job its own.
+      unsigned nJobThreads = jobSectorHitIndices.size();
+      if( _useCED ) nJobThreads = 1;
+      if( unsigned( _nFitThreads ) * nJobThreads > _trkSystemPool->getMaxConcurrentUsers() ) nJobThreads = 1;
       
-      std::vector <ITrack*> trackCandidates;
-      
-      
-      // for all raw tracks we got from the automaton
-      for( unsigned i=0; i < rawTracks.size(); i++){
-         
-         
-         RawTrack rawTrack = rawTracks[i];
-         
-         _nTrackCandidates++;
-         
-         
-         // get all versions of the track plus hits from overlapping petals
-         std::vector < RawTrack > rawTracksPlus = getRawTracksPlusOverlappingHits( rawTrack, map_hitFront_hitsBack );
-         
-         streamlog_out( DEBUG2 ) << "For raw track number " << i << " there are " << rawTracksPlus.size() << " versions\n";
+      // the track fitting systems of the jobs are given back with the context (also after an exception)
+      auto holdTrkSystemsOfJobs = [&](){
          
-         
-         /**********************************************************************************************/
-         /*                Make track candidates, fit them and throw away bad ones                     */
-         /**********************************************************************************************/
-         
-         std::vector< ITrack* > overlappingTrackCands;
-         
-         for( unsigned j=0; j < rawTracksPlus.size(); j++ ){
-            
-            _nTrackCandidatesPlus++;
-            
-            RawTrack rawTrackPlus = rawTracksPlus[j];
-            
-            if( rawTrackPlus.size() < unsigned( _hitsPerTrackMin ) ){
-               
-               streamlog_out( DEBUG1 ) << "Trackversion discarded, too few hits: only " << rawTrackPlus.size() << " < " << _hitsPerTrackMin << "(hitsPerTrackMin)\n";
-               continue;
-               
-            }
-            
-            FTDTrack* trackCand = new FTDTrack( _trkSystem );
-            
-            // add the hits to the track
-            for( unsigned k=0; k<rawTrackPlus.size(); k++ ){
-               
-               IFTDHit* ftdHit = dynamic_cast< IFTDHit* >( rawTrackPlus[k] ); // cast to IFTDHits, as needed for an FTDTrack
-               if( ftdHit != NULL ) trackCand->addHit( ftdHit );
-               else streamlog_out( DEBUG4 ) << "Hit " << rawTrackPlus[k] << " could not be casted to IFTDHit\n";
-               
-            }
-            
-            std::vector< IHit* > trackCandHits = trackCand->getHits();
-            streamlog_out( DEBUG2 ) << "Fitting track candidate with " << trackCandHits.size() << " hits\n";
-            
-            for( unsigned k=0; k < trackCandHits.size(); k++ ) streamlog_out( DEBUG1 ) << trackCandHits[k]->getPositionInfo();
-            streamlog_out( DEBUG1 ) << "\n";
-            
-            /*-----------------------------------------------*/
-            /*                Helix Fit                      */
-            /*-----------------------------------------------*/
-            
-            streamlog_out( DEBUG2 ) << "Fitting with Helix Fit\n";
-            try{
-               
-               FTDHelixFitter helixFitter( trackCand->getLcioTrack() );
-               float chi2OverNdf = helixFitter.getChi2() / float( helixFitter.getNdf() );
-               streamlog_out( DEBUG2 ) << "chi2OverNdf = " << chi2OverNdf << "\n";
-               
-               if( chi2OverNdf > _helixFitMax ){
-                  
-                  streamlog_out( DEBUG2 ) << "Discarding track because of bad helix fit: chi2/ndf = " << chi2OverNdf << "\n";
-                  delete trackCand;
-                  continue;
-                  
-               }
-               else streamlog_out( DEBUG2 ) << "Keeping track because of good helix fit: chi2/ndf = " << chi2OverNdf << "\n";
-               
-            }
-            catch( FTDHelixFitterException e ){
-               
-               
-               streamlog_out( DEBUG3 ) << "Track rejected, because fit failed: " <<  e.what() << "\n";
-               delete trackCand;
-               continue;
-               
-            }
-            
-            /*-----------------------------------------------*/
-            /*                Kalman Fit                      */
-            /*-----------------------------------------------*/
-            
-            streamlog_out( DEBUG2 ) << "Fitting with Kalman Filter\n";
-            try{
-                  
-               trackCand->fit();
-                  
-               streamlog_out( DEBUG2 ) << " Track " << trackCand 
-                                       << " chi2Prob = " << trackCand->getChi2Prob() 
-                                       << "( chi2=" << trackCand->getChi2() 
-                                       <<", Ndf=" << trackCand->getNdf() << " )\n";
-                  
-                  
-               if ( trackCand->getChi2Prob() >= _chi2ProbCut ){
-                  
-                  streamlog_out( DEBUG2 ) << "Track accepted (chi2prob " << trackCand->getChi2Prob() << " >= " << _chi2ProbCut << "\n";
-                  
-               }
-               else{
-                  
-                  streamlog_out( DEBUG2 ) << "Track rejected (chi2prob " << trackCand->getChi2Prob() << " < " << _chi2ProbCut << "\n";
-                  delete trackCand;
-                  
-                  continue;
-                  
-               }
-               
-               
-            }
-            catch( FitterException e ){
-               
-               
-               streamlog_out( DEBUG3 ) << "Track rejected, because fit failed: " <<  e.what() << "\n";
-               delete trackCand;
-               continue;
-               
-            }
+         for( unsigned iJob=0; iJob < trkSystemsOfJob.size(); iJob++ ){
             
-            // If we reach this point than the track got accepted by all cuts
-            overlappingTrackCands.push_back( trackCand );
+            for( unsigned i=0; i < trkSystemsOfJob[ iJob ].size(); i++ ) context->holdTrkSystem( _trkSystemPool, trkSystemsOfJob[ iJob ][i] );
             
          }
          
-         /**********************************************************************************************/
-         /*                Take the best version of the track                                          */
-         /**********************************************************************************************/
-        // Now we have all versions of one track, coming from adding possible hits from overlapping petals.
+      };
+      
+      try{
          
-         if( _takeBestVersionOfTrack ){ // we want to take only the best version
-            
+         parallelFor( nJobThreads, jobSectorHitIndices.size(), [&]( unsigned, unsigned iJob ){
             
-            streamlog_out( DEBUG2 ) << "Take the version of the track with best quality from " << overlappingTrackCands.size() << " track candidates\n";
+            tracksOfJob[ iJob ] = findTracks( *jobSectorHitIndices[ iJob ], map_hitFront_hitsBack, context->trackPool,
+                                              context->jobCriteriaRounds[ iJob ], statisticsOfJob[ iJob ],
+                                              _useFitCache ? &context->fitCache : NULL, trkSystemsOfJob[ iJob ],
+                                              nTrackCandidatesOfJob[ iJob ], nTrackCandidatesPlusOfJob[ iJob ], context->timeBudget );
             
-            if( !overlappingTrackCands.empty() ){
-               
-               ITrack* bestTrack = overlappingTrackCands[0];
-               
-               for( unsigned j=1; j < overlappingTrackCands.size(); j++ ){
-                  
-                  if( overlappingTrackCands[j]->getChi2Prob() > bestTrack->getChi2Prob() ){
-                     
-                     delete bestTrack; //delete the old one, not needed anymore
-                     bestTrack = overlappingTrackCands[j];
-                  }
-                  else{
-                     
-                     delete overlappingTrackCands[j]; //delete this one
-                     
-                  }
-                  
-               }
-               streamlog_out( DEBUG2 ) << "Adding best track candidate with " << bestTrack->getHits().size() << " hits\n";
-               
-               trackCandidates.push_back( bestTrack );
-               
-            }
-            
-         }
-         else{ // we take all versions
-            
-            streamlog_out( DEBUG2 ) << "Taking all " << overlappingTrackCands.size() << " versions of the track\n";
-            trackCandidates.insert( trackCandidates.end(), overlappingTrackCands.begin(), overlappingTrackCands.end() );
-            
-         }
+         } );
          
       }
-      
-      if( _useCED ){
-//          for( unsigned i=0; i < trackCandidates.size(); i++ ) KiTrackMarlin::drawTrackRandColor( trackCandidates[i] );
-      }
-      
-      /**********************************************************************************************/
-      /*               Get the best subset of tracks                                                */
-      /**********************************************************************************************/
-      
-      streamlog_out(DEBUG3) << "The track candidates so far: \n";
-      for( unsigned iTrack=0; iTrack < trackCandidates.size(); iTrack++ ){
+      catch( ... ){
          
-         streamlog_out(DEBUG3) << "track " << iTrack << ": " << trackCandidates[iTrack] << "\t" << KiTrackMarlin::getTrackHitInfo( trackCandidates[iTrack] ) << "\n";
+         holdTrkSystemsOfJobs();
+         throw;
          
       }
       
-      streamlog_out( DEBUG4 ) << "\t\t---Get best subset of tracks---\n" ;
+      holdTrkSystemsOfJobs();
       
+      // put the results together: first forward, then backward
       std::vector< ITrack* > tracks;
-      std::vector< ITrack* > rejected;
-      
-      TrackCompatibilityShare1SP comp;
-//       TrackQIChi2Prob trackQI;
-      TrackQIChi2ProbSpecial trackQIChi2ProbSpecial;
       
-      
-      
-      if( _bestSubsetFinder == "SubsetHopfieldNN" ){
-         
-         streamlog_out( DEBUG3 ) << "Use SubsetHopfieldNN for getting the best subset\n" ;
-         
-         SubsetHopfieldNN< ITrack* > subset;
-         subset.setOmega( _HNN_Omega );
-         subset.setActivationThreshold( _HNN_ActivationThreshold );
-         subset.setTInf( _HNN_TInf );
-         subset.add( trackCandidates );
+      for( unsigned i=0; i < tracksOfJob.size(); i++ ){
          
-         
-         subset.calculateBestSet( comp, trackQIChi2ProbSpecial );
-         
-         tracks = subset.getAccepted();
-         rejected = subset.getRejected();
+         tracks.insert( tracks.end(), tracksOfJob[i].begin(), tracksOfJob[i].end() );
+         context->nTrackCandidates += nTrackCandidatesOfJob[i];
+         context->nTrackCandidatesPlus += nTrackCandidatesPlusOfJob[i];
+         statistics.merge( statisticsOfJob[i] );
          
       }
-      else if( _bestSubsetFinder == "SubsetSimple" ){
-         
-         streamlog_out( DEBUG3 ) << "Use SubsetSimple for getting the best subset\n" ;
+      
+      statistics.add( TrackingStatistics::HelixFitCacheLookups, context->fitCache.getNumberOfHelixLookups() );
+      statistics.add( TrackingStatistics::HelixFitCacheHits, context->fitCache.getNumberOfHelixHits() );
+      statistics.add( TrackingStatistics::KalmanFitCacheLookups, context->fitCache.getNumberOfKalmanLookups() );
+      statistics.add( TrackingStatistics::KalmanFitCacheHits, context->fitCache.getNumberOfKalmanHits() );
+      
+      for( unsigned iJob=0; iJob < 2; iJob++ ){
          
-         SubsetSimple< ITrack* > subset;
-         subset.add( trackCandidates );
-         subset.calculateBestSet( comp, trackQIChi2ProbSpecial );
-         tracks = subset.getAccepted();
-         rejected = subset.getRejected();
+         statistics.add( TrackingStatistics::CircleCacheLookups, context->jobCircleCaches[ iJob ].getNumberOfLookups() );
+         statistics.add( TrackingStatistics::CircleCacheHits, context->jobCircleCaches[ iJob ].getNumberOfHits() );
          
       }
-      else { // in any other case take all tracks
+      
+      // if the search had to get cheaper to keep to the time budget, the results may be worse
+      if( context->timeBudget.isDegraded() ){
          
-         streamlog_out( DEBUG3 ) << "Input for subset = \"" << _bestSubsetFinder << "\". All tracks are kept\n" ;
+         streamlog_out( WARNING ) << "The time budget of " << _eventTimeBudget << " ms was used up in event " << context->eventNumber 
+                                  << ", the search got cheaper: " << context->timeBudget.getDegradationNames() << "\n";
          
-         tracks = trackCandidates;
+         if( context->quality != _output_track_col_quality_POOR ) context->quality = _output_track_col_quality_FAIR;
          
       }
       
-      
-      if( _useCED ){
-//          for( unsigned i=0; i < tracks.size(); i++ ) KiTrackMarlin::drawTrack( tracks[i] , 0x00ff00 );
-//          for( unsigned i=0; i < rejected.size(); i++ ) KiTrackMarlin::drawTrack( rejected[i] , 0xff0000 );
-      }
-      
-      
-      for ( unsigned i=0; i<rejected.size(); i++){
-         
-         delete rejected[i];
-         
-      }
+      timer.restart();
       
       
       
@@ -896,18 +791,24 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
       trkCol->setFlag( hitFlag.getFlag()  ) ;
       
       
+      MarlinTrk::IMarlinTrkSystem* trkSystem = context->acquireTrkSystem( _trkSystemPool );
+      
       for (unsigned int i=0; i < tracks.size(); i++){
          
-         FTDTrack* myTrack = dynamic_cast< FTDTrack* >( tracks[i] );
+         FittedFTDTrack* myTrack = dynamic_cast< FittedFTDTrack* >( tracks[i] );
          
          if( myTrack != NULL ){
             
             
-            TrackImpl* trackImpl = new TrackImpl( *(myTrack->getLcioTrack()) );
+            // the lcio track of the candidate goes into the collection, the candidate itself is destroyed with the event
+            TrackImpl* trackImpl = myTrack->releaseLcioTrack();
+            if( trackImpl == NULL ) continue; // already saved, a track can be among the tracks twice
             
             try{
                
-               finaliseTrack( trackImpl );
+               // the fit of the track candidate has the same hits, so the track states can be taken from it
+               if( _reuseCandidateFit && ( myTrack->getFitter() != NULL ) ) finaliseTrack( trackImpl, *myTrack->getFitter() );
+               else finaliseTrack( trackImpl, trkSystem );
                trkCol->addElement( trackImpl );
                
             }
@@ -923,8 +824,28 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
          
       }
      
+      statistics.add( TrackingStatistics::Tracks, trkCol->getNumberOfElements() );
+      statistics.addTime( TrackingStatistics::Finalisation, timer.restart() );
+      
+      // the times (in ms) and counters of the stages of this event
+      for( unsigned i=0; i < TrackingStatistics::nStages; i++ ){
+         
+         TrackingStatistics::Stage stage = TrackingStatistics::Stage( i );
+         trkCol->parameters().setValue( std::string( "TimeMs_" ) + TrackingStatistics::getStageName( stage ), float( statistics.getTime( stage ) * 1000. ) );
+         
+      }
+      
+      for( unsigned i=0; i < TrackingStatistics::nCounters; i++ ){
+         
+         TrackingStatistics::Counter counter = TrackingStatistics::Counter( i );
+         trkCol->parameters().setValue( std::string( "Count_" ) + TrackingStatistics::getCounterName( counter ), int( statistics.getCount( counter ) ) );
+         
+      }
+      
+      if( context->timeBudget.isDegraded() ) trkCol->parameters().setValue( "TimeBudgetDegradations", context->timeBudget.getDegradationNames() );
+      
       // set the quality of the output collection
-      switch (_output_track_col_quality) {
+      switch (context->quality) {
          
          case _output_track_col_quality_FAIR:
             trkCol->parameters().setValue( "QualityCode" , "Fair"  ) ;
@@ -943,20 +864,10 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
       
       
       
-      streamlog_out (DEBUG5) << "Forward Tracking found and saved " << tracks.size() << " tracks in event " << _nEvt << "\n\n"; 
-      
-      
-      /**********************************************************************************************/
-      /*                Clean up                                                                    */
-      /**********************************************************************************************/
-      
-      // delete all the created IHits
-      for ( unsigned i=0; i<hitsTBD.size(); i++ )  delete hitsTBD[i];
-      
-      // delete the FTracks
-      for (unsigned int i=0; i < tracks.size(); i++){ delete tracks[i];}
+      streamlog_out (DEBUG5) << "Forward Tracking found and saved " << tracks.size() << " tracks in event " << context->eventNumber << "\n\n"; 
       
       
+      // The hits and tracks are cleaned up together with the EventContext
       
       
    }
@@ -967,7 +878,10 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
    if( _useCED ) MarlinCED::draw(this);
 
 
-   _nEvt ++ ;
+   // add the counters of this event to the ones of the run
+   _nTrackCandidates += context->nTrackCandidates;
+   _nTrackCandidatesPlus += context->nTrackCandidatesPlus;
+   _statisticsSummary.add( statistics );
    
 }
 
@@ -978,125 +892,180 @@ void ForwardTracking::processEvent( LCEvent * evt ) {
 void ForwardTracking::check( LCEvent * ) {}
 
 
-void ForwardTracking::end(){
+ForwardTracking::EventContext::EventContext( unsigned nSectors, const SectorSystemFTD* sectorSystemFTD, const CriteriaRounds& criteriaRounds,
+                                             bool cacheTripletCircles ):
+   eventNumber( 0 ),
+   quality( _output_track_col_quality_GOOD ),
+   nTrackCandidates( 0 ),
+   nTrackCandidatesPlus( 0 ),
+   sectorHitIndex( nSectors ),
+   overlapHitGrid( sectorSystemFTD ),
+   jobCriteriaRounds{ criteriaRounds, criteriaRounds }{
    
- 
-   for ( unsigned i=0; i< _crit2Vec.size(); i++) delete _crit2Vec[i];
-   for ( unsigned i=0; i< _crit3Vec.size(); i++) delete _crit3Vec[i];
-   for ( unsigned i=0; i< _crit4Vec.size(); i++) delete _crit4Vec[i];
-   _crit2Vec.clear();
-   _crit3Vec.clear();
-   _crit4Vec.clear();
+   sideSectorHitIndex[0].setNumberOfSectors( nSectors );
+   sideSectorHitIndex[1].setNumberOfSectors( nSectors );
    
-   delete _sectorSystemFTD;
-   _sectorSystemFTD = NULL;
+   if( cacheTripletCircles ){
+      
+      jobCriteriaRounds[0].setCircleCache( &jobCircleCaches[0] );
+      jobCriteriaRounds[1].setCircleCache( &jobCircleCaches[1] );
+      
+   }
    
-   streamlog_out( DEBUG3 ) << "There are " << _nTrackCandidates << "track candidates from CA and "<<  _nTrackCandidatesPlus
-      << " track Candidates with hits from overlapping hits\n"
-      << "The ratio is " << float( _nTrackCandidatesPlus )/_nTrackCandidates;
+}
+
 
+ForwardTracking::EventContext::~EventContext(){
+   
+   clear();
    
 }
 
 
+void ForwardTracking::EventContext::clear(){
+   
+   // destroy all the created tracks and IHits (the tracks first, as they point to the hits)
+   trackPool.clear();
+   hitPool.clear();
+   virtualHitPool.clear();
+   hits.clear();
+   fitCache.clear(); // its keys and tracks pointed to them
+   jobCircleCaches[0].clear(); // and so did the keys of these
+   jobCircleCaches[1].clear();
+   
+   // give the track fitting systems back
+   for ( unsigned i=0; i < trkSystems.size(); i++ ) trkSystems[i].first->release( trkSystems[i].second );
+   trkSystems.clear();
+   
+   eventNumber = 0;
+   quality = _output_track_col_quality_GOOD;
+   nTrackCandidates = 0;
+   nTrackCandidatesPlus = 0;
+   statistics.clear();
+   
+   // the sector hit indices are just rebuilt for the next event, so they keep their memory
+   
+}
 
 
-std::map< IHit* , std::vector< IHit* > > ForwardTracking::getOverlapConnectionMap( 
-            const std::map< int , std::vector< IHit* > > & map_sector_hits, 
-            const SectorSystemFTD* secSysFTD,
-            float distMax){
+MarlinTrk::IMarlinTrkSystem* ForwardTracking::EventContext::acquireTrkSystem( KiTrackMarlin::MarlinTrkSystemPool* trkSystemPool ){
+   
+   MarlinTrk::IMarlinTrkSystem* trkSystem = trkSystemPool->acquire();
+   holdTrkSystem( trkSystemPool, trkSystem );
    
+   return trkSystem;
    
-   unsigned nConnections=0;
+}
+
 
+void ForwardTracking::EventContext::holdTrkSystem( KiTrackMarlin::MarlinTrkSystemPool* trkSystemPool, MarlinTrk::IMarlinTrkSystem* trkSystem ){
    
-   std::map< IHit* , std::vector< IHit* > > map_hitFront_hitsBack;
-   std::map< int , std::vector< IHit* > >::const_iterator it;
+   trkSystems.push_back( std::make_pair( trkSystemPool, trkSystem ) );
    
-   //for every sector
-   for ( it= map_sector_hits.begin() ; it != map_sector_hits.end(); it++ ){
-      
-     
-      std::vector< IHit* > hitVecA = it->second;
-      int sector = it->first;
-      
-      // get the neighbouring petals
-      FTDNeighborPetalSecCon secCon( secSysFTD );
-      std::set< int > targetSectors = secCon.getTargetSectors( sector );
-      
-      
-      //for all neighbouring petals
-      for ( std::set<int>::iterator itTarg = targetSectors.begin(); itTarg!=targetSectors.end(); itTarg++ ){
-         
-         
-        //fg: this blows up the map with empty vectors ! 
-	//	std::vector< IHit* > hitVecB = map_sector_hits[ *itTarg ];
-         
-	 std::map< int , std::vector< IHit* > >::const_iterator itB = map_sector_hits.find( *itTarg ) ; 
+}
 
-	 if( itB == map_sector_hits.end() ){
-	   continue ;
-	 }
-	 std::vector< IHit* > hitVecB = itB->second ;
-	 
 
-         for ( unsigned j=0; j < hitVecA.size(); j++ ){
-            
-            
-            IHit* hitA = hitVecA[j];
-            
-            for ( unsigned k=0; k < hitVecB.size(); k++ ){
-               
-               
-               IHit* hitB = hitVecB[k];
-               
-               
-               float dx = hitA->getX() - hitB->getX();
-               float dy = hitA->getY() - hitB->getY();
-               float dz = hitA->getZ() - hitB->getZ();
-               float dist = sqrt( dx*dx + dy*dy + dz*dz );
-               
-               if (( dist < distMax )&& ( fabs( hitB->getZ() ) > fabs( hitA->getZ() ) )  ){ // if they are close enough and B is behind A
-                  
-                  
-                  streamlog_out( DEBUG2 ) << "Connected: (" << hitA->getX() << "," << hitA->getY() << "," << hitA->getZ() << ")-->("
-                                          << hitB->getX() << "," << hitB->getY() << "," << hitB->getZ() << ")\n";
-                  
-                  map_hitFront_hitsBack[ hitA ].push_back( hitB );
-                  nConnections++;
-                  
-               }
-               
-            }
-            
-         } 
-         
-      }
-     
+ForwardTracking::EventContext* ForwardTracking::acquireEventContext(){
+   
+   std::lock_guard< std::mutex > lock( _eventContextMutex );
+   
+   if( _freeEventContexts.empty() ) return new EventContext( _nSectors, _sectorSystemFTD, *_criteriaRounds, _cacheTripletCircles );
+   
+   EventContext* context = _freeEventContexts.back();
+   _freeEventContexts.pop_back();
+   
+   return context;
+   
+}
+
+
+void ForwardTracking::releaseEventContext( EventContext* context ){
+   
+   context->clear();
+   
+   std::lock_guard< std::mutex > lock( _eventContextMutex );
+   
+   _freeEventContexts.push_back( context );
+   
+}
+
+
+void ForwardTracking::end(){
+   
+ 
+   delete _sectorSystemFTD;
+   _sectorSystemFTD = NULL;
+   
+   delete _trkSystemPool;
+   _trkSystemPool = NULL;
+   
+   for( unsigned i=0; i < _freeEventContexts.size(); i++ ) delete _freeEventContexts[i];
+   _freeEventContexts.clear();
+   
+   delete _criteriaRounds;
+   _criteriaRounds = NULL;
+   
+   if( _predictFirstRound ){
+      
+      streamlog_out( MESSAGE ) << _roundPredictor->getInfo() << "The first round was predicted right in " << _roundPredictor->getNumberOfRightPredictions()
+                               << " of " << _roundPredictor->getNumberOfPredictions() << " checked cases"
+                               << " (only built rounds get checked, not the skipped ones)\n";
+      
    }
    
-   streamlog_out( DEBUG3 ) << "Connected " << map_hitFront_hitsBack.size() << " hits with " << nConnections << " possible overlapping hits\n";
+   delete _roundPredictor;
+   _roundPredictor = NULL;
+   
+   streamlog_out( DEBUG3 ) << "There are " << _nTrackCandidates << "track candidates from CA and "<<  _nTrackCandidatesPlus
+      << " track Candidates with hits from overlapping hits\n"
+      << "The ratio is " << float( _nTrackCandidatesPlus )/_nTrackCandidates;
    
+   streamlog_out( DEBUG4 ) << _statisticsSummary.getInfo();
    
-   return map_hitFront_hitsBack;
+   if( _useFitCache ){
+      
+      TrackingStatistics total = _statisticsSummary.getTotal();
+      
+      streamlog_out( DEBUG4 ) << "Fit cache: " << total.getCount( TrackingStatistics::HelixFitCacheHits ) << " of " 
+                              << total.getCount( TrackingStatistics::HelixFitCacheLookups ) << " helix fits and "
+                              << total.getCount( TrackingStatistics::KalmanFitCacheHits ) << " of "
+                              << total.getCount( TrackingStatistics::KalmanFitCacheLookups ) << " Kalman fits were known already\n";
+      
+   }
    
+   if( _cacheTripletCircles ){
+      
+      TrackingStatistics total = _statisticsSummary.getTotal();
+      
+      streamlog_out( DEBUG4 ) << "Circle cache: " << total.getCount( TrackingStatistics::CircleCacheHits ) << " of " 
+                              << total.getCount( TrackingStatistics::CircleCacheLookups ) << " circles of hit triplets were known already\n";
+      
+   }
    
+   if( !_statisticsFile.empty() ){
+      
+      if( _statisticsSummary.writeCSV( _statisticsFile ) ) streamlog_out( MESSAGE ) << "Statistics of the stages written to " << _statisticsFile << "\n";
+      else streamlog_out( ERROR ) << "Could not write the statistics of the stages to " << _statisticsFile << "\n";
+      
+   }
+
    
 }
 
 
-std::string ForwardTracking::getInfo_map_sector_hits(){
+
+
+std::string ForwardTracking::getInfoSectorHits( const SectorHitIndex& sectorHitIndex ) const{
    
    
    std::stringstream s;
    
-   std::map< int , std::vector< IHit* > >::iterator it;
+   const std::vector< int >& sectors = sectorHitIndex.getOccupiedSectors();
    
-   for( it = _map_sector_hits.begin(); it != _map_sector_hits.end(); it++ ){
+   for( unsigned i=0; i < sectors.size(); i++ ){
       
       
-      std::vector<IHit*> hits = it->second;
-      int sector = it->first;
+      int sector = sectors[i];
       
       int side = _sectorSystemFTD->getSide( sector );
       unsigned layer = _sectorSystemFTD->getLayer( sector );
@@ -1108,7 +1077,7 @@ std::string ForwardTracking::getInfo_map_sector_hits(){
       << layer << ",mo"
       << module << "se,"
       << sensor << ") has "
-      << hits.size() << " hits\n";
+      << sectorHitIndex.getNumberOfHits( sector ) << " hits\n";
       
       
    }  
@@ -1118,7 +1087,38 @@ std::string ForwardTracking::getInfo_map_sector_hits(){
    
 }
 
-std::vector < RawTrack > ForwardTracking::getRawTracksPlusOverlappingHits( RawTrack rawTrack , std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack ){
+IAutomatonEngine* ForwardTracking::createAutomatonEngine() const{
+   
+   
+   if( _compactAutomaton ) return new CompactAutomaton();
+   
+   return new KiTrackAutomatonEngine();
+   
+   
+}
+
+FTDHitSimple* ForwardTracking::createVirtualIPHit( int side , ObjectPool< FTDHitSimple >& virtualHitPool ) const{
+   
+   
+   unsigned layer = 0;
+   unsigned module = 0;
+   unsigned sensor = 0;
+   
+   FTDHitSimple* virtualIPHit = virtualHitPool.create( 0., 0., 0., side , layer , module , sensor , _sectorSystemFTD );
+   
+   virtualIPHit->setIsVirtual ( true );
+   
+   return virtualIPHit;
+   
+   
+}
+
+
+std::vector < RawTrack > ForwardTracking::getRawTracksPlusOverlappingHits( RawTrack rawTrack , 
+                                                                          const std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                                          FitResultCache* fitCache,
+                                                                          TrackingStatistics& statistics,
+                                                                          int maxVersions ) const{
    
    
    
@@ -1159,9 +1159,56 @@ std::vector < RawTrack > ForwardTracking::getRawTracksPlusOverlappingHits( RawTr
    // {(A,B,C)(A,A1,B,C)(A,B,B1,C)(A,A1,B,B1,C)(A,B,B2,C)(A,A1,B,B2,C)}
    //
    // So now we have all possible versions of the track with overlapping hits
+   //
+   // As the number of versions is a product, a few busy petals make it explode. So if maxVersions is set,
+   // the versions are instead enumerated by an OverlapVersionEnumerator, the most promising (the added hits closest
+   // to the circle of the track) first, and we stop after maxVersions. Hits, that already ruin the helix fit
+   // when added alone to the track, are not used at all and combinations ruining it are skipped.
+   // The track without any added hits comes at some point among the cheap versions, but if it doesn't make it
+   // into the maxVersions, it is added as the last one: then there is always a version to fall back to.
    
    std::vector < RawTrack > rawTracksPlus;
    
+   if( maxVersions > 0 ){
+      
+      
+      OverlapVersionEnumerator enumerator( rawTrack, map_hitFront_hitsBack, _overlappingHitsDistMax );
+      
+      double nPossibleVersions = enumerator.getNumberOfPossibleVersions();
+      
+      enumerator.filterOverlapHits( [&]( const RawTrack& track, IHit* backHit ){
+         
+         RawTrack hits = track;
+         hits.push_back( backHit );
+         
+         return passesHelixFit( hits, fitCache, statistics );
+         
+      } );
+      
+      auto acceptVersion = [&]( const RawTrack& version ){ return passesHelixFit( version, fitCache, statistics ); };
+      
+      RawTrack version;
+      bool haveRawTrack = false;
+      
+      while( ( rawTracksPlus.size() < unsigned( maxVersions ) ) && enumerator.next( version, acceptVersion, unsigned( maxVersions ) ) ){
+         
+         if( version.size() == rawTrack.size() ) haveRawTrack = true; // the version without added hits
+         rawTracksPlus.push_back( version );
+         
+      }
+      
+      if( !haveRawTrack ) rawTracksPlus.push_back( rawTrack );
+      
+      streamlog_out( DEBUG2 ) << "Created " << rawTracksPlus.size() << " of " << nPossibleVersions << " possible versions ("
+                              << enumerator.getNumberOfPossibleVersions() << " after dropping hits failing the helix fit, "
+                              << enumerator.getNumberOfRejectedVersions() << " combinations rejected)\n";
+      
+      return rawTracksPlus;
+      
+      
+   }
+   
+   
    rawTracksPlus.push_back( rawTrack ); //add the original one
    
    // for every hit in the original track
@@ -1171,7 +1218,7 @@ std::vector < RawTrack > ForwardTracking::getRawTracksPlusOverlappingHits( RawTr
       IHit* frontHit = rawTrack[i];
       
       // get the hits that are behind frontHit
-      std::map< IHit* , std::vector< IHit* > >::iterator it;
+      std::map< IHit* , std::vector< IHit* > >::const_iterator it;
       it = map_hitFront_hitsBack.find( frontHit );
       if( it == map_hitFront_hitsBack.end() ) continue; // if there are no hits on the back skip this one
       std::vector< IHit* > backHits = it->second; 
@@ -1213,88 +1260,1087 @@ std::vector < RawTrack > ForwardTracking::getRawTracksPlusOverlappingHits( RawTr
 }
 
 
-bool ForwardTracking::setCriteria( unsigned round ){
- 
-   // delete the old ones
-   for ( unsigned i=0; i< _crit2Vec.size(); i++) delete _crit2Vec[i];
-   for ( unsigned i=0; i< _crit3Vec.size(); i++) delete _crit3Vec[i];
-   for ( unsigned i=0; i< _crit4Vec.size(); i++) delete _crit4Vec[i];
-   _crit2Vec.clear();
-   _crit3Vec.clear();
-   _crit4Vec.clear();
+bool ForwardTracking::getRawTracksPlusOverlappingHitsIncremental( const RawTrack& rawTrack , 
+                                                                  const std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                                  MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                                                  TrackingStatistics& statistics,
+                                                                  std::vector< RawTrack >& rawTracksPlus ) const{
    
    
+   // Every version differs from the raw track only by the added hits from the back. So instead of fitting all of them,
+   // the raw track is fitted once and every hit from the back is judged by how much it would increase the chi2.
+   // For every hit of the raw track the back hit with the smallest increase (if not above OverlapChi2IncrementMax) is taken.
    
-   bool newValuesGotUsed = false; // if new values are used
+   std::vector< const std::vector< IHit* >* > backHitsOfFrontHits;
    
-   for( unsigned i=0; i<_criteriaNames.size(); i++ ){
+   for( unsigned i=0; i < rawTrack.size(); i++ ){
       
-      std::string critName = _criteriaNames[i];
+      std::map< IHit* , std::vector< IHit* > >::const_iterator it = map_hitFront_hitsBack.find( rawTrack[i] );
+      if( ( it != map_hitFront_hitsBack.end() ) && !it->second.empty() ) backHitsOfFrontHits.push_back( &it->second );
+      
+   }
+   
+   rawTracksPlus.clear();
+   
+   if( backHitsOfFrontHits.empty() ){ // nothing to choose
+      
+      rawTracksPlus.push_back( rawTrack );
+      return true;
+      
+   }
+   
+   
+   StageTimer timer;
+   statistics.add( TrackingStatistics::KalmanFits );
+   
+   try{
       
       
-      float min = _critMinima[critName].back();
-      float max = _critMaxima[critName].back();
+      IncrementalKalmanFitter fitter( rawTrack, trkSystem );
       
+      statistics.addTime( TrackingStatistics::KalmanFit, timer.restart() );
       
+      RawTrack chosenVersion = rawTrack;
       
-      // use the value corresponding to the round, if there are no new ones for this criterion, just do nothing (the previous value stays in place)
-      if( round + 1 <= _critMinima[critName].size() ){
+      for( unsigned i=0; i < backHitsOfFrontHits.size(); i++ ){
          
-         min =  _critMinima[critName][round];
-         newValuesGotUsed = true;
          
-      }
-      
-      if( round + 1 <= _critMaxima[critName].size() ){
+         const std::vector< IHit* >& backHits = *backHitsOfFrontHits[i];
+         
+         IHit* bestBackHit = NULL;
+         double bestChi2Increment = _overlapChi2IncrementMax;
+         
+         for( unsigned j=0; j < backHits.size(); j++ ){
+            
+            double chi2Increment = 0.;
+            
+            if( fitter.getChi2Increment( backHits[j], chi2Increment ) && ( chi2Increment <= bestChi2Increment ) ){
+               
+               bestBackHit = backHits[j];
+               bestChi2Increment = chi2Increment;
+               
+            }
+            
+         }
+         
+         if( bestBackHit != NULL ){
+            
+            streamlog_out( DEBUG2 ) << "Adding overlapping hit with chi2 increment " << bestChi2Increment << "\n";
+            chosenVersion.push_back( bestBackHit );
+            
+         }
          
-         max =  _critMaxima[critName][round];
-         newValuesGotUsed = true;
          
       }
       
-      ICriterion* crit = Criteria::createCriterion( critName, min , max );
+      // the chosen version first, the raw track itself only as fallback
+      if( chosenVersion.size() > rawTrack.size() ) rawTracksPlus.push_back( chosenVersion );
+      rawTracksPlus.push_back( rawTrack );
+      
+      statistics.addTime( TrackingStatistics::OverlapVersions, timer.restart() );
+      
+      return true;
+      
+      
+   }
+   catch( FitterException e ){
+      
+      statistics.addTime( TrackingStatistics::KalmanFit, timer.restart() );
+      
+      streamlog_out( DEBUG3 ) << "Fit of the raw track failed, so all versions get fitted: " << e.what() << "\n";
+      return false;
+      
+   }
+   
+   
+}
+
+
+bool ForwardTracking::passesHelixFit( const RawTrack& hits, FitResultCache* fitCache, TrackingStatistics& statistics ) const{
+   
+   
+   // the same hits make a version of the track, so the result will be needed again
+   FitResultCache::HelixResult helixResult = getHelixResult( hits, fitCache, &statistics );
+   
+   if( helixResult.failed ) return true; // too few hits to tell
+   
+   float chi2OverNdf = helixResult.chi2 / float( helixResult.ndf );
+   
+   return chi2OverNdf <= _helixFitMax;
+   
+   
+}
+
+
+FitResultCache::HelixResult ForwardTracking::getHelixResult( const RawTrack& hits, FitResultCache* fitCache, TrackingStatistics* statistics ) const{
+   
+   
+   FitResultCache::HelixResult helixResult;
+   
+   if( ( fitCache != NULL ) && fitCache->findHelix( hits, helixResult ) ) return helixResult;
+   
+   
+   StageTimer timer;
+   
+   // The virtual hits are not part of the lcio track, so they are not fitted
+   std::vector< TrackerHit* > trackerHits;
+   
+   for( unsigned i=0; i < hits.size(); i++ ){
+      
+      if( hits[i]->isVirtual() ) continue;
+      
+      IFTDHit* ftdHit = dynamic_cast< IFTDHit* >( hits[i] );
+      if( ( ftdHit != NULL ) && ( ftdHit->getTrackerHit() != NULL ) ) trackerHits.push_back( ftdHit->getTrackerHit() );
+      
+   }
+   
+   try{
+      
+      FTDHelixFitter helixFitter( trackerHits );
+      
+      helixResult.failed = false;
+      helixResult.chi2 = helixFitter.getChi2();
+      helixResult.ndf = helixFitter.getNdf();
+      
+   }
+   catch( FTDHelixFitterException e ){
+      
+      streamlog_out( DEBUG3 ) << "Helix fit failed: " <<  e.what() << "\n";
+      
+      helixResult.failed = true;
+      
+   }
+   
+   if( statistics != NULL ){
+      
+      statistics->add( TrackingStatistics::HelixFits );
+      statistics->addTime( TrackingStatistics::HelixFit, timer.restart() );
+      
+   }
+   
+   if( fitCache != NULL ) fitCache->storeHelix( hits, helixResult );
+   
+   return helixResult;
+   
+   
+}
+
+
+bool ForwardTracking::passesHelixFitCut( const RawTrack& rawTrackPlus, TrackingStatistics& statistics, FitResultCache* fitCache, float& chi2OverNdf ) const{
+   
+   
+   FitResultCache::HelixResult helixResult = getHelixResult( rawTrackPlus, fitCache, &statistics );
+   
+   if( helixResult.failed ){
+      
+      streamlog_out( DEBUG3 ) << "Track rejected, because helix fit failed\n";
+      return false;
+      
+   }
+   
+   chi2OverNdf = helixResult.chi2 / float( helixResult.ndf );
+   streamlog_out( DEBUG2 ) << "chi2OverNdf = " << chi2OverNdf << "\n";
+   
+   if( chi2OverNdf > _helixFitMax ){
+      
+      streamlog_out( DEBUG2 ) << "Discarding track because of bad helix fit: chi2/ndf = " << chi2OverNdf << "\n";
+      return false;
+      
+   }
+   
+   streamlog_out( DEBUG2 ) << "Keeping track because of good helix fit: chi2/ndf = " << chi2OverNdf << "\n";
+   return true;
+   
+   
+}
+
+
+ITrack* ForwardTracking::fitTrackCandidate( const RawTrack& rawTrackPlus,
+                                            MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                            ObjectPool< FittedFTDTrack >& trackPool,
+                                            TrackingStatistics& statistics,
+                                            FitResultCache* fitCache ) const{
+   
+   
+   /*-----------------------------------------------*/
+   /*                Helix Fit                      */
+   /*-----------------------------------------------*/
+   
+   float chi2OverNdf = 0.;
+   if( !passesHelixFitCut( rawTrackPlus, statistics, fitCache, chi2OverNdf ) ) return NULL;
+   
+   /*-----------------------------------------------*/
+   /*                Kalman Fit                      */
+   /*-----------------------------------------------*/
+   
+   return kalmanFitTrackCandidate( rawTrackPlus, trkSystem, trackPool, statistics, fitCache );
+   
+   
+}
+
+
+ITrack* ForwardTracking::kalmanFitTrackCandidate( const RawTrack& rawTrackPlus,
+                                                  MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                                  ObjectPool< FittedFTDTrack >& trackPool,
+                                                  TrackingStatistics& statistics,
+                                                  FitResultCache* fitCache ) const{
+   
+   
+   // If the same hits were already fitted in this event (as a version of another raw track), the results are known
+   FitResultCache::KalmanResult kalmanResult;
+   
+   if( ( fitCache != NULL ) && fitCache->findKalman( rawTrackPlus, kalmanResult ) ){
+      
+      streamlog_out( DEBUG2 ) << "The hits were already fitted: chi2Prob = " << kalmanResult.chi2Prob << "\n";
+      
+      if( !kalmanResult.failed && ( kalmanResult.chi2Prob >= _chi2ProbCut ) ) return kalmanResult.track;
+      return NULL;
+      
+   }
+   
+   
+   FittedFTDTrack* trackCand = trackPool.create( trkSystem ); // lives until the end of the event, even if rejected
+   
+   // add the hits to the track
+   for( unsigned k=0; k<rawTrackPlus.size(); k++ ){
       
-      // Some debug output about the created criterion
-      std::string type = crit->getType();
+      IFTDHit* ftdHit = dynamic_cast< IFTDHit* >( rawTrackPlus[k] ); // cast to IFTDHits, as needed for an FTDTrack
+      if( ftdHit != NULL ) trackCand->addHit( ftdHit );
+      else streamlog_out( DEBUG4 ) << "Hit " << rawTrackPlus[k] << " could not be casted to IFTDHit\n";
       
-      streamlog_out( DEBUG3 ) <<  "Added: Criterion " << critName << " (type =  " << type 
-      << " ). Min = " << min
-      << ", Max = " << max
-      << ", round " << round << "\n";
+   }
+   
+   std::vector< IHit* > trackCandHits = trackCand->getHits();
+   streamlog_out( DEBUG2 ) << "Fitting track candidate with " << trackCandHits.size() << " hits\n";
+   
+   for( unsigned k=0; k < trackCandHits.size(); k++ ) streamlog_out( DEBUG1 ) << trackCandHits[k]->getPositionInfo();
+   streamlog_out( DEBUG1 ) << "\n";
+   
+   StageTimer timer;
+   
+   streamlog_out( DEBUG2 ) << "Fitting with Kalman Filter\n";
+   statistics.add( TrackingStatistics::KalmanFits );
+   
+   kalmanResult.track = trackCand;
+   
+   try{
+         
+      trackCand->fit();
       
+      kalmanResult.failed = false;
+      kalmanResult.chi2 = trackCand->getChi2();
+      kalmanResult.ndf = trackCand->getNdf();
+      kalmanResult.chi2Prob = trackCand->getChi2Prob();
       
-      // Add the new criterion to the corresponding vector
-      if( type == "2Hit" ){
+      statistics.addTime( TrackingStatistics::KalmanFit, timer.restart() );
+      if( fitCache != NULL ) fitCache->storeKalman( rawTrackPlus, kalmanResult );
          
-         _crit2Vec.push_back( crit );
+      streamlog_out( DEBUG2 ) << " Track " << trackCand 
+                              << " chi2Prob = " << trackCand->getChi2Prob() 
+                              << "( chi2=" << trackCand->getChi2() 
+                              <<", Ndf=" << trackCand->getNdf() << " )\n";
          
-      }
-      else if( type == "3Hit" ){
          
-         _crit3Vec.push_back( crit );
+      if ( trackCand->getChi2Prob() >= _chi2ProbCut ){
+         
+         streamlog_out( DEBUG2 ) << "Track accepted (chi2prob " << trackCand->getChi2Prob() << " >= " << _chi2ProbCut << "\n";
          
       }
-      else if( type == "4Hit" ){
+      else{
          
-         _crit4Vec.push_back( crit );
+         streamlog_out( DEBUG2 ) << "Track rejected (chi2prob " << trackCand->getChi2Prob() << " < " << _chi2ProbCut << "\n";
+         trackCand->releaseFitter();
+         return NULL;
          
       }
-      else delete crit;
       
       
+   }
+   catch( FitterException e ){
+      
+      statistics.addTime( TrackingStatistics::KalmanFit, timer.restart() );
+      
+      kalmanResult.failed = true;
+      if( fitCache != NULL ) fitCache->storeKalman( rawTrackPlus, kalmanResult );
+      
+      streamlog_out( DEBUG3 ) << "Track rejected, because fit failed: " <<  e.what() << "\n";
+      return NULL;
+      
    }
    
-   return newValuesGotUsed;
+   return trackCand;
    
    
 }
 
 
-void ForwardTracking::finaliseTrack( TrackImpl* trackImpl ){
+std::vector< ITrack* > ForwardTracking::getTrackCandidates( const RawTrack& rawTrack , 
+                                                            const std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                            MarlinTrk::IMarlinTrkSystem* trkSystem,
+                                                            ObjectPool< FittedFTDTrack >& trackPool,
+                                                            TrackingStatistics& statistics,
+                                                            FitResultCache* fitCache,
+                                                            unsigned& nVersions,
+                                                            std::vector< ITrack* >& otherVersions,
+                                                            EventTimeBudget& timeBudget ) const{
+   
+   
+   std::vector < RawTrack > rawTracksPlus;
+   
+   // In the incremental mode the overlapping hits are chosen with a single fit of the raw track
+   bool versionsOrdered = false;
+   if( _incrementalOverlapFit ) versionsOrdered = getRawTracksPlusOverlappingHitsIncremental( rawTrack, map_hitFront_hitsBack, trkSystem, statistics, rawTracksPlus );
    
+   StageTimer timer;
+   
+   if( !versionsOrdered ){
+      
+      // once the time budget is used up, only the most promising versions are tried
+      int maxVersions = _maxOverlapVersions;
+      
+      if( ( _timeBudgetMaxOverlapVersions > 0 ) && ( ( maxVersions <= 0 ) || ( _timeBudgetMaxOverlapVersions < maxVersions ) ) 
+          && timeBudget.isExhausted() ){
+         
+         maxVersions = _timeBudgetMaxOverlapVersions;
+         timeBudget.degrade( EventTimeBudget::CappedOverlapVersions );
+         
+      }
+      
+      // get all versions of the track plus hits from overlapping petals
+      double helixFitTime = statistics.getTime( TrackingStatistics::HelixFit );
+      
+      rawTracksPlus = getRawTracksPlusOverlappingHits( rawTrack, map_hitFront_hitsBack, fitCache, statistics, maxVersions );
+      
+      // the helix fits judging the versions are already timed as HelixFit
+      helixFitTime = statistics.getTime( TrackingStatistics::HelixFit ) - helixFitTime;
+      statistics.addTime( TrackingStatistics::OverlapVersions, timer.restart() - helixFitTime );
+      
+   }
+   
+   nVersions = rawTracksPlus.size();
+   statistics.add( TrackingStatistics::Versions, nVersions );
+   
+   streamlog_out( DEBUG2 ) << "For the raw track there are " << rawTracksPlus.size() << " versions\n";
+   
+   
+   /**********************************************************************************************/
+   /*                Make track candidates, fit them and throw away bad ones                     */
+   /**********************************************************************************************/
+   
+   std::vector< ITrack* > overlappingTrackCands;
+   
+   // Only the best version is kept anyway, so rank the versions by the helix fit and Kalman fit only the best ones,
+   // the next ones only if the fits of those fail
+   bool tiered = _takeBestVersionOfTrack && ( _kalmanFitBestHelixVersions > 0 ) && !versionsOrdered;
+   
+   std::vector< std::pair< float , unsigned > > helixRanking; // chi2/Ndf of the helix fit and index of the version
+   
+   for( unsigned j=0; j < rawTracksPlus.size(); j++ ){
+      
+      
+      const RawTrack& rawTrackPlus = rawTracksPlus[j];
+      
+      if( rawTrackPlus.size() < unsigned( _hitsPerTrackMin ) ){
+         
+         streamlog_out( DEBUG1 ) << "Trackversion discarded, too few hits: only " << rawTrackPlus.size() << " < " << _hitsPerTrackMin << "(hitsPerTrackMin)\n";
+         continue;
+         
+      }
+      
+      if( tiered ){
+         
+         float chi2OverNdf = 0.;
+         if( passesHelixFitCut( rawTrackPlus, statistics, fitCache, chi2OverNdf ) ) helixRanking.push_back( std::make_pair( chi2OverNdf, j ) );
+         continue;
+         
+      }
+      
+      ITrack* trackCand = fitTrackCandidate( rawTrackPlus, trkSystem, trackPool, statistics, fitCache );
+      if( trackCand == NULL ) continue;
+      
+      // If we reach this point than the track got accepted by all cuts
+      overlappingTrackCands.push_back( trackCand );
+      
+      // the versions of the incremental mode are ordered: the chosen one and only if that fails the raw track itself
+      if( versionsOrdered ) break;
+      
+   }
+   
+   if( tiered ){
+      
+      
+      // equal chi2/Ndf keep the order of the versions
+      std::stable_sort( helixRanking.begin(), helixRanking.end(),
+                        []( const std::pair< float , unsigned >& a, const std::pair< float , unsigned >& b ){ return a.first < b.first; } );
+      
+      for( unsigned j=0; ( j < helixRanking.size() ) && ( overlappingTrackCands.size() < unsigned( _kalmanFitBestHelixVersions ) ); j++ ){
+         
+         ITrack* trackCand = kalmanFitTrackCandidate( rawTracksPlus[ helixRanking[j].second ], trkSystem, trackPool, statistics, fitCache );
+         if( trackCand != NULL ) overlappingTrackCands.push_back( trackCand );
+         
+      }
+      
+      streamlog_out( DEBUG2 ) << "Kalman fitted the best versions by helix fit: " << overlappingTrackCands.size() << " accepted of " 
+                              << helixRanking.size() << " passing the helix fit\n";
+      
+      
+   }
+   
+   /**********************************************************************************************/
+   /*                Take the best version of the track                                          */
+   /**********************************************************************************************/
+   // Now we have all versions of one track, coming from adding possible hits from overlapping petals.
+   
+   if( _takeBestVersionOfTrack ){ // we want to take only the best version
+      
+      
+      streamlog_out( DEBUG2 ) << "Take the version of the track with best quality from " << overlappingTrackCands.size() << " track candidates\n";
+      
+      std::vector< ITrack* > bestTrackCands;
+      
+      if( !overlappingTrackCands.empty() ){
+         
+         ITrack* bestTrack = overlappingTrackCands[0];
+         
+         for( unsigned j=1; j < overlappingTrackCands.size(); j++ ){
+            
+            if( overlappingTrackCands[j]->getChi2Prob() > bestTrack->getChi2Prob() ){
+               
+               bestTrack = overlappingTrackCands[j]; // the old one is not needed anymore
+               
+            }
+            
+         }
+         streamlog_out( DEBUG2 ) << "Adding best track candidate with " << bestTrack->getHits().size() << " hits\n";
+         
+         // the fits of the other versions are released after the subset, unless another raw track got one of them
+         for( unsigned j=0; j < overlappingTrackCands.size(); j++ ){
+            
+            if( overlappingTrackCands[j] != bestTrack ) otherVersions.push_back( overlappingTrackCands[j] );
+            
+         }
+         
+         bestTrackCands.push_back( bestTrack );
+         
+      }
+      
+      return bestTrackCands;
+      
+   }
+   else{ // we take all versions
+      
+      streamlog_out( DEBUG2 ) << "Taking all " << overlappingTrackCands.size() << " versions of the track\n";
+      return overlappingTrackCands;
+      
+   }
+   
+   
+}
+
+
+std::vector< ITrack* > ForwardTracking::findTracks( const SectorHitIndex& sectorHitIndex, 
+                                                    const std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                    ObjectPool< FittedFTDTrack >& trackPool,
+                                                    const CriteriaRounds& criteriaRounds,
+                                                    TrackingStatistics& statistics,
+                                                    FitResultCache* fitCache,
+                                                    std::vector< MarlinTrk::IMarlinTrkSystem* >& trkSystems,
+                                                    unsigned& nTrackCandidates,
+                                                    unsigned& nTrackCandidatesPlus,
+                                                    EventTimeBudget& timeBudget ) const{
+   
+   
+   /**********************************************************************************************/
+   /*                SegmentBuilder and Cellular Automaton                                       */
+   /**********************************************************************************************/
+   
+   std::vector < RawTrack > rawTracks;
+   
+   // The following loop ideally only runs once. (So we do round 0 and everything works)
+   // It will repeat as long as the Automaton creates too many connections and as long as there are new criteria
+   // parameters to use to cut down the problem.
+   // Ideally already in round 0, there is a reasonable number of connections (not more than _maxConnectionsAutomaton), 
+   // so the loop will be left. If however there are too many connections we stay in the loop and use 
+   // (hopefully) tighter cut offs (if provided in the steering). This should prevent combinatorial breakdown
+   // for very evil events.
+   //
+   // If the EventTimeBudget is used up before a round gets built, we jump straight to the last round: its tight cuts
+   // are the cheapest way to finish the event, and building the rounds in between would only make a slow event slower.
+   // A round that is already built and has few enough connections is finished in any case.
+   //
+   // If IncrementalRounds is set, the segment builder remembers the connections of a round. If the cuts of the next
+   // round are tighter, the connections are then only filtered with the new cuts instead of being searched again.
+   //
+   // The segment builder stops as soon as there are more than MaxConnectionsAutomaton connections, so a rejected round
+   // only costs a part of the build. (It then has no connections to remember, the next round searches them again.)
+   // Except if IncrementalRounds is set and the next round is nested: then the round is built completely, so the next
+   // one only has to filter its connections.
+   
+   //Create a segmentbuilder
+   SectorIndexSegmentBuilder segBuilder( sectorHitIndex );
+   segBuilder.setKeepConnections( _incrementalRounds );
+   if( _splitOverflowingSectors ) segBuilder.setSectorSplitting( _maxHitsPerSector, _maxSectorSplitDepth );
+   
+   //Also load hit connectors
+   unsigned layerStepMax = 1; // how many layers to go at max
+   unsigned petalStepMax = 1; // how many petals to go at max
+   unsigned lastLayerToIP = 5;// layer 1,2,3 and 4 get connected directly to the IP
+   FTDSectorConnector secCon( _sectorSystemFTD , layerStepMax , petalStepMax , lastLayerToIP );
+   
+   segBuilder.addSectorConnector ( & secCon ); // Add the sector connector (so the SegmentBuilder knows what hits from different sectors it is allowed to look for connections)
+   
+   
+   unsigned nRounds = criteriaRounds.getNumberOfRounds();
+   
+   // the round the connections remembered by the segment builder are from
+   unsigned builtRound = 0;
+   
+   // start at the first round, that is predicted to have not too many connections
+   unsigned firstRound = 0;
+   double nPairs = 0.;
+   
+   if( _predictFirstRound ){
+      
+      nPairs = segBuilder.getNumberOfPairs();
+      firstRound = _roundPredictor->predictFirstRound( nPairs, std::max( _maxConnectionsAutomaton, 0 ) );
+      
+      statistics.add( TrackingStatistics::SkippedRounds, firstRound );
+      
+      streamlog_out( DEBUG4 ) << nPairs << " pairs of hits in connected sectors, start at round " << firstRound << "\n";
+      
+   }
+   
+   // Once the time budget is used up, a round, that is not the last one, is given up for the last (tightest) one.
+   // This is checked before the round and after each of its levels, so an expensive round is not finished in vain.
+   auto goToLastRound = [&]( unsigned& round ){
+      
+      if( ( round + 1 >= nRounds ) || !timeBudget.isExhausted() ) return false;
+      
+      streamlog_out( DEBUG4 ) << "Go on to the last round instead of round " << round << ", because the time budget of the event is used up\n";
+      timeBudget.degrade( EventTimeBudget::TighterRound );
+      
+      round = nRounds - 2; // the loop goes on with the last round
+      
+      return true;
+      
+   };
+   
+   for( unsigned round=firstRound; round < nRounds; round++ ){
+      
+      
+      if( goToLastRound( round ) ) continue;
+      
+      const std::vector< ICriterion* >& crit2Vec = criteriaRounds.getCrit2Vec( round );
+      const std::vector< ICriterion* >& crit3Vec = criteriaRounds.getCrit3Vec( round );
+      const std::vector< ICriterion* >& crit4Vec = criteriaRounds.getCrit4Vec( round );
+      
+      statistics.add( TrackingStatistics::Rounds );
+      StageTimer timer;
+      
+      
+      /**********************************************************************************************/
+      /*                Build the segments                                                          */
+      /**********************************************************************************************/
+      
+      streamlog_out( DEBUG4 ) << "\t\t---SegementBuilder---\n" ;
+      
+      segBuilder.clearCriteria();
+      segBuilder.addCriteria ( crit2Vec ); // Add the criteria on when to connect two hits
+      if( _batchedCrit2Prefilter ) segBuilder.setPrefilter( &criteriaRounds.getCrit2Prefilter( round ) );
+      segBuilder.setSubSectorCuts( &criteriaRounds.getCrit2Prefilter( round ) );
+      
+      
+      // And get out the Cellular Automaton with the 1-segments 
+      // (if rounds were jumped over, every round since the built one has to be nested)
+      bool filterConnections = _incrementalRounds && segBuilder.hasConnections();
+      for( unsigned r=builtRound + 1; filterConnections && ( r <= round ); r++ ) filterConnections = criteriaRounds.are2HitCriteriaNested( r );
+      
+      // A round with more connections is rejected anyway, so the builder may stop then. Unless the next round
+      // could filter the connections: stopping would make it search them all again.
+      bool keepForNextRound = _incrementalRounds && ( round + 1 < nRounds ) && criteriaRounds.are2HitCriteriaNested( round + 1 );
+      segBuilder.setMaxConnections( keepForNextRound ? 0 : std::max( _maxConnectionsAutomaton, 0 ) );
+      
+      if( filterConnections ) streamlog_out( DEBUG4 ) << "Filtering the connections of the last round with the new criteria\n";
+      
+      std::unique_ptr< IAutomatonEngine > automaton( createAutomatonEngine() );
+      
+      if( filterConnections ) segBuilder.get1SegAutomatonFiltered( *automaton );
+      else segBuilder.get1SegAutomaton( *automaton );
+      
+      builtRound = round;
+      
+      unsigned nConnections = automaton->getNumberOfConnections();
+      
+      // the time spent on the sub-sectors belongs to the splitting of the sectors
+      double sectorSplittingTime = segBuilder.getSectorSplittingTime();
+      
+      statistics.addTime( TrackingStatistics::SectorSplitting, sectorSplittingTime );
+      statistics.addTime( TrackingStatistics::SegmentBuilding, timer.restart() - sectorSplittingTime );
+      statistics.add( TrackingStatistics::Connections1Hit, nConnections );
+      
+      if( _predictFirstRound ){
+         
+         streamlog_out( DEBUG4 ) << "Predicted " << _roundPredictor->predictConnections( round, nPairs ) << " connections, got " << nConnections << "\n";
+         _roundPredictor->record( round, nPairs, nConnections, std::max( _maxConnectionsAutomaton, 0 ), !segBuilder.wasAborted() );
+         
+      }
+      
+      // Check if there are not too many connections (if so, the segment builder stopped already)
+      if( nConnections > unsigned( _maxConnectionsAutomaton ) ){
+         
+         streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
+         << "\tconnections( " << nConnections << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
+         continue;
+         
+      }
+      
+      if( goToLastRound( round ) ) continue;
+      
+      
+      
+      /**********************************************************************************************/
+      /*                Automaton                                                                   */
+      /**********************************************************************************************/
+      
+      
+      
+      streamlog_out( DEBUG4 ) << "\t\t---Automaton---\n" ;
+      
+      if( _useCED ){
+         
+         // draws the 1-segments (i.e. hits), only the KiTrack::Automaton can be drawn
+         KiTrackAutomatonEngine* kiTrackAutomaton = dynamic_cast< KiTrackAutomatonEngine* >( automaton.get() );
+         if( kiTrackAutomaton != NULL ) KiTrackMarlin::drawAutomatonSegments( kiTrackAutomaton->getAutomaton() );
+         
+      }
+      
+      
+      /*******************************/
+      /*      2-hit segments         */
+      /*******************************/
+      
+      streamlog_out( DEBUG4 ) << "\t\t--2-hit-Segments--\n" ;
+      
+      automaton->clearCriteria();
+      automaton->addCriteria( crit3Vec );  // Add the criteria for 3 hits (i.e. 2 2-hit segments )
+      
+      
+      // Let the automaton lengthen its 1-hit-segments to 2-hit-segments
+      automaton->lengthenSegments();
+     
+      
+      // So now we have 2-hit-segments and are ready to perform the Cellular Automaton.
+      
+      // Perform the automaton
+      automaton->doAutomaton();
+      
+      
+      // Clean segments with bad states
+      automaton->cleanBadStates();
+      
+     
+      // Reset the states of all segments
+      automaton->resetStates();
+      
+      nConnections = automaton->getNumberOfConnections();
+      
+      statistics.addTime( TrackingStatistics::Automaton2Hit, timer.restart() );
+      statistics.add( TrackingStatistics::Connections2Hit, nConnections );
+      
+      streamlog_out( DEBUG4 ) << "Automaton has " << nConnections << " connections of 2-hit segments\n";
+      
+      
+      // Check if there are not too many connections
+      if( nConnections > unsigned( _maxConnectionsAutomaton ) ){
+         
+         streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
+         << "\tconnections( " << nConnections << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
+         continue;
+         
+      }
+      
+      if( goToLastRound( round ) ) continue;
+      
+      /*******************************/
+      /*      3-hit segments         */
+      /*******************************/
+      streamlog_out( DEBUG4 ) << "\t\t--3-hit-Segments--\n" ;
+      
+      
+      automaton->clearCriteria();
+      automaton->addCriteria( crit4Vec );      
+      
+      
+      // Lengthen the 2-hit-segments to 3-hits-segments
+      automaton->lengthenSegments();
+      
+      
+      // Perform the Cellular Automaton
+      automaton->doAutomaton();
+      
+      //Clean segments with bad states
+      automaton->cleanBadStates();
+      
+      
+      //Reset the states of all segments
+      automaton->resetStates();
+      
+      nConnections = automaton->getNumberOfConnections();
+      
+      statistics.add( TrackingStatistics::Connections3Hit, nConnections );
+      
+      streamlog_out( DEBUG4 ) << "Automaton has " << nConnections << " connections of 3-hit segments\n";
+      
+      
+      // Check if there are not too many connections
+      if( nConnections > unsigned( _maxConnectionsAutomaton ) ){
+         
+         statistics.addTime( TrackingStatistics::Automaton3Hit, timer.restart() );
+         
+         streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
+         << "\tconnections( " << nConnections << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
+         continue;
+         
+      }
+      
+      // get the raw tracks (raw track = just a vector of hits, the most rudimentary form of a track)
+      rawTracks = automaton->getTracks( 3 );
+      
+      statistics.addTime( TrackingStatistics::Automaton3Hit, timer.restart() );
+      
+      break; // if we reached this place all went well and we don't need another round --> exit the loop
+      
+   }
+   
+   streamlog_out( DEBUG4 ) << "Automaton returned " << rawTracks.size() << " raw tracks \n";
+   
+   statistics.add( TrackingStatistics::RawTracks, rawTracks.size() );
+   
+   
+   /**********************************************************************************************/
+   /*                Add the overlapping hits                                                    */
+   /**********************************************************************************************/
+   
+   
+   streamlog_out( DEBUG4 ) << "\t\t---Add hits from overlapping petals + fit + helix and Kalman cuts---\n" ;
+   
+   
+   // Every raw track is dealt with independently, so the raw tracks are spread over the fitting threads.
+   // The results are stored per raw track and put together in the original order afterwards. That way the
+   // track candidates (and the best subset found from them) don't depend on the number of threads.
+   std::vector< std::vector< ITrack* > > trackCandidatesOfRawTrack( rawTracks.size() );
+   std::vector< unsigned > nVersionsOfRawTrack( rawTracks.size(), 0 );
+   std::vector< std::vector< ITrack* > > otherVersionsOfRawTrack( rawTracks.size() );
+   
+   unsigned nThreads = std::min( unsigned( _nFitThreads ), unsigned( rawTracks.size() ) );
+   
+   // The fits of the track candidates are kept for the finalisation and they are bound to the track fitting systems.
+   // So the systems are handed to the caller, who gives them back to the pool at the end of the event.
+   std::vector< MarlinTrk::IMarlinTrkSystem* > threadTrkSystems;
+   
+   for( unsigned iThread=0; iThread < std::max( nThreads, 1u ); iThread++ ){
+      
+      threadTrkSystems.push_back( _trkSystemPool->acquire() );
+      trkSystems.push_back( threadTrkSystems.back() );
+      
+   }
+   
+   // every thread counts for itself (so the times of the stages are summed over the threads)
+   std::vector< TrackingStatistics > threadStatistics( threadTrkSystems.size() );
+   
+   parallelFor( nThreads, rawTracks.size(), [&]( unsigned iThread, unsigned iRawTrack ){
+      
+      trackCandidatesOfRawTrack[ iRawTrack ] = getTrackCandidates( rawTracks[ iRawTrack ], map_hitFront_hitsBack, 
+                                                                   threadTrkSystems[ iThread ], trackPool, threadStatistics[ iThread ],
+                                                                   fitCache, nVersionsOfRawTrack[ iRawTrack ],
+                                                                   otherVersionsOfRawTrack[ iRawTrack ], timeBudget );
+      
+   } );
+   
+   for( unsigned i=0; i < threadStatistics.size(); i++ ) statistics.merge( threadStatistics[i] );
+   
+   std::vector <ITrack*> trackCandidates;
+   
+   for( unsigned i=0; i < rawTracks.size(); i++ ){
+      
+      nTrackCandidates++;
+      nTrackCandidatesPlus += nVersionsOfRawTrack[i];
+      
+      trackCandidates.insert( trackCandidates.end(), trackCandidatesOfRawTrack[i].begin(), trackCandidatesOfRawTrack[i].end() );
+      
+   }
+   
+   
+   if( _useCED ){
+//          for( unsigned i=0; i < trackCandidates.size(); i++ ) KiTrackMarlin::drawTrackRandColor( trackCandidates[i] );
+   }
+   
+   /**********************************************************************************************/
+   /*               Get the best subset of tracks                                                */
+   /**********************************************************************************************/
+   
+   streamlog_out(DEBUG3) << "The track candidates so far: \n";
+   for( unsigned iTrack=0; iTrack < trackCandidates.size(); iTrack++ ){
+      
+      streamlog_out(DEBUG3) << "track " << iTrack << ": " << trackCandidates[iTrack] << "\t" << KiTrackMarlin::getTrackHitInfo( trackCandidates[iTrack] ) << "\n";
+      
+   }
+   
+   streamlog_out( DEBUG4 ) << "\t\t---Get best subset of tracks---\n" ;
+   
+   statistics.add( TrackingStatistics::TrackCandidates, trackCandidates.size() );
+   StageTimer subsetTimer;
+   
+   std::vector< ITrack* > tracks;
+   std::vector< ITrack* > rejected;
+   
+   // the conflicts are found once from the shared hits, the subset finders only look them up
+   TrackConflictGraph conflictGraph( trackCandidates );
+   TrackCompatibilityConflictGraph comp( conflictGraph );
+   statistics.add( TrackingStatistics::Conflicts, conflictGraph.getNumberOfConflicts() );
+//       TrackQIChi2Prob trackQI;
+   TrackQIChi2ProbSpecial trackQIChi2ProbSpecial;
+   
+   // the Hopfield Neural Network is the expensive one: if the time budget is used up, take SubsetSimple instead
+   std::string bestSubsetFinder = _bestSubsetFinder;
+   
+   if( ( bestSubsetFinder == "SubsetHopfieldNN" ) && timeBudget.isExhausted() ){
+      
+      streamlog_out( DEBUG4 ) << "Use SubsetSimple instead of SubsetHopfieldNN, because the time budget of the event is used up\n";
+      
+      bestSubsetFinder = "SubsetSimple";
+      timeBudget.degrade( EventTimeBudget::SimpleSubset );
+      
+   }
+   
+   
+   if( _subsetComponents && ( ( bestSubsetFinder == "SubsetHopfieldNN" ) || ( bestSubsetFinder == "SubsetSimple" ) ) ){
+      
+      streamlog_out( DEBUG3 ) << "Get the best subset of every group of conflicting tracks\n" ;
+      
+      getBestSubsetOfComponents( trackCandidates, conflictGraph, tracks, rejected, bestSubsetFinder );
+      
+   }
+   else if( bestSubsetFinder == "SubsetHopfieldNN" ){
+      
+      streamlog_out( DEBUG3 ) << "Use SubsetHopfieldNN for getting the best subset\n" ;
+      
+      SubsetHopfieldNN< ITrack* > subset;
+      subset.setOmega( _HNN_Omega );
+      subset.setActivationThreshold( _HNN_ActivationThreshold );
+      subset.setTInf( _HNN_TInf );
+      subset.add( trackCandidates );
+      
+      
+      subset.calculateBestSet( comp, trackQIChi2ProbSpecial );
+      
+      tracks = subset.getAccepted();
+      rejected = subset.getRejected();
+      
+   }
+   else if( bestSubsetFinder == "SubsetSimple" ){
+      
+      streamlog_out( DEBUG3 ) << "Use SubsetSimple for getting the best subset\n" ;
+      
+      SubsetSimple< ITrack* > subset;
+      subset.add( trackCandidates );
+      subset.calculateBestSet( comp, trackQIChi2ProbSpecial );
+      tracks = subset.getAccepted();
+      rejected = subset.getRejected();
+      
+   }
+   else { // in any other case take all tracks
+      
+      streamlog_out( DEBUG3 ) << "Input for subset = \"" << _bestSubsetFinder << "\". All tracks are kept\n" ;
+      
+      tracks = trackCandidates;
+      
+   }
+   
+   statistics.addTime( TrackingStatistics::Subset, subsetTimer.restart() );
+   
+   // The fits of the rejected tracks and of the versions that weren't the best won't be needed for the finalisation.
+   // This is done here and not by the fitting threads, because the fit cache hands the same track to every raw track
+   // with the same hits: a track can be among the candidates twice or be another raw track's best version.
+   std::vector< ITrack* > unused = rejected;
+   for( unsigned i=0; i < otherVersionsOfRawTrack.size(); i++ ) unused.insert( unused.end(), otherVersionsOfRawTrack[i].begin(), otherVersionsOfRawTrack[i].end() );
+   
+   for( unsigned i=0; i < unused.size(); i++ ){
+      
+      if( std::find( tracks.begin(), tracks.end(), unused[i] ) == tracks.end() ) static_cast< FittedFTDTrack* >( unused[i] )->releaseFitter();
+      
+   }
+   
+   
+   if( _useCED ){
+//          for( unsigned i=0; i < tracks.size(); i++ ) KiTrackMarlin::drawTrack( tracks[i] , 0x00ff00 );
+//          for( unsigned i=0; i < rejected.size(); i++ ) KiTrackMarlin::drawTrack( rejected[i] , 0xff0000 );
+   }
+   
+   
+   return tracks;
+   
+   
+}
+
+
+void ForwardTracking::getBestSubsetOfComponents( const std::vector< ITrack* >& trackCandidates,
+                                                 const TrackConflictGraph& conflictGraph,
+                                                 std::vector< ITrack* >& accepted,
+                                                 std::vector< ITrack* >& rejected,
+                                                 const std::string& bestSubsetFinder ) const{
+   
+   
+   // Tracks only compete with tracks they share hits with. So every connected component of the conflict graph
+   // is a problem of its own: a lone track is accepted, small groups are solved exactly and only the large
+   // ones need the BestSubsetFinder.
+   
+   std::vector< std::vector< unsigned > > components = conflictGraph.getComponents();
+   
+   std::vector< char > isAccepted( trackCandidates.size(), 0 ); // not vector< bool >: written by several threads
+   std::vector< unsigned > largeComponents;
+   
+   // the conflicts within a component, with the indices in the component, and the quality indicators of its tracks
+   auto getConflictsAndQualities = [&]( const std::vector< unsigned >& component,
+                                        std::vector< std::vector< unsigned > >& conflicts, std::vector< double >& qualities ){
+      
+      conflicts.assign( component.size(), std::vector< unsigned >() );
+      qualities.assign( component.size(), 0. );
+      
+      TrackQIChi2ProbSpecial trackQI;
+      
+      for( unsigned i=0; i < component.size(); i++ ){
+         
+         qualities[i] = trackQI( trackCandidates[ component[i] ] );
+         
+         const std::vector< unsigned >& conflictsOfTrack = conflictGraph.getConflicts( component[i] );
+         
+         for( unsigned j=0; j < conflictsOfTrack.size(); j++ ){
+            
+            conflicts[i].push_back( std::lower_bound( component.begin(), component.end(), conflictsOfTrack[j] ) - component.begin() );
+            
+         }
+         
+      }
+      
+   };
+   
+   for( unsigned iComp=0; iComp < components.size(); iComp++ ){
+      
+      
+      const std::vector< unsigned >& component = components[ iComp ];
+      
+      if( component.size() == 1 ){
+         
+         isAccepted[ component[0] ] = 1;
+         
+      }
+      else if( component.size() <= unsigned( _subsetExactMaxSize ) ){
+         
+         
+         std::vector< std::vector< unsigned > > conflicts;
+         std::vector< double > qualities;
+         
+         getConflictsAndQualities( component, conflicts, qualities );
+         
+         std::vector< bool > acceptedInComponent = SubsetBranchAndBound::getBestSubset( conflicts, qualities );
+         
+         for( unsigned i=0; i < component.size(); i++ ) isAccepted[ component[i] ] = acceptedInComponent[i];
+         
+         
+      }
+      else largeComponents.push_back( iComp );
+      
+      
+   }
+   
+   streamlog_out( DEBUG3 ) << components.size() << " groups of conflicting tracks, " << largeComponents.size() << " of them larger than "
+                           << _subsetExactMaxSize << "\n";
+   
+   
+   // The large components with the BestSubsetFinder, in parallel.
+   // KiTrack's SubsetHopfieldNN draws from the global rand(), so networks running at the same time would change each
+   // other's results. Instead every component gets a SubsetSeededHopfieldNN, seeded with the index of its first track.
+   parallelFor( std::max( _subsetThreads, 1 ), largeComponents.size(), [&]( unsigned, unsigned iLarge ){
+      
+      
+      const std::vector< unsigned >& component = components[ largeComponents[ iLarge ] ];
+      
+      if( bestSubsetFinder == "SubsetHopfieldNN" ){
+         
+         std::vector< std::vector< unsigned > > conflicts;
+         std::vector< double > qualities;
+         
+         getConflictsAndQualities( component, conflicts, qualities );
+         
+         std::vector< bool > acceptedInComponent = SubsetSeededHopfieldNN::getBestSubset( conflicts, qualities, _HNN_Omega,
+                                                                                         _HNN_ActivationThreshold, _HNN_TInf,
+                                                                                         component[0] );
+         
+         for( unsigned i=0; i < component.size(); i++ ) isAccepted[ component[i] ] = acceptedInComponent[i];
+         
+      }
+      else{
+         
+         std::vector< ITrack* > tracksOfComponent;
+         for( unsigned i=0; i < component.size(); i++ ) tracksOfComponent.push_back( trackCandidates[ component[i] ] );
+         
+         TrackCompatibilityConflictGraph comp( conflictGraph );
+         TrackQIChi2ProbSpecial trackQI;
+         
+         SubsetSimple< ITrack* > subset;
+         subset.add( tracksOfComponent );
+         subset.calculateBestSet( comp, trackQI );
+         std::vector< ITrack* > acceptedOfComponent = subset.getAccepted();
+         
+         for( unsigned i=0; i < component.size(); i++ ){
+            
+            // a track being in the candidates twice is only accepted once
+            std::vector< ITrack* >::iterator it = std::find( acceptedOfComponent.begin(), acceptedOfComponent.end(), trackCandidates[ component[i] ] );
+            
+            if( it != acceptedOfComponent.end() ){
+               
+               isAccepted[ component[i] ] = 1;
+               acceptedOfComponent.erase( it );
+               
+            }
+            
+         }
+         
+      }
+      
+      
+   } );
+   
+   
+   // in the order of the track candidates, so the result doesn't depend on the threads
+   for( unsigned i=0; i < trackCandidates.size(); i++ ){
+      
+      if( isAccepted[i] ) accepted.push_back( trackCandidates[i] );
+      else rejected.push_back( trackCandidates[i] );
+      
+   }
+   
+   
+}
+
+
+void ForwardTracking::finaliseTrack( TrackImpl* trackImpl, MarlinTrk::IMarlinTrkSystem* trkSystem ) const{
+   
+   
+   Fitter fitter( trackImpl , trkSystem );
+   
+   finaliseTrack( trackImpl, fitter );
+   
+   
+}
+
+
+void ForwardTracking::finaliseTrack( TrackImpl* trackImpl, Fitter& fitter ) const{
    
-   Fitter fitter( trackImpl , _trkSystem );
    
+   // replace the track states of the track candidate
+   for( unsigned i=0; i < trackImpl->getTrackStates().size(); i++ ) delete trackImpl->getTrackStates()[i];
    trackImpl->trackStates().clear();
    
 
@@ -0,0 +1,147 @@
+#include "IncrementalKalmanFitter.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "IMPL/TrackStateImpl.h"
+#include "UTIL/BitSet32.h"
+#include "UTIL/ILDConf.h"
+#include "marlin/VerbosityLevels.h"
+
+#include "ILDImpl/IFTDHit.h"
+#include "Tools/KiTrackMarlinTools.h"
+
+
+using namespace KiTrackMarlin;
+
+
+IncrementalKalmanFitter::IncrementalKalmanFitter( const std::vector< IHit* >& hits, MarlinTrk::IMarlinTrkSystem* trkSystem ) throw( FitterException ):
+   _marlinTrk( NULL ),
+   _chi2( 0. ),
+   _ndf( 0 ){
+
+
+   std::vector< EVENT::TrackerHit* > trackerHits;
+
+   for( unsigned i=0; i < hits.size(); i++ ){
+
+      IFTDHit* ftdHit = dynamic_cast< IFTDHit* >( hits[i] );
+      if( ( ftdHit != NULL ) && !hits[i]->isVirtual() && ( ftdHit->getTrackerHit() != NULL ) ) trackerHits.push_back( ftdHit->getTrackerHit() );
+
+   }
+
+   // the hits are added from the IP outwards, the fit then goes backward to the IP
+   std::sort( trackerHits.begin(), trackerHits.end(), compare_TrackerHit_R );
+
+   _marlinTrk = trkSystem->createTrack();
+
+   unsigned nMeasurements = 0;
+
+   for( unsigned i=0; i < trackerHits.size(); i++ ){
+
+      std::vector< EVENT::TrackerHit* > measurements = getMeasurements( trackerHits[i] );
+
+      for( unsigned k=0; k < measurements.size(); k++ ){
+
+         if( _marlinTrk->addHit( measurements[k] ) == MarlinTrk::IMarlinTrack::success ) nMeasurements++;
+
+      }
+
+   }
+
+   if( nMeasurements < 3 ){
+
+      delete _marlinTrk;
+
+      std::stringstream s;
+      s << "IncrementalKalmanFitter: only " << nMeasurements << " measurements could be added to the track, at least 3 are needed\n";
+      throw FitterException( s.str() );
+
+   }
+
+   int status = _marlinTrk->initialise( MarlinTrk::IMarlinTrack::backward );
+   if( status == MarlinTrk::IMarlinTrack::success ) status = _marlinTrk->fit();
+
+   if( status == MarlinTrk::IMarlinTrack::success ){
+
+      IMPL::TrackStateImpl trackState;
+      status = _marlinTrk->getTrackState( trackState, _chi2, _ndf );
+
+   }
+
+   if( status != MarlinTrk::IMarlinTrack::success ){
+
+      delete _marlinTrk;
+
+      std::stringstream s;
+      s << "IncrementalKalmanFitter: the fit failed with status " << status << "\n";
+      throw FitterException( s.str() );
+
+   }
+
+
+}
+
+
+IncrementalKalmanFitter::~IncrementalKalmanFitter(){
+
+   delete _marlinTrk;
+
+}
+
+
+bool IncrementalKalmanFitter::getChi2Increment( IHit* hit, double& chi2Increment ){
+
+
+   IFTDHit* ftdHit = dynamic_cast< IFTDHit* >( hit );
+   if( ( ftdHit == NULL ) || hit->isVirtual() || ( ftdHit->getTrackerHit() == NULL ) ) return false;
+
+   std::vector< EVENT::TrackerHit* > measurements = getMeasurements( ftdHit->getTrackerHit() );
+   if( measurements.empty() ) return false;
+
+   chi2Increment = 0.;
+
+   for( unsigned i=0; i < measurements.size(); i++ ){
+
+      double chi2IncrementOfMeasurement = 0.;
+
+      if( _marlinTrk->testChi2Increment( measurements[i], chi2IncrementOfMeasurement ) != MarlinTrk::IMarlinTrack::success ){
+
+         streamlog_out( DEBUG1 ) << "The chi2 increment of hit " << hit << " could not be calculated\n";
+         return false;
+
+      }
+
+      chi2Increment += chi2IncrementOfMeasurement;
+
+   }
+
+   return true;
+
+
+}
+
+
+std::vector< EVENT::TrackerHit* > IncrementalKalmanFitter::getMeasurements( EVENT::TrackerHit* trackerHit ){
+
+
+   std::vector< EVENT::TrackerHit* > measurements;
+
+   if( UTIL::BitSet32( trackerHit->getType() )[ UTIL::ILDTrkHitTypeBit::COMPOSITE_SPACEPOINT ] ){
+
+      const EVENT::LCObjectVec& rawHits = trackerHit->getRawHits();
+
+      for( unsigned i=0; i < rawHits.size(); i++ ){
+
+         EVENT::TrackerHit* rawHit = dynamic_cast< EVENT::TrackerHit* >( rawHits[i] );
+         if( rawHit != NULL ) measurements.push_back( rawHit );
+
+      }
+
+   }
+   else measurements.push_back( trackerHit );
+
+   return measurements;
+
+
+}
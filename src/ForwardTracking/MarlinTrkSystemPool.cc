@@ -0,0 +1,92 @@
+#include "MarlinTrkSystemPool.h"
+
+#include <sstream>
+
+#include "MarlinTrk/Factory.h"
+#include "lcio.h"
+
+
+using namespace KiTrackMarlin;
+
+
+MarlinTrkSystemPool::MarlinTrkSystemPool( const std::string& systemName, bool MSOn, bool ElossOn, bool SmoothOn ):
+   _systemName( systemName ),
+   _MSOn( MSOn ),
+   _ElossOn( ElossOn ),
+   _SmoothOn( SmoothOn ),
+   _trkSystem( NULL ){
+
+}
+
+
+void MarlinTrkSystemPool::reserve( unsigned n ){
+
+   if( n > getMaxConcurrentUsers() ){
+
+      std::stringstream s;
+      s << "  The MarlinTrk::Factory only provides one shared MarlinTrkSystem of Type " << _systemName
+        << ", so there can't be systems for " << n << " threads fitting at the same time";
+
+      throw EVENT::Exception( s.str() );
+
+   }
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   if( n > 0 ) getTrkSystem();
+
+}
+
+
+MarlinTrk::IMarlinTrkSystem* MarlinTrkSystemPool::acquire(){
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   return getTrkSystem();
+
+}
+
+
+void MarlinTrkSystemPool::release( MarlinTrk::IMarlinTrkSystem* ){
+
+   // the system stays with the pool (and the MarlinTrk::Factory), there is nothing to give back
+
+}
+
+
+unsigned MarlinTrkSystemPool::size() const{
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   return ( _trkSystem != NULL ) ? 1 : 0;
+
+}
+
+
+MarlinTrk::IMarlinTrkSystem* MarlinTrkSystemPool::getTrkSystem(){
+
+
+   if( _trkSystem != NULL ) return _trkSystem;
+
+   MarlinTrk::IMarlinTrkSystem* trkSystem = MarlinTrk::Factory::createMarlinTrkSystem( _systemName , 0 , "" ) ;
+
+   if( trkSystem == 0 ){
+
+      throw EVENT::Exception( std::string("  Cannot initialize MarlinTrkSystem of Type: ") + _systemName  ) ;
+
+   }
+
+   // set the options
+   trkSystem->setOption( MarlinTrk::IMarlinTrkSystem::CFG::useQMS,        _MSOn ) ;       //multiple scattering
+   trkSystem->setOption( MarlinTrk::IMarlinTrkSystem::CFG::usedEdx,       _ElossOn) ;     //energy loss
+   trkSystem->setOption( MarlinTrk::IMarlinTrkSystem::CFG::useSmoothing,  _SmoothOn) ;    //smoothing
+
+   // initialise the tracking system (once)
+   trkSystem->init() ;
+
+   _trkSystem = trkSystem;
+
+   return trkSystem;
+
+
+}
@@ -0,0 +1,309 @@
+#include "OverlapHitGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include "marlin/VerbosityLevels.h"
+
+#include "ILDImpl/FTDNeighborPetalSecCon.h"
+
+
+using namespace KiTrackMarlin;
+
+
+OverlapHitGrid::OverlapHitGrid( const SectorSystemFTD* sectorSystemFTD ):
+   _sectorSystemFTD( sectorSystemFTD ){
+
+}
+
+
+std::map< IHit* , std::vector< IHit* > > OverlapHitGrid::getOverlapConnectionMap( const SectorHitIndex& sectorHitIndex, float distMax ){
+
+
+   unsigned nConnections = 0;
+
+   std::map< IHit* , std::vector< IHit* > > map_hitFront_hitsBack;
+
+   if( distMax <= 0. ) return map_hitFront_hitsBack; // no two hits can be closer than that
+
+   float distMax2 = distMax * distMax;
+
+   const std::vector< int >& sectors = sectorHitIndex.getOccupiedSectors();
+   const std::vector< IHit* >& allHits = sectorHitIndex.getAllHits();
+
+
+   // The sectors of one disk have consecutive numbers, so in the sorted occupied sectors they follow each other
+   unsigned iSector = 0;
+
+   while( iSector < sectors.size() ){
+
+
+      /**********************************************************************************************/
+      /*                Collect the hits of the disk                                                */
+      /**********************************************************************************************/
+
+      int side = _sectorSystemFTD->getSide( sectors[ iSector ] );
+      unsigned layer = _sectorSystemFTD->getLayer( sectors[ iSector ] );
+
+      _diskHits.clear();
+
+      for( ; iSector < sectors.size(); iSector++ ){
+
+
+         int sector = sectors[ iSector ];
+
+         if( ( _sectorSystemFTD->getSide( sector ) != side ) || ( _sectorSystemFTD->getLayer( sector ) != layer ) ) break;
+
+         unsigned offset = sectorHitIndex.getOffset( sector );
+         unsigned nHits = sectorHitIndex.getNumberOfHits( sector );
+
+         for( unsigned j=0; j < nHits; j++ ){
+
+            IHit* hit = allHits[ offset + j ];
+            if( hit->isVirtual() ) continue;
+
+            GridHit gridHit;
+            gridHit.position = offset + j;
+            gridHit.sector = sector;
+            gridHit.x = hit->getX();
+            gridHit.y = hit->getY();
+            gridHit.cell = 0;
+
+            _diskHits.push_back( gridHit );
+
+         }
+
+      }
+
+      unsigned nHits = _diskHits.size();
+      if( nHits < 2 ) continue;
+
+
+      /**********************************************************************************************/
+      /*                Put the hits into the grid                                                  */
+      /**********************************************************************************************/
+
+      float xMin = _diskHits[0].x;
+      float xMax = _diskHits[0].x;
+      float yMin = _diskHits[0].y;
+      float yMax = _diskHits[0].y;
+
+      for( unsigned i=1; i < nHits; i++ ){
+
+         xMin = std::min( xMin, _diskHits[i].x );
+         xMax = std::max( xMax, _diskHits[i].x );
+         yMin = std::min( yMin, _diskHits[i].y );
+         yMax = std::max( yMax, _diskHits[i].y );
+
+      }
+
+      // The cells must not be smaller than distMax. But with only a few hits, a fine grid would mostly be empty cells,
+      // so the cells get bigger until there are not many more cells than hits.
+      float cellSize = distMax;
+      unsigned nX = unsigned( ( xMax - xMin ) / cellSize ) + 1;
+      unsigned nY = unsigned( ( yMax - yMin ) / cellSize ) + 1;
+
+      while( double( nX ) * double( nY ) > 4. * nHits + 16. ){
+
+         cellSize *= 2.;
+         nX = unsigned( ( xMax - xMin ) / cellSize ) + 1;
+         nY = unsigned( ( yMax - yMin ) / cellSize ) + 1;
+
+      }
+
+      unsigned nCells = nX * nY;
+
+      // count the hits per cell
+      _cellOffsets.assign( nCells + 1, 0 );
+
+      for( unsigned i=0; i < nHits; i++ ){
+
+         unsigned cx = std::min( unsigned( ( _diskHits[i].x - xMin ) / cellSize ), nX - 1 );
+         unsigned cy = std::min( unsigned( ( _diskHits[i].y - yMin ) / cellSize ), nY - 1 );
+
+         _diskHits[i].cell = cy * nX + cx;
+         _cellOffsets[ _diskHits[i].cell + 1 ]++;
+
+      }
+
+      for( unsigned c=0; c < nCells; c++ ) _cellOffsets[ c + 1 ] += _cellOffsets[ c ];
+
+      // and put them in their place
+      _nextPosition.assign( _cellOffsets.begin(), _cellOffsets.end() - 1 );
+      _cellHits.resize( nHits );
+
+      for( unsigned i=0; i < nHits; i++ ) _cellHits[ _nextPosition[ _diskHits[i].cell ]++ ] = _diskHits[i];
+
+      _cellStore.clear();
+      for( unsigned k=0; k < nHits; k++ ) _cellStore.add( allHits[ _cellHits[k].position ] );
+
+      _selected.resize( nHits );
+
+
+      /**********************************************************************************************/
+      /*                Search the neighbouring cells                                               */
+      /**********************************************************************************************/
+
+      for( unsigned i=0; i < nHits; i++ ){
+
+
+         const GridHit& gridHitA = _cellHits[i];
+         IHit* hitA = allHits[ gridHitA.position ];
+
+         const std::vector< int >& neighbourSectors = getNeighbourSectors( gridHitA.sector );
+         if( neighbourSectors.empty() ) continue;
+
+         _matches.clear();
+
+         unsigned cx = gridHitA.cell % nX;
+         unsigned cy = gridHitA.cell / nX;
+
+         unsigned xFirst = ( cx > 0 ? cx - 1 : 0 );
+         unsigned xLast = std::min( cx + 1, nX - 1 );
+
+         for( unsigned y = ( cy > 0 ? cy - 1 : 0 ); y <= std::min( cy + 1, nY - 1 ); y++ ){
+
+
+            // the neighbouring cells of a row follow each other
+            unsigned begin = _cellOffsets[ y * nX + xFirst ];
+            unsigned end = _cellOffsets[ y * nX + xLast + 1 ];
+
+            unsigned nSelected = _cellStore.selectCloseAndBehind( _cellStore.getX( i ), _cellStore.getY( i ), _cellStore.getZ( i ),
+                                                                  begin, end, distMax2, _selected.data() );
+
+            for( unsigned s=0; s < nSelected; s++ ){
+
+
+               const GridHit& gridHitB = _cellHits[ _selected[s] ];
+
+               if( std::binary_search( neighbourSectors.begin(), neighbourSectors.end(), gridHitB.sector ) ) _matches.push_back( gridHitB.position );
+
+            }
+
+         }
+
+         if( _matches.empty() ) continue;
+
+         // the same order as when going through the neighbouring sectors one after the other
+         std::sort( _matches.begin(), _matches.end() );
+
+         std::vector< IHit* >& hitsBack = map_hitFront_hitsBack[ hitA ];
+
+         for( unsigned k=0; k < _matches.size(); k++ ){
+
+            IHit* hitB = allHits[ _matches[k] ];
+
+            streamlog_out( DEBUG2 ) << "Connected: (" << hitA->getX() << "," << hitA->getY() << "," << hitA->getZ() << ")-->("
+                                    << hitB->getX() << "," << hitB->getY() << "," << hitB->getZ() << ")\n";
+
+            hitsBack.push_back( hitB );
+            nConnections++;
+
+         }
+
+      }
+
+   }
+
+
+   streamlog_out( DEBUG3 ) << "Connected " << map_hitFront_hitsBack.size() << " hits with " << nConnections << " possible overlapping hits\n";
+
+
+   return map_hitFront_hitsBack;
+
+
+}
+
+
+std::map< IHit* , std::vector< IHit* > > OverlapHitGrid::getOverlapConnectionMapAllPairs( const SectorHitIndex& sectorHitIndex, float distMax ){
+
+
+   std::map< IHit* , std::vector< IHit* > > map_hitFront_hitsBack;
+
+   float distMax2 = distMax * distMax;
+
+   const std::vector< int >& sectors = sectorHitIndex.getOccupiedSectors();
+
+   //for every sector
+   for( unsigned i=0; i < sectors.size(); i++ ){
+
+
+      int sector = sectors[i];
+      IHit* const* hitsA = sectorHitIndex.beginHits( sector );
+      unsigned nHitsA = sectorHitIndex.getNumberOfHits( sector );
+
+      const std::vector< int >& neighbourSectors = getNeighbourSectors( sector );
+
+      //for all neighbouring petals
+      for( unsigned iTarg=0; iTarg < neighbourSectors.size(); iTarg++ ){
+
+
+         unsigned nHitsB = sectorHitIndex.getNumberOfHits( neighbourSectors[ iTarg ] );
+         if( nHitsB == 0 ) continue;
+
+         IHit* const* hitsB = sectorHitIndex.beginHits( neighbourSectors[ iTarg ] );
+
+         for( unsigned j=0; j < nHitsA; j++ ){
+
+            if( hitsA[j]->isVirtual() ) continue;
+
+            for( unsigned k=0; k < nHitsB; k++ ){
+
+               if( hitsB[k]->isVirtual() ) continue;
+
+               if( areOverlapping( hitsA[j], hitsB[k], distMax2 ) ) map_hitFront_hitsBack[ hitsA[j] ].push_back( hitsB[k] );
+
+            }
+
+         }
+
+      }
+
+   }
+
+
+   return map_hitFront_hitsBack;
+
+
+}
+
+
+const std::vector< int >& OverlapHitGrid::getNeighbourSectors( int sector ){
+
+
+   if( unsigned( sector ) >= _neighbourSectors.size() ){
+
+      _neighbourSectors.resize( sector + 1 );
+      _neighbourSectorsKnown.resize( sector + 1, false );
+
+   }
+
+   if( !_neighbourSectorsKnown[ sector ] ){
+
+      FTDNeighborPetalSecCon secCon( _sectorSystemFTD );
+      std::set< int > targetSectors = secCon.getTargetSectors( sector );
+
+      _neighbourSectors[ sector ].assign( targetSectors.begin(), targetSectors.end() ); // a set is sorted already
+      _neighbourSectorsKnown[ sector ] = true;
+
+   }
+
+   return _neighbourSectors[ sector ];
+
+
+}
+
+
+bool OverlapHitGrid::areOverlapping( IHit* hitA, IHit* hitB, float distMax2 ){
+
+
+   float dx = hitA->getX() - hitB->getX();
+   float dy = hitA->getY() - hitB->getY();
+   float dz = hitA->getZ() - hitB->getZ();
+
+   // close enough and B behind A
+   return ( dx*dx + dy*dy + dz*dz < distMax2 ) && ( fabs( hitB->getZ() ) > fabs( hitA->getZ() ) );
+
+
+}
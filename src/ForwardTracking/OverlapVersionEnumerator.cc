@@ -0,0 +1,257 @@
+#include "OverlapVersionEnumerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Criteria/SimpleCircle.h"
+
+
+using namespace KiTrackMarlin;
+
+
+OverlapVersionEnumerator::OverlapVersionEnumerator( const std::vector< IHit* >& rawTrack,
+                                                    const std::map< IHit* , std::vector< IHit* > >& map_hitFront_hitsBack,
+                                                    float skipCost ):
+   _rawTrack( rawTrack ),
+   _nRejected( 0 ),
+   _started( false ){
+
+
+   // The circle through the track in (x,y): the first, a middle and the last hit
+   bool haveCircle = false;
+   float centerX = 0.;
+   float centerY = 0.;
+   float radius = 0.;
+
+   if( rawTrack.size() >= 3 ){
+
+      IHit* a = rawTrack.front();
+      IHit* b = rawTrack[ rawTrack.size() / 2 ];
+      IHit* c = rawTrack.back();
+
+      try{
+
+         SimpleCircle circle( a->getX(), a->getY(), b->getX(), b->getY(), c->getX(), c->getY() );
+
+         centerX = circle.getCenterX();
+         centerY = circle.getCenterY();
+         radius = circle.getRadius();
+         haveCircle = !std::isnan( radius ) && !std::isinf( radius );
+
+      }
+      catch( ... ){ } // no circle (for example if the hits are on a line): all hits cost the same
+
+   }
+
+
+   for( unsigned i=0; i < rawTrack.size(); i++ ){
+
+
+      std::map< IHit* , std::vector< IHit* > >::const_iterator it = map_hitFront_hitsBack.find( rawTrack[i] );
+      if( it == map_hitFront_hitsBack.end() ) continue; // no hits behind this one
+
+      const std::vector< IHit* >& backHits = it->second;
+
+      std::vector< Option > options;
+
+      Option none;
+      none.hit = NULL;
+      none.cost = haveCircle ? skipCost : 0.;
+      options.push_back( none );
+
+      for( unsigned j=0; j < backHits.size(); j++ ){
+
+         Option option;
+         option.hit = backHits[j];
+         option.cost = 0.;
+
+         if( haveCircle ){
+
+            float dx = backHits[j]->getX() - centerX;
+            float dy = backHits[j]->getY() - centerY;
+
+            option.cost = fabs( sqrt( dx*dx + dy*dy ) - radius );
+
+         }
+
+         options.push_back( option );
+
+      }
+
+      _choices.push_back( options );
+
+
+   }
+
+   removeTrivialChoices();
+
+
+}
+
+
+bool OverlapVersionEnumerator::next( std::vector< IHit* >& version ){
+
+
+   start();
+
+   if( _queue.empty() ) return false;
+
+
+   Version best = _queue.top();
+   _queue.pop();
+
+   pushSuccessors( best );
+   getHits( best, version );
+
+
+   return true;
+
+
+}
+
+
+void OverlapVersionEnumerator::start(){
+
+
+   if( _started ) return;
+
+   _started = true;
+
+   // the cheapest version: the cheapest option of every choice
+   Version first;
+   first.cost = 0.;
+   first.optionIndices.assign( _choices.size(), 0 );
+   first.firstChangeable = 0;
+
+   for( unsigned i=0; i < _choices.size(); i++ ) first.cost += _choices[i][0].cost;
+
+   _queue.push( first );
+
+
+}
+
+
+void OverlapVersionEnumerator::pushSuccessors( const Version& version ){
+
+
+   // The versions, that differ from this one in one choice, taking the next more expensive option there.
+   // Only choices from firstChangeable on are changed: that way every combination is reached on exactly one path.
+   for( unsigned i = version.firstChangeable; i < _choices.size(); i++ ){
+
+      unsigned iOption = version.optionIndices[i];
+      if( iOption + 1 >= _choices[i].size() ) continue;
+
+      Version successor = version;
+      successor.optionIndices[i] = iOption + 1;
+      successor.cost += _choices[i][ iOption + 1 ].cost - _choices[i][ iOption ].cost;
+      successor.firstChangeable = i;
+
+      _queue.push( successor );
+
+   }
+
+
+}
+
+
+void OverlapVersionEnumerator::getHits( const Version& version, std::vector< IHit* >& hits ) const{
+
+
+   hits = _rawTrack;
+
+   for( unsigned i=0; i < _choices.size(); i++ ){
+
+      IHit* hit = _choices[i][ version.optionIndices[i] ].hit;
+      if( hit != NULL ) hits.push_back( hit );
+
+   }
+
+
+}
+
+
+unsigned OverlapVersionEnumerator::getNumberOfAddedHits( const Version& version ) const{
+
+
+   unsigned nAdded = 0;
+
+   for( unsigned i=0; i < _choices.size(); i++ ){
+
+      if( _choices[i][ version.optionIndices[i] ].hit != NULL ) nAdded++;
+
+   }
+
+   return nAdded;
+
+
+}
+
+
+bool OverlapVersionEnumerator::containsRejected( const Version& version ) const{
+
+
+   for( unsigned r=0; r < _rejected.size(); r++ ){
+
+      const Version& rejected = _rejected[r];
+
+      bool containsAll = true;
+
+      for( unsigned i=0; i < _choices.size(); i++ ){
+
+         unsigned iOption = rejected.optionIndices[i];
+
+         if( ( _choices[i][ iOption ].hit != NULL ) && ( version.optionIndices[i] != iOption ) ){
+
+            containsAll = false;
+            break;
+
+         }
+
+      }
+
+      if( containsAll ) return true;
+
+   }
+
+   return false;
+
+
+}
+
+
+double OverlapVersionEnumerator::getNumberOfPossibleVersions() const{
+
+
+   double nVersions = 1.;
+
+   for( unsigned i=0; i < _choices.size(); i++ ) nVersions *= _choices[i].size();
+
+   return nVersions;
+
+
+}
+
+
+void OverlapVersionEnumerator::removeTrivialChoices(){
+
+
+   std::vector< std::vector< Option > > choices;
+
+   for( unsigned i=0; i < _choices.size(); i++ ){
+
+      if( _choices[i].size() < 2 ) continue; // only the option to add nothing
+
+      std::vector< Option > options = _choices[i];
+
+      // stable, so with equal costs the order stays the same
+      std::stable_sort( options.begin(), options.end(),
+                        []( const Option& a, const Option& b ){ return a.cost < b.cost; } );
+
+      choices.push_back( options );
+
+   }
+
+   _choices.swap( choices );
+
+
+}
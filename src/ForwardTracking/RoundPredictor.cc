@@ -0,0 +1,226 @@
+#include "RoundPredictor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+
+using namespace KiTrackMarlin;
+
+
+const double RoundPredictor::calibrationQuantile = 0.9;
+
+
+RoundPredictor::RoundPredictor( unsigned nRounds, const std::vector< float >& acceptances, double safetyFactor ):
+   _givenAcceptances( nRounds, -1. ),
+   _safetyFactor( std::max( safetyFactor, 1. ) ),
+   _histograms( nRounds, std::vector< unsigned >( nDecades * nBinsPerDecade + 1, 0 ) ),
+   _nMeasured( nRounds, 0 ),
+   _nIncomplete( nRounds, 0 ),
+   _nPredictions( nRounds, 0 ),
+   _nRightPredictions( nRounds, 0 ){
+
+
+   for( unsigned round=0; ( round < nRounds ) && ( round < acceptances.size() ); round++ ){
+
+      if( acceptances[ round ] >= 0. ) _givenAcceptances[ round ] = acceptances[ round ];
+
+   }
+
+
+}
+
+
+unsigned RoundPredictor::getBin( double acceptance ){
+
+
+   if( acceptance <= 0. ) return 0;
+
+   double position = ( log10( acceptance ) + nDecades ) * nBinsPerDecade;
+
+   if( position < 0. ) return 0;
+
+   return std::min( unsigned( position ) + 1, nDecades * nBinsPerDecade );
+
+
+}
+
+
+double RoundPredictor::getBinUpperEdge( unsigned bin ){
+
+
+   return pow( 10., double( bin ) / nBinsPerDecade - double( nDecades ) );
+
+
+}
+
+
+double RoundPredictor::getMeasuredAcceptance( unsigned round ) const{
+
+
+   if( _nMeasured[ round ] == 0 ) return -1.;
+
+   const std::vector< unsigned >& histogram = _histograms[ round ];
+
+   double nBelow = 0.;
+
+   for( unsigned bin=0; bin < histogram.size(); bin++ ){
+
+      nBelow += histogram[ bin ];
+      if( nBelow >= calibrationQuantile * _nMeasured[ round ] ) return getBinUpperEdge( bin );
+
+   }
+
+   return 1.;
+
+
+}
+
+
+double RoundPredictor::predictConnections( unsigned round, double nPairs ) const{
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   double acceptance = _givenAcceptances[ round ];
+
+   return ( acceptance >= 0. ) ? acceptance * nPairs : -1.;
+
+
+}
+
+
+unsigned RoundPredictor::predictFirstRound( double nPairs, unsigned maxConnections ) const{
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   unsigned nRounds = _givenAcceptances.size();
+
+   for( unsigned round=0; round + 1 < nRounds; round++ ){
+
+
+      double acceptance = _givenAcceptances[ round ];
+
+      // without an acceptance we can't tell, so the round is tried (and so is a round not clearly over the limit)
+      if( ( acceptance < 0. ) || ( acceptance * nPairs <= _safetyFactor * maxConnections ) ) return round;
+
+
+   }
+
+   return ( nRounds > 0 ) ? nRounds - 1 : 0;
+
+
+}
+
+
+void RoundPredictor::record( unsigned round, double nPairs, unsigned nConnections, unsigned maxConnections, bool complete ){
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   double acceptance = _givenAcceptances[ round ];
+
+   if( acceptance >= 0. ){
+
+      bool predictedFits = ( acceptance * nPairs <= maxConnections );
+      bool fits = ( nConnections <= maxConnections );
+
+      _nPredictions[ round ]++;
+      if( predictedFits == fits ) _nRightPredictions[ round ]++;
+
+   }
+
+   if( nPairs <= 0. ) return;
+
+   _histograms[ round ][ getBin( nConnections / nPairs ) ]++;
+   _nMeasured[ round ]++;
+   if( !complete ) _nIncomplete[ round ]++;
+
+
+}
+
+
+std::vector< float > RoundPredictor::getAcceptances() const{
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   std::vector< float > acceptances;
+
+   for( unsigned round=0; round < _givenAcceptances.size(); round++ ){
+
+      double acceptance = getMeasuredAcceptance( round );
+      if( acceptance < 0. ) acceptance = _givenAcceptances[ round ];
+
+      acceptances.push_back( acceptance );
+
+   }
+
+   return acceptances;
+
+
+}
+
+
+unsigned RoundPredictor::getNumberOfPredictions() const{
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   unsigned n = 0;
+   for( unsigned round=0; round < _nPredictions.size(); round++ ) n += _nPredictions[ round ];
+
+   return n;
+
+
+}
+
+
+unsigned RoundPredictor::getNumberOfRightPredictions() const{
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   unsigned n = 0;
+   for( unsigned round=0; round < _nRightPredictions.size(); round++ ) n += _nRightPredictions[ round ];
+
+   return n;
+
+
+}
+
+
+std::string RoundPredictor::getInfo() const{
+
+
+   std::vector< float > acceptances = getAcceptances();
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   std::stringstream s;
+
+   s << "Round prediction (safety factor " << _safetyFactor << ", measured acceptance = " << calibrationQuantile << " quantile):\n";
+   s << std::setw( 8 ) << "round" << std::setw( 14 ) << "given" << std::setw( 14 ) << "measured" << std::setw( 10 ) << "events"
+     << std::setw( 10 ) << "stopped" << std::setw( 14 ) << "predictions" << std::setw( 10 ) << "right" << "\n";
+
+   for( unsigned round=0; round < acceptances.size(); round++ ){
+
+
+      s << std::setw( 8 ) << round << std::setw( 14 ) << _givenAcceptances[ round ] << std::setw( 14 ) << getMeasuredAcceptance( round )
+        << std::setw( 10 ) << _nMeasured[ round ] << std::setw( 10 ) << _nIncomplete[ round ]
+        << std::setw( 14 ) << _nPredictions[ round ] << std::setw( 10 ) << _nRightPredictions[ round ] << "\n";
+
+
+   }
+
+   // the line to calibrate the next run with
+   s << "RoundPredictorAcceptances";
+   for( unsigned round=0; round < acceptances.size(); round++ ) s << " " << acceptances[ round ];
+   s << "\n";
+
+   return s.str();
+
+
+}
@@ -0,0 +1,156 @@
+#include "SectorHitIndex.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+
+using namespace KiTrackMarlin;
+
+
+SectorHitIndex::SectorHitIndex( unsigned nSectors ){
+
+   setNumberOfSectors( nSectors );
+
+}
+
+
+void SectorHitIndex::setNumberOfSectors( unsigned nSectors ){
+
+   _hits.clear();
+   _offsets.assign( nSectors + 1, 0 );
+   _nHitsInSector.assign( nSectors, 0 );
+   _nextPosition.assign( nSectors, 0 );
+   _occupiedSectors.clear();
+
+}
+
+
+void SectorHitIndex::build( const std::vector< IHit* >& hits ){
+
+
+   std::fill( _nHitsInSector.begin(), _nHitsInSector.end(), 0 );
+   _occupiedSectors.clear();
+
+   unsigned nSectors = _nHitsInSector.size();
+
+
+   // First pass: count the hits in every sector
+   for( unsigned i=0; i < hits.size(); i++ ){
+
+      int sector = hits[i]->getSector();
+
+      if( ( sector < 0 ) || ( unsigned( sector ) >= nSectors ) ){
+
+         std::stringstream s;
+         s << "SectorHitIndex::build: sector " << sector << " is not in the range [0," << nSectors << ")";
+         throw std::out_of_range( s.str() );
+
+      }
+
+      _nHitsInSector[ sector ]++;
+
+   }
+
+
+   // The offsets are the summed up numbers of hits of the sectors before
+   _offsets[0] = 0;
+   for( unsigned sector=0; sector < nSectors; sector++ ){
+
+      _offsets[ sector + 1 ] = _offsets[ sector ] + _nHitsInSector[ sector ];
+      _nextPosition[ sector ] = _offsets[ sector ];
+
+      if( _nHitsInSector[ sector ] > 0 ) _occupiedSectors.push_back( sector );
+
+   }
+
+
+   // Second pass: put every hit at its place
+   _hits.resize( hits.size() );
+
+   for( unsigned i=0; i < hits.size(); i++ ){
+
+      int sector = hits[i]->getSector();
+      _hits[ _nextPosition[ sector ]++ ] = hits[i];
+
+   }
+
+
+}
+
+
+void SectorHitIndex::dropSector( int sector ){
+
+
+   if( getNumberOfHits( sector ) == 0 ) return;
+
+   _nHitsInSector[ sector ] = 0;
+
+   _occupiedSectors.erase( std::find( _occupiedSectors.begin(), _occupiedSectors.end(), sector ) );
+
+
+}
+
+
+void SectorHitIndex::sortSectorByRadius( int sector ){
+
+
+   unsigned nHits = getNumberOfHits( sector );
+   if( nHits < 2 ) return;
+
+   IHit** hits = _hits.data() + _offsets[ sector ];
+
+   // the radii are calculated once, not in every comparison
+   std::vector< std::pair< float , IHit* > > radiusHits( nHits );
+
+   for( unsigned i=0; i < nHits; i++ ){
+
+      float x = hits[i]->getX();
+      float y = hits[i]->getY();
+      radiusHits[i] = std::make_pair( x*x + y*y, hits[i] );
+
+   }
+
+   std::stable_sort( radiusHits.begin(), radiusHits.end(),
+                     []( const std::pair< float , IHit* >& a, const std::pair< float , IHit* >& b ){ return a.first < b.first; } );
+
+   for( unsigned i=0; i < nHits; i++ ) hits[i] = radiusHits[i].second;
+
+
+}
+
+
+unsigned SectorHitIndex::getNumberOfHits() const{
+
+
+   unsigned nHits = 0;
+
+   for( unsigned i=0; i < _occupiedSectors.size(); i++ ) nHits += _nHitsInSector[ _occupiedSectors[i] ];
+
+   return nHits;
+
+
+}
+
+
+unsigned SectorHitIndex::getNumberOfHits( int sector ) const{
+
+
+   if( ( sector < 0 ) || ( unsigned( sector ) >= _nHitsInSector.size() ) ) return 0;
+
+   return _nHitsInSector[ sector ];
+
+
+}
+
+
+std::vector< IHit* > SectorHitIndex::getHits( int sector ) const{
+
+
+   if( getNumberOfHits( sector ) == 0 ) return std::vector< IHit* >();
+
+   return std::vector< IHit* >( beginHits( sector ), endHits( sector ) );
+
+
+}
@@ -0,0 +1,438 @@
+#include "SectorIndexSegmentBuilder.h"
+
+#include <algorithm>
+#include <set>
+
+#include "marlin/VerbosityLevels.h"
+
+#include "TrackingStatistics.h"
+
+
+using namespace KiTrackMarlin;
+
+
+SectorIndexSegmentBuilder::SectorIndexSegmentBuilder( const SectorHitIndex& sectorHitIndex ):
+   _sectorHitIndex( sectorHitIndex ),
+   _keepConnections( false ),
+   _hasConnections( false ),
+   _prefilter( NULL ),
+   _subSectorCuts( NULL ),
+   _maxHitsPerSubSector( 0 ),
+   _maxSplitDepth( 0 ),
+   _maxConnections( 0 ),
+   _aborted( false ),
+   _sectorSplittingTime( 0. ),
+   _subSectorsFilled( false ),
+   _hitStoreFilled( false ){
+
+}
+
+
+double SectorIndexSegmentBuilder::getNumberOfPairs() const{
+
+
+   double nPairs = 0.;
+
+   const std::vector< int >& sectors = _sectorHitIndex.getOccupiedSectors();
+
+   for( unsigned i=0; i < sectors.size(); i++ ){
+
+
+      int sector = sectors[i];
+
+      std::set< int > targetSectors;
+
+      for( unsigned k=0; k < _sectorConnectors.size(); k++ ){
+
+         std::set< int > newTargetSectors = _sectorConnectors[k]->getTargetSectors( sector );
+         targetSectors.insert( newTargetSectors.begin(), newTargetSectors.end() );
+
+      }
+
+      unsigned nTargetHits = 0;
+
+      for( std::set< int >::iterator itTarget = targetSectors.begin(); itTarget != targetSectors.end(); itTarget++ ){
+
+         nTargetHits += _sectorHitIndex.getNumberOfHits( *itTarget );
+
+      }
+
+      nPairs += double( _sectorHitIndex.getNumberOfHits( sector ) ) * nTargetHits;
+
+
+   }
+
+   return nPairs;
+
+
+}
+
+
+void SectorIndexSegmentBuilder::get1SegAutomaton( IAutomatonEngine& automaton ){
+
+
+   unsigned nConnections = 0;
+   unsigned nConnectionsKilled = 0;
+
+   const std::vector< int >& sectors = _sectorHitIndex.getOccupiedSectors();
+
+
+   /**********************************************************************************************/
+   /*                Create a 1-segment for every hit                                            */
+   /**********************************************************************************************/
+
+   std::vector< Segment* > segments;
+   createSegments( automaton, segments );
+
+   _connections.clear();
+   _hasConnections = _keepConnections;
+   _aborted = false;
+   _sectorSplittingTime = 0.;
+
+   bool usePrefilter = ( _prefilter != NULL ) && _prefilter->isActive();
+   bool splitSectors = ( _maxHitsPerSubSector > 0 );
+
+   if( ( usePrefilter || splitSectors ) && !_hitStoreFilled ){
+
+      _hitStore.build( _sectorHitIndex.getAllHits() );
+      _hitStoreFilled = true;
+
+   }
+
+   if( splitSectors && !_subSectorsFilled ){
+
+      StageTimer splitTimer;
+
+      fillSubSectors();
+      _subSectorsFilled = true;
+
+      _sectorSplittingTime += splitTimer.restart();
+
+   }
+
+
+   /**********************************************************************************************/
+   /*                Connect the segments                                                        */
+   /**********************************************************************************************/
+
+   // (everything stops, once there are more than _maxConnections)
+   for( unsigned i=0; ( i < sectors.size() ) && !_aborted; i++ ){
+
+
+      int sector = sectors[i];
+      unsigned offset = _sectorHitIndex.getOffset( sector );
+      unsigned nHits = _sectorHitIndex.getNumberOfHits( sector );
+
+
+      // get the sectors we are allowed to connect to
+      std::set< int > targetSectors;
+
+      for( unsigned k=0; k < _sectorConnectors.size(); k++ ){
+
+         std::set< int > newTargetSectors = _sectorConnectors[k]->getTargetSectors( sector );
+         targetSectors.insert( newTargetSectors.begin(), newTargetSectors.end() );
+
+      }
+
+
+      for( std::set< int >::iterator itTarget = targetSectors.begin(); ( itTarget != targetSectors.end() ) && !_aborted; itTarget++ ){
+
+
+         int targetSector = *itTarget;
+         unsigned nTargetHits = _sectorHitIndex.getNumberOfHits( targetSector );
+
+         if( nTargetHits == 0 ) continue; // no hits there, nothing to connect
+
+         unsigned targetOffset = _sectorHitIndex.getOffset( targetSector );
+
+         if( usePrefilter ) _selected.resize( std::max< size_t >( _selected.size(), nTargetHits ) );
+
+
+         if( !splitSectors ){
+
+            for( unsigned j=0; ( j < nHits ) && !_aborted; j++ ){
+
+               connectHit( offset + j, targetOffset, targetOffset + nTargetHits, automaton, segments, usePrefilter, nConnections, nConnectionsKilled );
+
+            }
+
+            continue;
+
+         }
+
+
+         // Only the sub-sectors with radii that can pass the cut on DeltaRho get connected. The parents are still
+         // connected to their children in the order of the positions (the sub-sectors are in this order).
+         // (The time between connecting the hits is the time of the sub-sectors.)
+         StageTimer splitTimer;
+
+         for( unsigned p = _firstSubSector[ sector ]; ( p < _firstSubSector[ sector + 1 ] ) && !_aborted; p++ ){
+
+
+            const SubSector& parentSub = _subSectors[p];
+
+            for( unsigned c = _firstSubSector[ targetSector ]; ( c < _firstSubSector[ targetSector + 1 ] ) && !_aborted; c++ ){
+
+
+               const SubSector& childSub = _subSectors[c];
+
+               if( ( _subSectorCuts != NULL ) && !_subSectorCuts->mayConnectRadii( parentSub.rMin, parentSub.rMax, childSub.rMin, childSub.rMax ) ){
+
+                  nConnectionsKilled += ( parentSub.end - parentSub.begin ) * ( childSub.end - childSub.begin );
+                  continue;
+
+               }
+
+               _sectorSplittingTime += splitTimer.restart();
+
+               for( unsigned position = parentSub.begin; ( position < parentSub.end ) && !_aborted; position++ ){
+
+                  connectHit( position, childSub.begin, childSub.end, automaton, segments, usePrefilter, nConnections, nConnectionsKilled );
+
+               }
+
+               splitTimer.restart();
+
+            }
+
+         }
+
+         _sectorSplittingTime += splitTimer.restart();
+
+      }
+
+   }
+
+
+   if( _aborted ){
+
+      // the remembered connections are incomplete
+      _connections.clear();
+      _hasConnections = false;
+
+      streamlog_out( DEBUG3 ) << "SectorIndexSegmentBuilder: stopped after " << nConnections << " connections ( > "
+                              << _maxConnections << " )\n";
+
+   }
+   else{
+
+      streamlog_out( DEBUG3 ) << "SectorIndexSegmentBuilder: " << nConnections << " connections made, "
+                              << nConnectionsKilled << " connections killed by the criteria\n";
+
+   }
+
+
+}
+
+
+void SectorIndexSegmentBuilder::get1SegAutomatonFiltered( IAutomatonEngine& automaton ){
+
+
+   unsigned nConnectionsKilled = 0;
+
+   std::vector< Segment* > segments;
+   createSegments( automaton, segments );
+
+
+   _aborted = false;
+   _sectorSplittingTime = 0.;
+
+   // keep the connections still allowed, moving them to the front
+   unsigned nKept = 0;
+
+   for( unsigned i=0; ( i < _connections.size() ) && !_aborted; i++ ){
+
+
+      Segment* parent = segments[ _connections[i].first ];
+      Segment* child = segments[ _connections[i].second ];
+
+      if( areCompatible( parent , child ) ){
+
+         automaton.connect1Segments( _segmentIndex[ _connections[i].first ], _segmentIndex[ _connections[i].second ] );
+
+         _connections[ nKept ] = _connections[i];
+         nKept++;
+
+         _aborted = ( _maxConnections > 0 ) && ( nKept > _maxConnections );
+
+      }
+      else nConnectionsKilled++;
+
+
+   }
+
+   if( _aborted ){
+
+      // the connections not looked at yet are lost
+      _connections.clear();
+      _hasConnections = false;
+
+      streamlog_out( DEBUG3 ) << "SectorIndexSegmentBuilder: stopped after keeping " << nKept << " connections ( > "
+                              << _maxConnections << " )\n";
+
+   }
+   else{
+
+      _connections.resize( nKept );
+
+      streamlog_out( DEBUG3 ) << "SectorIndexSegmentBuilder: " << nKept << " of the remembered connections kept, "
+                              << nConnectionsKilled << " connections killed by the new criteria\n";
+
+   }
+
+
+}
+
+
+void SectorIndexSegmentBuilder::createSegments( IAutomatonEngine& automaton, std::vector< Segment* >& segments ){
+
+
+   const std::vector< int >& sectors = _sectorHitIndex.getOccupiedSectors();
+
+   // the segment of a hit is at the same position as the hit in the array of all hits of the index (the segments
+   // stay where they are, while more get added)
+   segments.assign( _sectorHitIndex.getAllHits().size(), NULL );
+   _segmentIndex.assign( _sectorHitIndex.getAllHits().size(), 0 );
+
+   for( unsigned i=0; i < sectors.size(); i++ ){
+
+
+      int sector = sectors[i];
+      unsigned offset = _sectorHitIndex.getOffset( sector );
+      unsigned nHits = _sectorHitIndex.getNumberOfHits( sector );
+      IHit* const* hits = _sectorHitIndex.beginHits( sector );
+
+      for( unsigned j=0; j < nHits; j++ ){
+
+         _segmentIndex[ offset + j ] = automaton.add1Segment( hits[j] );
+         segments[ offset + j ] = automaton.get1Segment( _segmentIndex[ offset + j ] );
+
+      }
+
+   }
+
+
+}
+
+
+void SectorIndexSegmentBuilder::connectHit( unsigned parentPosition, unsigned childBegin, unsigned childEnd,
+                                            IAutomatonEngine& automaton, const std::vector< Segment* >& segments, bool usePrefilter,
+                                            unsigned& nConnections, unsigned& nConnectionsKilled ){
+
+
+   Segment* parent = segments[ parentPosition ];
+
+   // the positions of the children to test
+   unsigned nCandidates = childEnd - childBegin;
+
+   if( usePrefilter ){
+
+      unsigned nChildren = nCandidates;
+      nCandidates = _prefilter->select( _hitStore, parentPosition, childBegin, childEnd, _selected.data() );
+      nConnectionsKilled += nChildren - nCandidates;
+
+   }
+
+   for( unsigned l=0; l < nCandidates; l++ ){
+
+
+      unsigned childPosition = usePrefilter ? _selected[l] : childBegin + l;
+      Segment* child = segments[ childPosition ];
+
+      if( areCompatible( parent , child ) ){
+
+         automaton.connect1Segments( _segmentIndex[ parentPosition ], _segmentIndex[ childPosition ] );
+         nConnections++;
+
+         if( _keepConnections ) _connections.push_back( std::make_pair( parentPosition, childPosition ) );
+
+         if( ( _maxConnections > 0 ) && ( nConnections > _maxConnections ) ){
+
+            _aborted = true;
+            return;
+
+         }
+
+      }
+      else nConnectionsKilled++;
+
+   }
+
+
+}
+
+
+void SectorIndexSegmentBuilder::fillSubSectors(){
+
+
+   unsigned nSectors = _sectorHitIndex.getNumberOfSectors();
+
+   _subSectors.clear();
+   _firstSubSector.assign( nSectors + 1, 0 );
+
+   for( unsigned sector=0; sector < nSectors; sector++ ){
+
+      _firstSubSector[ sector ] = _subSectors.size();
+
+      unsigned nHits = _sectorHitIndex.getNumberOfHits( sector );
+      if( nHits == 0 ) continue;
+
+      unsigned offset = _sectorHitIndex.getOffset( sector );
+      addSubSectors( offset, offset + nHits, 0 );
+
+   }
+
+   _firstSubSector[ nSectors ] = _subSectors.size();
+
+
+}
+
+
+void SectorIndexSegmentBuilder::addSubSectors( unsigned begin, unsigned end, unsigned depth ){
+
+
+   // too many hits: split into halves
+   if( ( end - begin > _maxHitsPerSubSector ) && ( depth < _maxSplitDepth ) ){
+
+      unsigned middle = begin + ( end - begin ) / 2;
+
+      addSubSectors( begin, middle, depth + 1 );
+      addSubSectors( middle, end, depth + 1 );
+
+      return;
+
+   }
+
+
+   SubSector subSector;
+   subSector.begin = begin;
+   subSector.end = end;
+   subSector.rMin = _hitStore.getR( begin );
+   subSector.rMax = _hitStore.getR( begin );
+
+   for( unsigned i = begin + 1; i < end; i++ ){
+
+      subSector.rMin = std::min< float >( subSector.rMin, _hitStore.getR( i ) );
+      subSector.rMax = std::max< float >( subSector.rMax, _hitStore.getR( i ) );
+
+   }
+
+   _subSectors.push_back( subSector );
+
+
+}
+
+
+bool SectorIndexSegmentBuilder::areCompatible( Segment* parent, Segment* child ) const{
+
+
+   for( unsigned iCrit=0; iCrit < _criteria.size(); iCrit++ ){
+
+      if( !_criteria[iCrit]->areCompatible( parent , child ) ) return false;
+
+   }
+
+   return true;
+
+
+}
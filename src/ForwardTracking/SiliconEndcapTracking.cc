@@ -1,6 +1,7 @@
 #include "SiliconEndcapTracking.h"
 
 #include <algorithm>
+#include <memory>
 
 #include "EVENT/TrackerHit.h"
 #include "EVENT/Track.h"
@@ -23,7 +24,6 @@
 //----From KiTrack-----------------------------
 #include "KiTrack/SubsetHopfieldNN.h"
 #include "KiTrack/SubsetSimple.h"
-#include "KiTrack/SegmentBuilder.h"
 #include "KiTrack/Automaton.h"
 
 //----From KiTrackMarlin-----------------------
@@ -42,6 +42,13 @@
 // #include "EndcapNeighborSecCon.h" // FIXME: TO BE IMPLEMENTED!!
 #include "EndcapSectorConnector.h"
 #include "EndcapHelixFitter.h"
+#include "TrackConflictGraph.h"
+#include "HitStore.h"
+#include "SectorIndexSegmentBuilder.h"
+#include "AutomatonEngine.h"
+#include "CompactAutomaton.h"
+#include "CachedCircleCriterion.h"
+#include "TrackingStatistics.h"
 
 
 using namespace lcio ;
@@ -172,6 +179,18 @@ SiliconEndcapTracking::SiliconEndcapTracking() : Processor("SiliconEndcapTrackin
                               int(1000));
    
    
+   registerProcessorParameter("CompactAutomaton",
+                              "Run the Cellular Automaton on flat arrays (CompactAutomaton) instead of the KiTrack::Automaton. The tracks are the same",
+                              _compactAutomaton,
+                              bool(false));
+   
+   
+   registerProcessorParameter("CacheTripletCircles",
+                              "Let the criteria calculated from circles through hit triplets (Crit3_PT, Crit4_DistOfCircleCenters) take the circles from a cache of the event",
+                              _cacheTripletCircles,
+                              bool(false));
+   
+   
    //For fitting:
    
    registerProcessorParameter("MultipleScatteringOn",
@@ -393,6 +412,11 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
 
    std::vector< IHit* > hitsTBD; //Hits to be deleted at the end
    _map_sector_hits.clear();
+   
+   // the circles of the last event belong to hits, that are gone
+   _nCircleCacheLookups += _circleCache.getNumberOfLookups();
+   _nCircleCacheHits += _circleCache.getNumberOfHits();
+   _circleCache.clear();
 
    
    /**********************************************************************************************/
@@ -505,6 +529,16 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
       IHit* virtualIPHitForward = createVirtualIPHit( _sectorSystemEndcap );
       hitsTBD.push_back( virtualIPHitForward );
       _map_sector_hits[ virtualIPHitForward->getSector() ].push_back( virtualIPHitForward );
+      
+      // the segment builder takes the hits from a SectorHitIndex (in the same order as in the map)
+      std::vector< IHit* > sectorHits;
+      
+      for( it=_map_sector_hits.begin(); it != _map_sector_hits.end(); it++ ) sectorHits.insert( sectorHits.end(), it->second.begin(), it->second.end() );
+      
+      unsigned nSectors = _map_sector_hits.rbegin()->first + 1;
+      if( _sectorHitIndex.getNumberOfSectors() < nSectors ) _sectorHitIndex.setNumberOfSectors( nSectors );
+      
+      _sectorHitIndex.build( sectorHits );
  
       
      
@@ -523,6 +557,8 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
       // so the loop will be left. If however there are too many connections we stay in the loop and use 
       // (hopefully) tighter cut offs (if provided in the steering). This should prevent combinatorial breakdown
       // for very evil events.
+      // The segment builder stops as soon as there are more than MaxConnectionsAutomaton connections, so a rejected
+      // round only costs a part of the build.
       while( setCriteria( round ) ){
          
          
@@ -536,9 +572,10 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
          streamlog_out( DEBUG4 ) << "\t\t---SegementBuilder---\n" ;
          
          //Create a segmentbuilder
-         SegmentBuilder segBuilder( _map_sector_hits );
+         SectorIndexSegmentBuilder segBuilder( _sectorHitIndex );
          
          segBuilder.addCriteria ( _crit2Vec ); // Add the criteria on when to connect two hits. The vector has been filled by the method setCriteria
+         segBuilder.setMaxConnections( std::max( _maxConnectionsAutomaton, 0 ) ); // a round with more connections is rejected anyway
          
          //Also load hit connectors
          unsigned layerStepMax = 1; // how many layers to go at max
@@ -551,13 +588,14 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
          
          
          // And get out the Cellular Automaton with the 1-segments 
-         Automaton automaton = segBuilder.get1SegAutomaton();
+         std::unique_ptr< IAutomatonEngine > automaton( createAutomatonEngine() );
+         segBuilder.get1SegAutomaton( *automaton );
          
          // Check if there are not too many connections
-         if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
+         if( automaton->getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
             
             streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
-            << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
+            << "\tconnections( " << automaton->getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
             continue;
             
          }
@@ -572,7 +610,13 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
          
          streamlog_out( DEBUG4 ) << "\t\t---Automaton---\n" ;
          
-         if( _useCED ) KiTrackMarlin::drawAutomatonSegments( automaton ); // draws the 1-segments (i.e. hits)
+         if( _useCED ){
+            
+            // draws the 1-segments (i.e. hits), only the KiTrack::Automaton can be drawn
+            KiTrackAutomatonEngine* kiTrackAutomaton = dynamic_cast< KiTrackAutomatonEngine* >( automaton.get() );
+            if( kiTrackAutomaton != NULL ) KiTrackMarlin::drawAutomatonSegments( kiTrackAutomaton->getAutomaton() );
+            
+         }
          
          
          /*******************************/
@@ -581,14 +625,14 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
          
          streamlog_out( DEBUG4 ) << "\t\t--2-hit-Segments--\n" ;
          
-         streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
+         streamlog_out(DEBUG4) << "Automaton has " << automaton->getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
          
-         automaton.clearCriteria();
-         automaton.addCriteria( _crit3Vec );  // Add the criteria for 3 hits (i.e. 2 2-hit segments )
+         automaton->clearCriteria();
+         automaton->addCriteria( _crit3Vec );  // Add the criteria for 3 hits (i.e. 2 2-hit segments )
          
          
          // Let the automaton lengthen its 1-hit-segments to 2-hit-segments
-         automaton.lengthenSegments();
+         automaton->lengthenSegments();
         
 	 
 	 // std::vector<const KiTrack::Segment* > vec_seg_2hits = automaton.getSegments();
@@ -602,24 +646,24 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
          // So now we have 2-hit-segments and are ready to perform the Cellular Automaton.
          
          // Perform the automaton
-         automaton.doAutomaton();
+         automaton->doAutomaton();
          
          
          // Clean segments with bad states
-         automaton.cleanBadStates();
+         automaton->cleanBadStates();
          
         
          // Reset the states of all segments
-         automaton.resetStates();
+         automaton->resetStates();
         
-         streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
+         streamlog_out(DEBUG4) << "Automaton has " << automaton->getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
          
          
          // Check if there are not too many connections
-         if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
+         if( automaton->getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
             
             streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
-            << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
+            << "\tconnections( " << automaton->getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
             continue;
             
          }
@@ -630,12 +674,12 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
          streamlog_out( DEBUG4 ) << "\t\t--3-hit-Segments--\n" ;
          
          
-         automaton.clearCriteria();
-         automaton.addCriteria( _crit4Vec );      
+         automaton->clearCriteria();
+         automaton->addCriteria( _crit4Vec );      
          
          
          // Lengthen the 2-hit-segments to 3-hits-segments
-         automaton.lengthenSegments();
+         automaton->lengthenSegments();
  
 	 
 	 // std::vector<const KiTrack::Segment* > vec_seg_3hits = automaton.getSegments();
@@ -650,32 +694,32 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
         
          
          // Perform the Cellular Automaton
-         automaton.doAutomaton();
+         automaton->doAutomaton();
          
          //Clean segments with bad states
-         automaton.cleanBadStates();
+         automaton->cleanBadStates();
          
          
          //Reset the states of all segments
-         automaton.resetStates();
+         automaton->resetStates();
          
 
 
       
-         streamlog_out(DEBUG4) << "Automaton has " << automaton.getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
+         streamlog_out(DEBUG4) << "Automaton has " << automaton->getTracks( 3 ).size() << " track candidates\n"; //should be commented out, because it takes time
          
          
          // Check if there are not too many connections
-         if( automaton.getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
+         if( automaton->getNumberOfConnections() > unsigned( _maxConnectionsAutomaton ) ){
             
             streamlog_out( DEBUG4 ) << "Redo the Automaton with different parameters, because there are too many connections:\n"
-            << "\tconnections( " << automaton.getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
+            << "\tconnections( " << automaton->getNumberOfConnections() << " ) > MaxConnectionsAutomaton( " << _maxConnectionsAutomaton << " )\n";
             continue;
             
          }
          
          // get the raw tracks (raw track = just a vector of hits, the most rudimentary form of a track)
-         rawTracks = automaton.getTracks( 3 );
+         rawTracks = automaton->getTracks( 3 );
          
          break; // if we reached this place all went well and we don't need another round --> exit the loop
          
@@ -896,7 +940,9 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
       std::vector< ITrack* > tracks;
       std::vector< ITrack* > rejected;
       
-      TrackCompatibilityShare1SP comp;
+      // the conflicts are found once from the shared hits, the subset finders only look them up
+      TrackConflictGraph conflictGraph( trackCandidates );
+      TrackCompatibilityConflictGraph comp( conflictGraph );
       // TrackQIChi2Prob trackQI;
       // TrackQIChi2ProbSpecial trackQIChi2ProbSpecial;
       TrackNHits trackNHits;
@@ -978,7 +1024,9 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
          if( myTrack != NULL ){
             
             
-            TrackImpl* trackImpl = new TrackImpl( *(myTrack->getLcioTrack()) );
+            // the lcio track of the candidate goes into the collection, the candidate itself gets deleted below
+            TrackImpl* trackImpl = myTrack->releaseLcioTrack();
+            if( trackImpl == NULL ) continue;
             
             try{
                
@@ -1013,6 +1061,16 @@ void SiliconEndcapTracking::processEvent( LCEvent * evt ) {
             trkCol->parameters().setValue( "QualityCode" , "Good"  ) ;
             break;
       }
+      
+      // the circles of the hit triplets asked by the criteria in this event, named like the counters of ForwardTracking
+      if( _cacheTripletCircles ){
+         
+         trkCol->parameters().setValue( std::string( "Count_" ) + KiTrackMarlin::TrackingStatistics::getCounterName( KiTrackMarlin::TrackingStatistics::CircleCacheLookups ),
+                                        int( _circleCache.getNumberOfLookups() ) );
+         trkCol->parameters().setValue( std::string( "Count_" ) + KiTrackMarlin::TrackingStatistics::getCounterName( KiTrackMarlin::TrackingStatistics::CircleCacheHits ),
+                                        int( _circleCache.getNumberOfHits() ) );
+         
+      }
 
       evt->addCollection(trkCol,_ForwardTrackCollection.c_str());
       
@@ -1069,6 +1127,17 @@ void SiliconEndcapTracking::end(){
    _crit3Vec.clear();
    _crit4Vec.clear();
    
+   if( _cacheTripletCircles ){
+      
+      _nCircleCacheLookups += _circleCache.getNumberOfLookups();
+      _nCircleCacheHits += _circleCache.getNumberOfHits();
+      _circleCache.clear();
+      
+      streamlog_out( DEBUG4 ) << "Circle cache: " << _nCircleCacheHits << " of " << _nCircleCacheLookups
+                              << " circles of hit triplets were known already\n";
+      
+   }
+   
    delete _sectorSystemEndcap;
    _sectorSystemEndcap = NULL;
 
@@ -1097,23 +1166,30 @@ std::map< IHit* , std::vector< IHit* > > SiliconEndcapTracking::getOverlapConnec
    std::map< IHit* , std::vector< IHit* > > map_hitFront_hitsBack;
    std::map< int , std::vector< IHit* > >::const_iterator it;
    
+   // the positions of the hits of a sector, read once instead of for every pair
+   KiTrackMarlin::HitStore hitStore;
+   std::vector< KiTrackMarlin::HitStore::Real > dist2;
+   
 
    //for every sector
    for ( it= map_sector_hits.begin() ; it != map_sector_hits.end(); it++ ){
            
-     std::vector< IHit* > hitVecA = it->second;
+     const std::vector< IHit* >& hitVecA = it->second;
      //int sector = it->first;
 
+     hitStore.build( hitVecA );
+     dist2.resize( hitVecA.size() );
+
      for ( unsigned j=0; j < hitVecA.size(); j++ ){
+
+       // the distances to all hits after hit j
+       hitStore.getDistances2( hitStore.getX( j ), hitStore.getY( j ), hitStore.getZ( j ), j+1, hitVecA.size(), dist2.data() );
+
        for ( unsigned k=j+1; k < hitVecA.size(); k++ ){
 	 IHit* hitA = hitVecA[j];
 	 IHit* hitB = hitVecA[k];
 
-	 // float dx = hitA->getX() - hitB->getX();
-	 // float dy = hitA->getY() - hitB->getY();
-	 // float dz = hitA->getZ() - hitB->getZ();
-	 // float dist = sqrt( dx*dx + dy*dy + dz*dz );
-	 float dist = hitA->distTo(hitB);
+	 float dist = sqrt( dist2[ k - j - 1 ] );
 	 
 	 bool closeHits = dist < distMax;
 
@@ -1261,6 +1337,17 @@ std::string SiliconEndcapTracking::getInfo_map_sector_hits(){
 }
 
 
+IAutomatonEngine* SiliconEndcapTracking::createAutomatonEngine() const{
+   
+   
+   if( _compactAutomaton ) return new CompactAutomaton();
+   
+   return new KiTrackAutomatonEngine();
+   
+   
+}
+
+
 std::vector < RawTrack > SiliconEndcapTracking::getRawTracksPlusOverlappingHits( RawTrack rawTrack , std::map< IHit* , std::vector< IHit* > >& /*map_hitFront_hitsBack*/ ){
    
    
@@ -1400,6 +1487,14 @@ bool SiliconEndcapTracking::setCriteria( unsigned round ){
       // Some debug output about the created criterion
       std::string type = crit->getType();
       
+      if( _cacheTripletCircles && ( ( type == "3Hit" ) || ( type == "4Hit" ) ) && CachedCircleCriterion::isCacheable( critName ) ){
+         
+         CachedCircleCriterion* circleCrit = new CachedCircleCriterion( crit, critName, min, max );
+         circleCrit->setCache( &_circleCache );
+         crit = circleCrit;
+         
+      }
+      
       streamlog_out( DEBUG3 ) <<  "Added: Criterion " << critName << " (type =  " << type 
       << " ). Min = " << min
       << ", Max = " << max
@@ -1438,6 +1533,8 @@ void SiliconEndcapTracking::finaliseTrack( TrackImpl* trackImpl ){
    
    Fitter fitter( trackImpl , _trkSystem );
    
+   // replace the track states of the track candidate
+   for( unsigned i=0; i < trackImpl->getTrackStates().size(); i++ ) delete trackImpl->getTrackStates()[i];
    trackImpl->trackStates().clear();
    
 
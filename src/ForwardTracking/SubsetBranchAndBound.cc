@@ -0,0 +1,84 @@
+#include "SubsetBranchAndBound.h"
+
+#include <algorithm>
+
+
+using namespace KiTrackMarlin;
+
+
+std::vector< bool > SubsetBranchAndBound::getBestSubset( const std::vector< std::vector< unsigned > >& conflicts,
+                                                         const std::vector< double >& qualities ){
+
+
+   unsigned nItems = qualities.size();
+
+   Search search;
+
+   // the best items first: then a good subset is found early and the bound cuts off more
+   for( unsigned i=0; i < nItems; i++ ) search.order.push_back( i );
+   std::stable_sort( search.order.begin(), search.order.end(),
+                     [&qualities]( unsigned a, unsigned b ){ return qualities[a] > qualities[b]; } );
+
+   search.remainingQuality.assign( nItems + 1, 0. );
+   for( unsigned pos = nItems; pos > 0; pos-- ) search.remainingQuality[ pos - 1 ] = search.remainingQuality[ pos ] + qualities[ search.order[ pos - 1 ] ];
+
+   search.nBlocking.assign( nItems, 0 );
+   search.accepted.assign( nItems, false );
+
+   search.bestAccepted.assign( nItems, false );
+   search.bestQuality = -1.;
+
+   branch( search, 0, 0., conflicts, qualities );
+
+   return search.bestAccepted;
+
+
+}
+
+
+void SubsetBranchAndBound::branch( Search& search, unsigned pos, double quality,
+                                   const std::vector< std::vector< unsigned > >& conflicts,
+                                   const std::vector< double >& qualities ){
+
+
+   if( pos == search.order.size() ){
+
+      if( quality > search.bestQuality ){
+
+         search.bestQuality = quality;
+         search.bestAccepted = search.accepted;
+
+      }
+
+      return;
+
+   }
+
+   // even accepting everything left can't beat the best subset so far
+   if( quality + search.remainingQuality[ pos ] <= search.bestQuality ) return;
+
+
+   unsigned item = search.order[ pos ];
+
+   // accept the item, if no accepted item is in conflict with it
+   if( search.nBlocking[ item ] == 0 ){
+
+
+      const std::vector< unsigned >& conflictsOfItem = conflicts[ item ];
+
+      search.accepted[ item ] = true;
+      for( unsigned i=0; i < conflictsOfItem.size(); i++ ) search.nBlocking[ conflictsOfItem[i] ]++;
+
+      branch( search, pos + 1, quality + qualities[ item ], conflicts, qualities );
+
+      search.accepted[ item ] = false;
+      for( unsigned i=0; i < conflictsOfItem.size(); i++ ) search.nBlocking[ conflictsOfItem[i] ]--;
+
+
+   }
+
+   // reject the item
+   branch( search, pos + 1, quality, conflicts, qualities );
+
+
+}
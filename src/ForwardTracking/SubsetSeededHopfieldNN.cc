@@ -0,0 +1,71 @@
+#include "SubsetSeededHopfieldNN.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+
+using namespace KiTrackMarlin;
+
+
+std::vector< bool > SubsetSeededHopfieldNN::getBestSubset( const std::vector< std::vector< unsigned > >& conflicts,
+                                                           const std::vector< double >& qualities,
+                                                           double omega, double activationThreshold, double TInf,
+                                                           unsigned seed ){
+
+
+   const double TStart = 2.1;
+   const double limitForStable = 0.01;
+   const unsigned maxIterations = 1000; // only against endless oscillation, cooled down it is stable long before
+
+   unsigned nItems = qualities.size();
+
+   std::mt19937 generator( seed );
+   std::uniform_real_distribution< double > distState( 0., 0.1 );
+
+   std::vector< double > states( nItems );
+   for( unsigned i=0; i < nItems; i++ ) states[i] = distState( generator );
+
+   std::vector< unsigned > order( nItems );
+   for( unsigned i=0; i < nItems; i++ ) order[i] = i;
+
+
+   double T = TStart;
+
+   for( unsigned iteration=0; iteration < maxIterations; iteration++ ){
+
+
+      std::shuffle( order.begin(), order.end(), generator );
+
+      bool isStable = true;
+
+      for( unsigned k=0; k < nItems; k++ ){
+
+         unsigned i = order[k];
+
+         double y = omega * qualities[i];
+         for( unsigned j=0; j < conflicts[i].size(); j++ ) y -= states[ conflicts[i][j] ];
+
+         double newState = 0.5 * ( 1. + tanh( y / T ) );
+
+         if( fabs( newState - states[i] ) > limitForStable ) isStable = false;
+
+         states[i] = newState;
+
+      }
+
+      T = 0.5 * ( T + TInf );
+
+      if( isStable ) break;
+
+
+   }
+
+
+   std::vector< bool > accepted( nItems );
+   for( unsigned i=0; i < nItems; i++ ) accepted[i] = ( states[i] >= activationThreshold );
+
+   return accepted;
+
+
+}
@@ -0,0 +1,164 @@
+#include "TrackConflictGraph.h"
+
+#include <algorithm>
+
+
+using namespace KiTrackMarlin;
+
+
+TrackConflictGraph::TrackConflictGraph( const std::vector< ITrack* >& tracks ):
+   _conflicts( tracks.size() ),
+   _nConflicts( 0 ){
+
+
+   // the inverted index: for every hit the tracks containing it
+   std::unordered_map< IHit* , std::vector< unsigned > > tracksOfHit;
+
+   for( unsigned i=0; i < tracks.size(); i++ ){
+
+
+      _indexOfTrack.insert( std::make_pair( tracks[i], i ) );
+
+      std::vector< IHit* > hits = tracks[i]->getHits();
+
+      for( unsigned j=0; j < hits.size(); j++ ){
+
+         std::vector< unsigned >& tracksOfThisHit = tracksOfHit[ hits[j] ];
+
+         // a hit is only once in a track, but be safe
+         if( tracksOfThisHit.empty() || ( tracksOfThisHit.back() != i ) ) tracksOfThisHit.push_back( i );
+
+      }
+
+
+   }
+
+
+   // all tracks sharing a hit are in conflict
+   for( std::unordered_map< IHit* , std::vector< unsigned > >::const_iterator it = tracksOfHit.begin(); it != tracksOfHit.end(); ++it ){
+
+
+      const std::vector< unsigned >& tracksOfThisHit = it->second;
+
+      for( unsigned a=0; a < tracksOfThisHit.size(); a++ ){
+
+         for( unsigned b=a+1; b < tracksOfThisHit.size(); b++ ){
+
+            _conflicts[ tracksOfThisHit[a] ].push_back( tracksOfThisHit[b] );
+            _conflicts[ tracksOfThisHit[b] ].push_back( tracksOfThisHit[a] );
+
+         }
+
+      }
+
+
+   }
+
+
+   // tracks sharing several hits got several entries
+   for( unsigned i=0; i < _conflicts.size(); i++ ){
+
+      std::vector< unsigned >& conflicts = _conflicts[i];
+
+      std::sort( conflicts.begin(), conflicts.end() );
+      conflicts.erase( std::unique( conflicts.begin(), conflicts.end() ), conflicts.end() );
+
+      _nConflicts += conflicts.size();
+
+   }
+
+   _nConflicts /= 2;
+
+
+}
+
+
+bool TrackConflictGraph::areCompatible( ITrack* trackA, ITrack* trackB ) const{
+
+
+   if( trackA == trackB ) return false;
+
+   std::unordered_map< ITrack* , unsigned >::const_iterator itA = _indexOfTrack.find( trackA );
+   std::unordered_map< ITrack* , unsigned >::const_iterator itB = _indexOfTrack.find( trackB );
+
+   if( ( itA == _indexOfTrack.end() ) || ( itB == _indexOfTrack.end() ) ) return !shareHit( trackA, trackB );
+
+   const std::vector< unsigned >& conflictsA = _conflicts[ itA->second ];
+   const std::vector< unsigned >& conflictsB = _conflicts[ itB->second ];
+
+   // search in the shorter list
+   if( conflictsA.size() <= conflictsB.size() ) return !std::binary_search( conflictsA.begin(), conflictsA.end(), itB->second );
+   else return !std::binary_search( conflictsB.begin(), conflictsB.end(), itA->second );
+
+
+}
+
+
+std::vector< std::vector< unsigned > > TrackConflictGraph::getComponents() const{
+
+
+   std::vector< std::vector< unsigned > > components;
+
+   std::vector< bool > visited( _conflicts.size(), false );
+   std::vector< unsigned > stack;
+
+   for( unsigned i=0; i < _conflicts.size(); i++ ){
+
+
+      if( visited[i] ) continue;
+
+      std::vector< unsigned > component;
+
+      visited[i] = true;
+      stack.push_back( i );
+
+      while( !stack.empty() ){
+
+         unsigned track = stack.back();
+         stack.pop_back();
+
+         component.push_back( track );
+
+         const std::vector< unsigned >& conflicts = _conflicts[ track ];
+
+         for( unsigned j=0; j < conflicts.size(); j++ ){
+
+            if( !visited[ conflicts[j] ] ){
+
+               visited[ conflicts[j] ] = true;
+               stack.push_back( conflicts[j] );
+
+            }
+
+         }
+
+      }
+
+      std::sort( component.begin(), component.end() );
+      components.push_back( component );
+
+
+   }
+
+   return components;
+
+
+}
+
+
+bool TrackConflictGraph::shareHit( ITrack* trackA, ITrack* trackB ){
+
+
+   std::vector< IHit* > hitsA = trackA->getHits();
+   std::vector< IHit* > hitsB = trackB->getHits();
+
+   for( unsigned i=0; i < hitsA.size(); i++ ){
+
+      if( std::find( hitsB.begin(), hitsB.end(), hitsA[i] ) != hitsB.end() ) return true;
+
+   }
+
+   return false;
+
+
+}
@@ -0,0 +1,243 @@
+#include "TrackingStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+
+using namespace KiTrackMarlin;
+
+
+void TrackingStatistics::clear(){
+
+
+   for( unsigned i=0; i < nStages; i++ ) _times[i] = 0.;
+   for( unsigned i=0; i < nCounters; i++ ) _counters[i] = 0;
+
+
+}
+
+
+void TrackingStatistics::merge( const TrackingStatistics& other ){
+
+
+   for( unsigned i=0; i < nStages; i++ ) _times[i] += other._times[i];
+   for( unsigned i=0; i < nCounters; i++ ) _counters[i] += other._counters[i];
+
+
+}
+
+
+const char* TrackingStatistics::getStageName( Stage stage ){
+
+
+   switch( stage ){
+
+      case HitIngestion:    return "HitIngestion";
+      case SectorSplitting: return "SectorSplitting";
+      case OverlapMap:      return "OverlapMap";
+      case SegmentBuilding: return "SegmentBuilding";
+      case Automaton2Hit:   return "Automaton2Hit";
+      case Automaton3Hit:   return "Automaton3Hit";
+      case OverlapVersions: return "OverlapVersions";
+      case HelixFit:        return "HelixFit";
+      case KalmanFit:       return "KalmanFit";
+      case Subset:          return "Subset";
+      case Finalisation:    return "Finalisation";
+      default:              return "Unknown";
+
+   }
+
+
+}
+
+
+const char* TrackingStatistics::getCounterName( Counter counter ){
+
+
+   switch( counter ){
+
+      case Hits:                  return "Hits";
+      case SplitSectors:          return "SplitSectors";
+      case DroppedSectors:        return "DroppedSectors";
+      case Rounds:                return "Rounds";
+      case SkippedRounds:         return "SkippedRounds";
+      case Connections1Hit:       return "Connections1Hit";
+      case Connections2Hit:       return "Connections2Hit";
+      case Connections3Hit:       return "Connections3Hit";
+      case RawTracks:             return "RawTracks";
+      case Versions:              return "Versions";
+      case HelixFits:             return "HelixFits";
+      case KalmanFits:            return "KalmanFits";
+      case TrackCandidates:       return "TrackCandidates";
+      case Conflicts:             return "Conflicts";
+      case Tracks:                return "Tracks";
+      case HelixFitCacheLookups:  return "HelixFitCacheLookups";
+      case HelixFitCacheHits:     return "HelixFitCacheHits";
+      case KalmanFitCacheLookups: return "KalmanFitCacheLookups";
+      case KalmanFitCacheHits:    return "KalmanFitCacheHits";
+      case CircleCacheLookups:    return "CircleCacheLookups";
+      case CircleCacheHits:       return "CircleCacheHits";
+      default:                    return "Unknown";
+
+   }
+
+
+}
+
+
+TrackingStatisticsSummary::TrackingStatisticsSummary():
+   _values( TrackingStatistics::nStages + TrackingStatistics::nCounters ){
+
+}
+
+
+void TrackingStatisticsSummary::add( const TrackingStatistics& statistics ){
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   _total.merge( statistics );
+
+   for( unsigned i=0; i < TrackingStatistics::nStages; i++ ){
+
+      _values[i].push_back( statistics.getTime( TrackingStatistics::Stage( i ) ) * 1000. ); // in ms
+
+   }
+
+   for( unsigned i=0; i < TrackingStatistics::nCounters; i++ ){
+
+      _values[ TrackingStatistics::nStages + i ].push_back( statistics.getCount( TrackingStatistics::Counter( i ) ) );
+
+   }
+
+
+}
+
+
+TrackingStatistics TrackingStatisticsSummary::getTotal() const{
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   return _total;
+
+
+}
+
+
+unsigned TrackingStatisticsSummary::getNumberOfEvents() const{
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   return _values[0].size();
+
+
+}
+
+
+bool TrackingStatisticsSummary::writeCSV( const std::string& fileName ) const{
+
+
+   std::ofstream file( fileName.c_str() );
+   if( !file.good() ) return false;
+
+   std::vector< Line > lines = getLines();
+
+   file << "quantity,unit,events,mean,p50,p99\n";
+
+   unsigned nEvents = getNumberOfEvents();
+
+   for( unsigned i=0; i < lines.size(); i++ ){
+
+      file << lines[i].name << "," << lines[i].unit << "," << nEvents << ","
+           << lines[i].mean << "," << lines[i].p50 << "," << lines[i].p99 << "\n";
+
+   }
+
+   return file.good();
+
+
+}
+
+
+std::string TrackingStatisticsSummary::getInfo() const{
+
+
+   std::stringstream s;
+
+   std::vector< Line > lines = getLines();
+
+   s << "Summary of " << getNumberOfEvents() << " events:\n";
+   s << std::setw( 24 ) << "quantity" << std::setw( 8 ) << "unit"
+     << std::setw( 14 ) << "mean" << std::setw( 14 ) << "p50" << std::setw( 14 ) << "p99" << "\n";
+
+   for( unsigned i=0; i < lines.size(); i++ ){
+
+      s << std::setw( 24 ) << lines[i].name << std::setw( 8 ) << lines[i].unit
+        << std::setw( 14 ) << lines[i].mean << std::setw( 14 ) << lines[i].p50 << std::setw( 14 ) << lines[i].p99 << "\n";
+
+   }
+
+   return s.str();
+
+
+}
+
+
+std::vector< TrackingStatisticsSummary::Line > TrackingStatisticsSummary::getLines() const{
+
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   std::vector< Line > lines;
+
+   for( unsigned i=0; i < _values.size(); i++ ){
+
+
+      Line line;
+
+      if( i < TrackingStatistics::nStages ){
+
+         line.name = TrackingStatistics::getStageName( TrackingStatistics::Stage( i ) );
+         line.unit = "ms";
+
+      }
+      else{
+
+         line.name = TrackingStatistics::getCounterName( TrackingStatistics::Counter( i - TrackingStatistics::nStages ) );
+         line.unit = "count";
+
+      }
+
+      line.mean = 0.;
+      line.p50 = 0.;
+      line.p99 = 0.;
+
+      std::vector< double > values = _values[i];
+
+      if( !values.empty() ){
+
+         double sum = 0.;
+         for( unsigned j=0; j < values.size(); j++ ) sum += values[j];
+         line.mean = sum / values.size();
+
+         // the quantiles: the value below which the fraction of the values lies (nearest rank)
+         std::sort( values.begin(), values.end() );
+         line.p50 = values[ unsigned( ceil( 0.50 * values.size() ) ) - 1 ];
+         line.p99 = values[ unsigned( ceil( 0.99 * values.size() ) ) - 1 ];
+
+      }
+
+      lines.push_back( line );
+
+
+   }
+
+   return lines;
+
+
+}
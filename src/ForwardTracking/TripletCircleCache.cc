@@ -0,0 +1,115 @@
+#include "TripletCircleCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "Criteria/SimpleCircle.h"
+
+
+using namespace KiTrackMarlin;
+
+
+std::size_t TripletCircleCache::KeyHash::operator()( const Key& key ) const{
+
+
+   std::hash< IHit* > hasher;
+
+   std::size_t seed = hasher( key.a );
+   seed ^= hasher( key.b ) + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 );
+   seed ^= hasher( key.c ) + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 );
+
+   return seed;
+
+
+}
+
+
+TripletCircleCache::TripletCircleCache():
+   _nLookups( 0 ),
+   _nHits( 0 ){
+
+}
+
+
+const TripletCircleCache::Circle& TripletCircleCache::get( IHit* a, IHit* b, IHit* c ){
+
+
+   _nLookups++;
+
+   Key key = { a, b, c };
+
+   std::unordered_map< Key, Circle, KeyHash >::iterator it = _circles.find( key );
+
+   if( it != _circles.end() ){
+
+      _nHits++;
+      return it->second;
+
+   }
+
+   return _circles.insert( std::make_pair( key, calculate( a, b, c ) ) ).first->second;
+
+
+}
+
+
+void TripletCircleCache::clear(){
+
+
+   _circles.clear();
+   _nLookups = 0;
+   _nHits = 0;
+
+
+}
+
+
+TripletCircleCache::Circle TripletCircleCache::calculate( IHit* a, IHit* b, IHit* c ){
+
+
+   Circle circle;
+   circle.valid = false;
+   circle.centerX = 0.;
+   circle.centerY = 0.;
+   circle.radius = 0.;
+   circle.omega = 0.;
+   circle.tanLambda = 0.;
+
+   float ax = a->getX();
+   float ay = a->getY();
+   float bx = b->getX();
+   float by = b->getY();
+   float cx = c->getX();
+   float cy = c->getY();
+
+   try{
+
+      SimpleCircle simpleCircle( ax, ay, bx, by, cx, cy );
+
+      circle.centerX = simpleCircle.getCenterX();
+      circle.centerY = simpleCircle.getCenterY();
+      circle.radius = simpleCircle.getRadius();
+
+   }
+   catch( ... ){ return circle; } // no circle through the hits
+
+   if( std::isnan( circle.radius ) || std::isinf( circle.radius ) || ( circle.radius <= 0. ) ) return circle;
+
+   circle.valid = true;
+
+
+   // the sense of rotation from a over b to c
+   float cross = ( bx - ax ) * ( cy - by ) - ( by - ay ) * ( cx - bx );
+   circle.omega = ( cross >= 0. ) ? 1. / circle.radius : -1. / circle.radius;
+
+   // the arc from a to c
+   float chord = sqrt( ( cx - ax ) * ( cx - ax ) + ( cy - ay ) * ( cy - ay ) );
+   float arc = 2. * circle.radius * asin( std::min( 1.f, chord / ( 2.f * circle.radius ) ) );
+
+   if( arc > 0. ) circle.tanLambda = ( c->getZ() - a->getZ() ) / arc;
+
+   return circle;
+
+
+}
@@ -0,0 +1,200 @@
+////////////////////////////////
+// compact_automaton test
+////////////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "Criteria/Criteria.h"
+#include "ILDImpl/FTDHitSimple.h"
+#include "ILDImpl/FTDSectorConnector.h"
+#include "ILDImpl/SectorSystemFTD.h"
+
+#include "SectorHitIndex.h"
+#include "SectorIndexSegmentBuilder.h"
+#include "AutomatonEngine.h"
+#include "CompactAutomaton.h"
+
+using namespace std ;
+using namespace KiTrack;
+using namespace KiTrackMarlin;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "compact_automaton" , std::cout );
+
+
+const unsigned nLayers = 8;    // including the IP as layer 0
+const unsigned nModules = 16;  // petals per disk
+const unsigned nSensors = 2;   // sensors per petal
+
+/** The z of the disks (layer 0 is the IP) */
+const float diskZ[ nLayers ] = { 0., 220., 370., 650., 800., 990., 1210., 1430. };
+
+
+/** Creates an event on the forward side: the virtual IP hit, tracks from the IP and noise hits */
+void createEvent( unsigned nTracks, std::mt19937& generator, const SectorSystemFTD* sectorSystemFTD, std::vector< IHit* >& hits ){
+
+
+   FTDHitSimple* virtualIPHit = new FTDHitSimple( 0., 0., 0., 1, 0, 0, 0, sectorSystemFTD );
+   virtualIPHit->setIsVirtual( true );
+   hits.push_back( virtualIPHit );
+
+   std::uniform_real_distribution< float > distTanTheta( 0.03, 1. );
+   std::uniform_real_distribution< float > distPhi( 0., 2. * M_PI );
+   std::uniform_real_distribution< float > distR( 40., 300. );
+   std::uniform_int_distribution< unsigned > distLayer( 1, nLayers - 1 );
+
+   const float petalWidth = 2. * M_PI / nModules;
+
+   auto createHit = [&]( float r, float phi, unsigned layer ){
+
+      unsigned module = unsigned( phi / petalWidth ) % nModules;
+      unsigned sensor = ( r < 170. ) ? 0 : 1;
+
+      hits.push_back( new FTDHitSimple( r * cos( phi ), r * sin( phi ), diskZ[ layer ], 1, layer, module, sensor, sectorSystemFTD ) );
+
+   };
+
+   for( unsigned i=0; i < nTracks; i++ ){
+
+      float tanTheta = distTanTheta( generator );
+      float phi = distPhi( generator );
+
+      for( unsigned layer=1; layer < nLayers; layer++ ){
+
+         float r = diskZ[ layer ] * tanTheta;
+         if( ( r >= 40. ) && ( r <= 300. ) ) createHit( r, phi, layer );
+
+      }
+
+   }
+
+   for( unsigned i=0; i < 3 * nTracks; i++ ) createHit( distR( generator ), distPhi( generator ), distLayer( generator ) );
+
+
+}
+
+
+/** @return the raw tracks of the automaton, run like ForwardTracking does */
+std::vector< std::vector< IHit* > > getRawTracks( IAutomatonEngine& automaton, SectorIndexSegmentBuilder& segBuilder,
+                                                  const std::vector< ICriterion* >& crit3Vec,
+                                                  const std::vector< ICriterion* >& crit4Vec ){
+
+
+   segBuilder.get1SegAutomaton( automaton );
+
+   automaton.clearCriteria();
+   automaton.addCriteria( crit3Vec );
+   automaton.lengthenSegments();
+   automaton.doAutomaton();
+   automaton.cleanBadStates();
+   automaton.resetStates();
+
+   automaton.clearCriteria();
+   automaton.addCriteria( crit4Vec );
+   automaton.lengthenSegments();
+   automaton.doAutomaton();
+   automaton.cleanBadStates();
+   automaton.resetStates();
+
+   return automaton.getTracks( 3 );
+
+
+}
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing class CompactAutomaton against the KiTrack::Automaton" );
+
+        const SectorSystemFTD sectorSystemFTD( nLayers, nModules, nSensors );
+        const unsigned nSectors = 2 * nLayers * nModules * nSensors;
+
+        std::mt19937 generator( 1 );
+
+        // loose criteria for tracks from the IP
+        std::vector< ICriterion* > crit2Vec;
+        crit2Vec.push_back( Criteria::createCriterion( "Crit2_RZRatio", 1., 1.5 ) );
+        crit2Vec.push_back( Criteria::createCriterion( "Crit2_StraightTrackRatio", 0.9, 1.1 ) );
+
+        std::vector< ICriterion* > crit3Vec;
+        crit3Vec.push_back( Criteria::createCriterion( "Crit3_3DAngle", 0., 10. ) );
+
+        std::vector< ICriterion* > crit4Vec;
+        crit4Vec.push_back( Criteria::createCriterion( "Crit4_3DAngleChange", 0., 10. ) );
+
+        FTDSectorConnector secCon( &sectorSystemFTD , 1 , 1 , 5 );
+
+        unsigned occupancies[] = { 1, 5, 20, 50 };
+
+        for( unsigned iOcc=0; iOcc < 4; iOcc++ ){
+
+
+            std::vector< IHit* > hits;
+            createEvent( occupancies[ iOcc ], generator, &sectorSystemFTD, hits );
+
+            SectorHitIndex sectorHitIndex( nSectors );
+            sectorHitIndex.build( hits );
+
+            SectorIndexSegmentBuilder segBuilder( sectorHitIndex );
+            segBuilder.addCriteria( crit2Vec );
+            segBuilder.addSectorConnector( &secCon );
+
+            KiTrackAutomatonEngine kiTrackAutomaton;
+            std::vector< std::vector< IHit* > > rawTracksKiTrack = getRawTracks( kiTrackAutomaton, segBuilder, crit3Vec, crit4Vec );
+
+            CompactAutomaton compactAutomaton;
+            std::vector< std::vector< IHit* > > rawTracksCompact = getRawTracks( compactAutomaton, segBuilder, crit3Vec, crit4Vec );
+
+            // the virtual IP hit is not part of the tracks
+            bool hasVirtualHit = false;
+
+            for( unsigned i=0; i < rawTracksCompact.size(); i++ ){
+
+                for( unsigned j=0; j < rawTracksCompact[i].size(); j++ ) if( rawTracksCompact[i][j]->isVirtual() ) hasVirtualHit = true;
+
+            }
+
+            // the order of the tracks may differ
+            std::sort( rawTracksKiTrack.begin(), rawTracksKiTrack.end() );
+            std::sort( rawTracksCompact.begin(), rawTracksCompact.end() );
+
+            std::stringstream s;
+            s << occupancies[ iOcc ] << " tracks, " << hits.size() << " hits: " << rawTracksKiTrack.size() << " raw tracks from the KiTrack::Automaton, "
+              << rawTracksCompact.size() << " from the CompactAutomaton";
+
+            if( ( rawTracksKiTrack == rawTracksCompact ) && !hasVirtualHit ) ilctest.pass( s.str() );
+            else ilctest.error( s.str() + ( hasVirtualHit ? ", virtual hit in a track" : ", the tracks differ" ) );
+
+            for( unsigned i=0; i < hits.size(); i++ ) delete hits[i];
+
+
+        }
+
+        for( unsigned i=0; i < crit2Vec.size(); i++ ) delete crit2Vec[i];
+        for( unsigned i=0; i < crit3Vec.size(); i++ ) delete crit3Vec[i];
+        for( unsigned i=0; i < crit4Vec.size(); i++ ) delete crit4Vec[i];
+
+        // --------------------------------------------------------------------
+
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
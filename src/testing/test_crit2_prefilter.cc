@@ -0,0 +1,163 @@
+///////////////////////
+// crit2_prefilter test
+///////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "KiTrack/Segment.h"
+#include "Criteria/Criteria.h"
+#include "ILDImpl/FTDHitSimple.h"
+#include "ILDImpl/SectorSystemFTD.h"
+
+#include "HitStore.h"
+#include "Crit2Prefilter.h"
+
+using namespace std ;
+using namespace KiTrack;
+using namespace KiTrackMarlin;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "crit2_prefilter" , std::cout );
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing class Crit2Prefilter" );
+
+        const unsigned nLayers = 8;
+        const unsigned nModules = 16;
+        const unsigned nSensors = 2;
+
+        const SectorSystemFTD sectorSystemFTD( nLayers, nModules, nSensors );
+
+        std::mt19937 generator( 1 );
+        std::uniform_real_distribution< float > distR( 40., 300. );
+        std::uniform_real_distribution< float > distPhi( 0., 2. * M_PI );
+
+        const float petalWidth = 2. * M_PI / nModules;
+
+        // hits on all forward disks, some on the same z, and one in the IP
+        std::vector< IHit* > hits;
+        hits.push_back( new FTDHitSimple( 0., 0., 0., 1, 0, 0, 0, &sectorSystemFTD ) );
+
+        for( unsigned layer=1; layer < nLayers; layer++ ){
+
+            for( unsigned i=0; i < 40; i++ ){
+
+                float r = distR( generator );
+                float phi = distPhi( generator );
+                unsigned module = unsigned( phi / petalWidth ) % nModules;
+
+                hits.push_back( new FTDHitSimple( r * cos( phi ), r * sin( phi ), 200. + 100. * layer,
+                                                  1, layer, module, ( r < 170. ) ? 0 : 1, &sectorSystemFTD ) );
+
+            }
+
+        }
+
+        HitStore hitStore;
+        hitStore.build( hits );
+
+        std::vector< Segment* > segments;
+        for( unsigned i=0; i < hits.size(); i++ ) segments.push_back( new Segment( hits[i] ) );
+
+        std::vector< unsigned > selected( hits.size() );
+
+
+        // the cuts: only DeltaRho, only RZRatio, both and both with a cut on DeltaRho given twice
+        const char* names[] = { "DeltaRho", "RZRatio", "both", "both, DeltaRho twice" };
+
+        for( unsigned iCase=0; iCase < 4; iCase++ ){
+
+
+            std::vector< std::string > critNames;
+            std::vector< float > critMins;
+            std::vector< float > critMaxs;
+
+            if( iCase != 1 ){ critNames.push_back( "Crit2_DeltaRho" ); critMins.push_back( -30. ); critMaxs.push_back( 30. ); }
+            if( iCase != 0 ){ critNames.push_back( "Crit2_RZRatio" ); critMins.push_back( 1. ); critMaxs.push_back( 1.05 ); }
+            if( iCase == 3 ){ critNames.push_back( "Crit2_DeltaRho" ); critMins.push_back( -50. ); critMaxs.push_back( 10. ); }
+
+            std::vector< ICriterion* > criteria;
+            Crit2Prefilter prefilter;
+
+            for( unsigned k=0; k < critNames.size(); k++ ){
+
+                criteria.push_back( Criteria::createCriterion( critNames[k], critMins[k], critMaxs[k] ) );
+                prefilter.addCut( critNames[k], critMins[k], critMaxs[k] );
+
+            }
+
+
+            // every pair accepted by the criteria has to pass the prefilter
+            unsigned nAccepted = 0;
+            unsigned nPassed = 0;
+            unsigned nMissed = 0;
+
+            for( unsigned i=0; i < hits.size(); i++ ){
+
+
+                unsigned nSelected = prefilter.select( hitStore, i, 0, hits.size(), selected.data() );
+                std::vector< bool > isSelected( hits.size(), false );
+                for( unsigned s=0; s < nSelected; s++ ) isSelected[ selected[s] ] = true;
+
+                nPassed += nSelected;
+
+                for( unsigned j=0; j < hits.size(); j++ ){
+
+                    if( i == j ) continue;
+
+                    bool accepted = true;
+                    for( unsigned k=0; k < criteria.size(); k++ ) if( !criteria[k]->areCompatible( segments[i], segments[j] ) ) accepted = false;
+
+                    if( !accepted ) continue;
+
+                    nAccepted++;
+                    if( !isSelected[j] ) nMissed++;
+
+                }
+
+            }
+
+            std::stringstream s;
+            s << names[ iCase ] << ": " << nAccepted << " pairs accepted by the criteria, " << nPassed << " passed the prefilter, "
+              << nMissed << " accepted pairs rejected by the prefilter";
+
+            // and the prefilter has to reject something
+            if( ( nMissed == 0 ) && ( nPassed < hits.size() * hits.size() ) ) ilctest.pass( s.str() );
+            else ilctest.error( s.str() );
+
+            for( unsigned k=0; k < criteria.size(); k++ ) delete criteria[k];
+
+
+        }
+
+
+        for( unsigned i=0; i < segments.size(); i++ ) delete segments[i];
+        for( unsigned i=0; i < hits.size(); i++ ) delete hits[i];
+
+        // --------------------------------------------------------------------
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,114 @@
+////////////////////////
+// overlap_hit_grid test
+////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "ILDImpl/FTDHitSimple.h"
+#include "ILDImpl/SectorSystemFTD.h"
+
+#include "SectorHitIndex.h"
+#include "OverlapHitGrid.h"
+
+using namespace std ;
+using namespace KiTrack;
+using namespace KiTrackMarlin;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "overlap_hit_grid" , std::cout );
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing class OverlapHitGrid" );
+
+        const unsigned nLayers = 8;
+        const unsigned nModules = 16;
+        const unsigned nSensors = 2;
+
+        const SectorSystemFTD sectorSystemFTD( nLayers, nModules, nSensors );
+
+        SectorHitIndex sectorHitIndex( 2 * nLayers * nModules * nSensors );
+        OverlapHitGrid overlapHitGrid( &sectorSystemFTD );
+
+        std::mt19937 generator( 1 );
+        std::uniform_real_distribution< float > distR( 40., 300. );
+        std::uniform_real_distribution< float > distPhi( 0., 2. * M_PI );
+        std::uniform_real_distribution< float > distShift( -2., 2. );
+
+        const float petalWidth = 2. * M_PI / nModules;
+        const float distMax = 3.5;
+
+        unsigned occupancies[] = { 0, 1, 5, 50, 500 };
+
+        for( unsigned iOcc=0; iOcc < 5; iOcc++ ){
+
+
+            std::vector< IHit* > hits;
+
+            for( int side = -1; side <= 1; side += 2 ){
+
+                for( unsigned layer = 1; layer < nLayers; layer++ ){
+
+                    for( unsigned i=0; i < occupancies[iOcc]; i++ ){
+
+                        float r = distR( generator );
+                        float phi = distPhi( generator );
+                        unsigned module = unsigned( phi / petalWidth ) % nModules;
+                        unsigned sensor = ( r < 170. ) ? 0 : 1;
+                        float z = side * ( 200. + 100. * layer + ( ( module % 2 ) ? 2. : 0. ) );
+
+                        hits.push_back( new FTDHitSimple( r * cos( phi ), r * sin( phi ), z, side, layer, module, sensor, &sectorSystemFTD ) );
+
+                        // a twin hit close by on the next petal
+                        unsigned moduleNext = ( module + 1 ) % nModules;
+                        float zNext = side * ( 200. + 100. * layer + ( ( moduleNext % 2 ) ? 2. : 0. ) );
+
+                        hits.push_back( new FTDHitSimple( r * cos( phi ) + distShift( generator ), r * sin( phi ) + distShift( generator ),
+                                                          zNext, side, layer, moduleNext, sensor, &sectorSystemFTD ) );
+
+                    }
+
+                }
+
+            }
+
+            sectorHitIndex.build( hits );
+
+            std::map< IHit* , std::vector< IHit* > > mapGrid = overlapHitGrid.getOverlapConnectionMap( sectorHitIndex, distMax );
+            std::map< IHit* , std::vector< IHit* > > mapAllPairs = overlapHitGrid.getOverlapConnectionMapAllPairs( sectorHitIndex, distMax );
+
+            std::stringstream s;
+            s << occupancies[iOcc] << " hits per disk: " << mapGrid.size() << " hits with overlapping hits";
+
+            if( mapGrid == mapAllPairs ) ilctest.pass( s.str() + " - grid and all pairs agree" );
+            else ilctest.error( s.str() + " - grid and all pairs disagree" );
+
+            for( unsigned i=0; i < hits.size(); i++ ) delete hits[i];
+
+        }
+
+        // --------------------------------------------------------------------
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,124 @@
+////////////////////////////////
+// subset_branch_and_bound test
+////////////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "SubsetBranchAndBound.h"
+
+using namespace std ;
+using namespace KiTrackMarlin;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "subset_branch_and_bound" , std::cout );
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing class SubsetBranchAndBound" );
+
+        std::mt19937 generator( 1 );
+        std::uniform_real_distribution< double > distQuality( 0., 1. );
+        std::uniform_real_distribution< double > distUniform( 0., 1. );
+
+        unsigned sizes[] = { 1, 2, 5, 10, 14 };
+        double conflictProbabilities[] = { 0., 0.2, 0.5, 1. };
+
+        for( unsigned iSize=0; iSize < 5; iSize++ ){
+
+            for( unsigned iProb=0; iProb < 4; iProb++ ){
+
+
+                unsigned nItems = sizes[iSize];
+
+                std::vector< std::vector< unsigned > > conflicts( nItems );
+                std::vector< double > qualities( nItems );
+
+                for( unsigned i=0; i < nItems; i++ ) qualities[i] = distQuality( generator );
+
+                for( unsigned i=0; i < nItems; i++ ){
+
+                    for( unsigned j=i+1; j < nItems; j++ ){
+
+                        if( distUniform( generator ) < conflictProbabilities[iProb] ){
+
+                            conflicts[i].push_back( j );
+                            conflicts[j].push_back( i );
+
+                        }
+
+                    }
+
+                }
+
+                std::vector< bool > accepted = SubsetBranchAndBound::getBestSubset( conflicts, qualities );
+
+                // the accepted items must be compatible
+                bool compatible = true;
+                double quality = 0.;
+
+                for( unsigned i=0; i < nItems; i++ ){
+
+                    if( !accepted[i] ) continue;
+
+                    quality += qualities[i];
+                    for( unsigned k=0; k < conflicts[i].size(); k++ ) if( accepted[ conflicts[i][k] ] ) compatible = false;
+
+                }
+
+                // and as good as the best of all subsets
+                double bestQuality = 0.;
+
+                for( unsigned subset=0; subset < ( 1u << nItems ); subset++ ){
+
+                    bool subsetCompatible = true;
+                    double subsetQuality = 0.;
+
+                    for( unsigned i=0; i < nItems; i++ ){
+
+                        if( !( ( subset >> i ) & 1 ) ) continue;
+
+                        subsetQuality += qualities[i];
+                        for( unsigned k=0; k < conflicts[i].size(); k++ ) if( ( subset >> conflicts[i][k] ) & 1 ) subsetCompatible = false;
+
+                    }
+
+                    if( subsetCompatible && ( subsetQuality > bestQuality ) ) bestQuality = subsetQuality;
+
+                }
+
+                std::stringstream s;
+                s << nItems << " items, conflict probability " << conflictProbabilities[iProb] << ": quality " << quality << ", best " << bestQuality;
+
+                if( compatible && ( fabs( quality - bestQuality ) < 1e-9 ) ) ilctest.pass( s.str() );
+                else ilctest.error( s.str() + ( compatible ? "" : ", accepted items in conflict" ) );
+
+
+            }
+
+        }
+
+        // --------------------------------------------------------------------
+
+    //} catch( ... ){
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================
@@ -0,0 +1,159 @@
+////////////////////////////////
+// subset_seeded_hopfield_nn test
+////////////////////////////////
+
+#include "ilctest/ILCTest.h"
+#include <exception>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "SubsetSeededHopfieldNN.h"
+#include "ParallelFor.h"
+
+using namespace std ;
+using namespace KiTrackMarlin;
+
+// this should be the first line in your test
+static ILCTest ilctest = ILCTest( "subset_seeded_hopfield_nn" , std::cout );
+
+//=============================================================================
+
+int main(int , char** ){
+
+    try{
+
+        // ----- write your tests in here -------------------------------------
+
+        ilctest.log( "testing class SubsetSeededHopfieldNN" );
+
+        const double omega = 0.75;
+        const double activationThreshold = 0.5;
+        const double TInf = 0.1;
+
+
+        // two conflicting items: the better one wins, a third one without conflicts is accepted
+        {
+
+            std::vector< std::vector< unsigned > > conflicts( 3 );
+            conflicts[0].push_back( 1 );
+            conflicts[1].push_back( 0 );
+
+            std::vector< double > qualities;
+            qualities.push_back( 0.3 );
+            qualities.push_back( 0.9 );
+            qualities.push_back( 0.5 );
+
+            std::vector< bool > accepted = SubsetSeededHopfieldNN::getBestSubset( conflicts, qualities, omega, activationThreshold, TInf, 0 );
+
+            if( !accepted[0] && accepted[1] && accepted[2] ) ilctest.pass( "the better of two conflicting items is accepted" );
+            else ilctest.error( "the better of two conflicting items is not the only accepted one" );
+
+        }
+
+
+        // random problems, like the groups of conflicting tracks of an event
+        std::mt19937 generator( 1 );
+        std::uniform_real_distribution< double > distUniform( 0., 1. );
+
+        unsigned nProblems = 40;
+
+        std::vector< std::vector< std::vector< unsigned > > > conflictsOfProblem( nProblems );
+        std::vector< std::vector< double > > qualitiesOfProblem( nProblems );
+
+        for( unsigned iProblem=0; iProblem < nProblems; iProblem++ ){
+
+            unsigned nItems = 15 + iProblem;
+
+            conflictsOfProblem[ iProblem ].resize( nItems );
+
+            for( unsigned i=0; i < nItems; i++ ) qualitiesOfProblem[ iProblem ].push_back( distUniform( generator ) );
+
+            for( unsigned i=0; i < nItems; i++ ){
+
+                for( unsigned j=i+1; j < nItems; j++ ){
+
+                    if( distUniform( generator ) < 0.2 ){
+
+                        conflictsOfProblem[ iProblem ][i].push_back( j );
+                        conflictsOfProblem[ iProblem ][j].push_back( i );
+
+                    }
+
+                }
+
+            }
+
+        }
+
+
+        // the result only depends on the problem and the seed, not on the number of threads
+        std::vector< std::vector< bool > > acceptedSequential( nProblems );
+
+        for( unsigned iProblem=0; iProblem < nProblems; iProblem++ ){
+
+            acceptedSequential[ iProblem ] = SubsetSeededHopfieldNN::getBestSubset( conflictsOfProblem[ iProblem ], qualitiesOfProblem[ iProblem ],
+                                                                                   omega, activationThreshold, TInf, iProblem );
+
+        }
+
+        for( unsigned nThreads = 2; nThreads <= 8; nThreads *= 2 ){
+
+            std::vector< std::vector< bool > > acceptedParallel( nProblems );
+
+            parallelFor( nThreads, nProblems, [&]( unsigned, unsigned iProblem ){
+
+                acceptedParallel[ iProblem ] = SubsetSeededHopfieldNN::getBestSubset( conflictsOfProblem[ iProblem ], qualitiesOfProblem[ iProblem ],
+                                                                                     omega, activationThreshold, TInf, iProblem );
+
+            } );
+
+            bool same = true;
+            for( unsigned iProblem=0; iProblem < nProblems; iProblem++ ) if( acceptedParallel[ iProblem ] != acceptedSequential[ iProblem ] ) same = false;
+
+            std::stringstream s;
+            s << nProblems << " problems with " << nThreads << " threads";
+
+            if( same ) ilctest.pass( s.str() + ": same result as with 1 thread" );
+            else ilctest.error( s.str() + ": result differs from 1 thread" );
+
+        }
+
+
+        // the accepted items of the cooled down network are compatible with each other
+        for( unsigned iProblem=0; iProblem < nProblems; iProblem++ ){
+
+            const std::vector< bool >& accepted = acceptedSequential[ iProblem ];
+            const std::vector< std::vector< unsigned > >& conflicts = conflictsOfProblem[ iProblem ];
+
+            bool compatible = true;
+
+            for( unsigned i=0; i < accepted.size(); i++ ){
+
+                if( !accepted[i] ) continue;
+                for( unsigned k=0; k < conflicts[i].size(); k++ ) if( accepted[ conflicts[i][k] ] ) compatible = false;
+
+            }
+
+            std::stringstream s;
+            s << "problem " << iProblem << " with " << accepted.size() << " items";
+
+            if( compatible ) ilctest.pass( s.str() + ": accepted items compatible" );
+            else ilctest.error( s.str() + ": accepted items in conflict" );
+
+        }
+
+        // --------------------------------------------------------------------
+
+
+    } catch( exception &e ){
+        ilctest.log( "exception caught" );
+        ilctest.fatal_error( e.what() );
+    }
+
+
+    return 0;
+}
+
+//=============================================================================